@@ -0,0 +1,67 @@
+/**
+ * @file        : baud_upgrade
+ * @brief Moves the link to the fastest baud that works
+ *
+ * Both sides start at the safe baud. For each faster rate (fastest first) the
+ * host asks with PROTO_BAUD, the teensy answers with PROTO_BAUD_ACK and both
+ * switch. The host then pings a few times at the new rate. If every ping comes
+ * back clean we stay, otherwise the host goes back to the safe baud and waits
+ * for the teensy to do the same (it reverts on its own after BAUD_REVERT_MS
+ * without a good frame).
+ *
+ * @note Only for a wired link. An xbee's UART baud is its own setting (BD),
+ * changing ours doesn't change it
+ *
+ * @created     : Sunday Oct 18, 2026 16:30:54 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef BAUD_UPGRADE_H
+
+#define BAUD_UPGRADE_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+
+// The teensy's BAUD_MAX, nothing past it is worth asking for
+#define BAUD_RATE_MAX 2000000
+// Rates to try, fastest first
+#define BAUD_RATES                                                             \
+  BAUD_RATE_MAX, 1000000, 921600, 460800, 230400, 115200, 57600
+#define BAUD_ACK_TIMEOUT_MS 250
+#define BAUD_SETTLE_MS 20
+#define BAUD_VERIFY_PINGS 8
+#define BAUD_VERIFY_TIMEOUT_MS 100 // Per ping
+// Has to be more than the teensy's BAUD_REVERT_MS
+#define BAUD_REVERT_MS 1200
+
+/**
+ * @brief Negotiates the fastest reliable baud up to max_baud
+ * @note Blocks for up to a few seconds, call it before the link is in use
+ *
+ * @param fd The serial, at safe_baud
+ * @param stop_fd An fd that ends the negotiation when readable (-1 for none)
+ * @param safe_baud The baud both sides start at
+ * @param max_baud The fastest baud to try
+ * @param seq seq of the next frame, moved past the frames sent here
+ *
+ * @return The baud the link ended up at
+ */
+int baud_upgrade(int fd, int stop_fd, int safe_baud, int max_baud,
+                 uint8_t *seq);
+
+/**
+ * @brief Goes back to the safe baud and waits out the teensy's own revert
+ * @note For a link that was lost at a faster baud, blocks for BAUD_REVERT_MS
+ *
+ * @param fd The serial
+ * @param stop_fd An fd that ends the wait when readable (-1 for none)
+ * @param safe_baud The baud both sides start at
+ *
+ * @return 0 on success, -1 on error
+ */
+int baud_revert(int fd, int stop_fd, int safe_baud);
+
+#endif /* end of include guard BAUD_UPGRADE_H */
@@ -0,0 +1,89 @@
+/**
+ * @file        : hotplug
+ * @brief Finds the serial adapter by USB id and hears about it being plugged in
+ *
+ * The kernel sends a uevent on a netlink socket when a tty is added, so instead
+ * of trying to open every port once a second we sleep on that socket and look
+ * again the moment something shows up. Which adapter is ours comes from sysfs
+ * (idVendor, idProduct and serial of the USB device above the tty), so another
+ * USB serial device plugged in first doesn't get picked.
+ *
+ * @created     : Sunday Oct 18, 2026 16:35:10 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef HOTPLUG_H
+
+#define HOTPLUG_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Local Includes
+
+// Ports with no uevents (ptys, a missing netlink socket) are still looked at
+// this often
+#define HOTPLUG_RESCAN_MS 1000
+// udev can take a moment to fix the node's permissions after it's added
+#define HOTPLUG_RETRY_MS 20
+#define HOTPLUG_RETRIES 25
+
+#define HOTPLUG_MAX_PORT 64
+
+////////// Data Structures //////////
+
+/**
+ * Which USB serial adapter to use, 0 / NULL matches anything
+ *
+ * @vid    USB vendor id
+ * @pid    USB product id
+ * @serial USB serial number
+ */
+struct serial_match {
+  uint16_t vid;
+  uint16_t pid;
+  const char *serial;
+};
+
+/**
+ * @brief Parses vid:pid[:serial] (hex ids, like lsusb prints them)
+ * @note serial points into str
+ *
+ * @param match The match to fill in
+ * @param str The string
+ *
+ * @return 0 on success, -1 if it doesn't parse
+ */
+int serial_match_parse(struct serial_match *match, const char *str);
+
+/**
+ * @brief Whether a port is on the adapter we want
+ *
+ * @param match The match
+ * @param port The port (ex /dev/ttyUSB0)
+ *
+ * @return 1 if it matches (always if match is empty), 0 if not
+ */
+int serial_match_port(const struct serial_match *match, const char *port);
+
+/**
+ * @brief Opens a netlink socket for kernel uevents
+ *
+ * @return The socket (O_NONBLOCK), -1 on error
+ */
+int hotplug_open();
+
+/**
+ * @brief Reads every waiting uevent
+ *
+ * @param fd The socket from hotplug_open
+ * @param port Set to the last tty that was added (ex /dev/ttyUSB0), empty if
+ * we don't know which (the socket overflowed)
+ * @param len Size of port
+ *
+ * @return 1 if a tty was added (or might have been), 0 if not, -1 on error
+ */
+int hotplug_read(int fd, char *port, size_t len);
+
+#endif /* end of include guard HOTPLUG_H */
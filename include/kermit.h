@@ -8,6 +8,8 @@
 
 #define KERMIT_H
 
+#include <string.h>
+
 #include "wii_controller.h"
 
 /**
@@ -229,6 +231,7 @@ struct robot_s kermit_robot() {
   *gun = create_gun();
   rob.gun = gun;
   rob.period = .01;
+  memset(&rob.telemetry, 0, sizeof(rob.telemetry));
   start_robot(&rob);
   return rob;
 }
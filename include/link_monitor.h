@@ -0,0 +1,194 @@
+/**
+ * @file        : link_monitor
+ * @brief Keeps an eye on the serial link and says how hard to lean on it
+ *
+ * Every time the serial side reads or sends, the monitor diffs the counters
+ * the reader, writer, probe and xbee already keep into a sliding window of
+ * short buckets: frames sent against frames the teensy (or the radio) says
+ * never made it, good frames against bad ones in both directions, probe round
+ * trips, and the longest gap between two telemetry reports (the teensy's
+ * keepalive). From the window the link is either
+ *
+ * LINK_GOOD      Send as fast as the tx policy likes
+ * LINK_DEGRADED  Something in the window is off, send less and probe less
+ * LINK_LOST      No report for a while or no port, stop the robot
+ *
+ * Leaving LINK_DEGRADED takes a while of good windows so a flaky link doesn't
+ * flap. After LINK_LOST the robot stays stopped until the link is back and
+ * the stick has been let go, so it can't lurch off with a stale command.
+ *
+ * @created     : Sunday Oct 18, 2026 16:48:27 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef LINK_MONITOR_H
+
+#define LINK_MONITOR_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+#include "probe.h"
+#include "serial_writer.h"
+#include "telemetry.h"
+
+// Sliding window, LINK_BUCKETS of LINK_BUCKET seconds
+#define LINK_BUCKETS 20
+#define LINK_BUCKET 0.1
+// Fewer frames than this in the window says nothing about rates
+#define LINK_MIN_SAMPLES 10
+// Degraded below / above any of these
+#define LINK_MIN_DELIVERY 0.9 // Frames that made it
+#define LINK_MAX_ERRORS 0.05 // Bad frames out of all frames received
+#define LINK_MAX_RTT 0.1 // Mean probe round trip, seconds
+#define LINK_MAX_GAP 0.5 // Between telemetry reports (every 0.1 s)
+// Lost with no report for this long
+#define LINK_LOST_GAP 1.0
+// Good windows for this long before leaving degraded
+#define LINK_RECOVER 3.0
+// How much longer commands and probes are spaced out when degraded
+#define LINK_SLOWDOWN 4
+
+////////// Data Structures //////////
+
+enum link_state { LINK_GOOD, LINK_DEGRADED, LINK_LOST };
+
+/**
+ * What happened on the link during one bucket
+ *
+ * @start_ns  Start of the bucket
+ * @sent      Frames sent
+ * @missed    Frames the teensy or the radio says never made it
+ * @good      Good frames received
+ * @bad       Bad frames, caught by either end
+ * @rtt_count Probe round trips
+ * @rtt_ns    Sum of the probe round trips
+ * @gap_ns    Longest gap between two telemetry reports
+ */
+struct link_bucket {
+  int64_t start_ns;
+  uint32_t sent;
+  uint32_t missed;
+  uint32_t good;
+  uint32_t bad;
+  uint32_t rtt_count;
+  int64_t rtt_ns;
+  int64_t gap_ns;
+};
+
+/**
+ * The window summed up
+ *
+ * @delivery Frames that made it, 1 without enough samples
+ * @errors   Bad frames out of all received, 0 without enough samples
+ * @rtt_ns   Mean probe round trip, 0 without probes
+ * @gap_ns   Longest gap between reports, counting the one still open
+ */
+struct link_window {
+  double delivery;
+  double errors;
+  int64_t rtt_ns;
+  int64_t gap_ns;
+};
+
+/**
+ * @enabled        0 when there's nothing to monitor (debug), always good
+ * @state          Where the link is at
+ * @stopped        Commands are replaced with a stop until the stick is let go
+ * @state_ns       When state was entered
+ * @good_ns        Since when the window has looked fine, 0 if it doesn't
+ * @last_report_ns When the last telemetry report came in
+ * @buckets        The sliding window
+ * @window         The window as of the last update
+ * @reports        Reports, frames sent, other frames, pongs, bad frames and
+ * xbee failures as of the last update, what's new gets added to the buckets
+ * @teensy         The last report, for its counters
+ * @have_teensy    Set once teensy holds a report
+ * @degraded       Times the link went degraded
+ * @lost           Times the link was lost
+ * @degraded_ns    Time spent degraded
+ * @lost_ns        Time spent lost
+ */
+struct link_monitor {
+  int enabled;
+  enum link_state state;
+  int stopped;
+  int64_t state_ns;
+  int64_t good_ns;
+  int64_t last_report_ns;
+  struct link_bucket buckets[LINK_BUCKETS];
+  struct link_window window;
+  uint64_t reports;
+  uint64_t frames;
+  uint64_t other_frames;
+  uint64_t answered;
+  uint64_t host_bad;
+  uint64_t xbee_failed;
+  struct proto_telemetry teensy;
+  int have_teensy;
+  uint64_t degraded;
+  uint64_t lost;
+  int64_t degraded_ns;
+  int64_t lost_ns;
+};
+
+/**
+ * @brief Sets up a monitor, it starts out good and goes degraded or lost off
+ * the first windows like any other time
+ *
+ * @param monitor The monitor
+ * @param enabled 0 to leave the link always good (nothing is connected)
+ * @param now_ns CLOCK_MONOTONIC now
+ */
+void link_monitor_init(struct link_monitor *monitor, int enabled,
+                       int64_t now_ns);
+
+/**
+ * @brief Takes in whatever changed since the last update and reevaluates the
+ * link
+ * @note Call it after every read and every send, and at least every so often
+ * so a silent link is noticed
+ *
+ * @param monitor The monitor
+ * @param now_ns CLOCK_MONOTONIC now
+ * @param reader The telemetry reader
+ * @param probe The latency probe
+ * @param writer The serial writer (and its xbee, if any). No port means lost
+ *
+ * @return 1 if the state changed, 0 if not
+ */
+int link_monitor_update(struct link_monitor *monitor, int64_t now_ns,
+                        const struct telemetry_reader *reader,
+                        const struct latency_probe *probe,
+                        const struct serial_writer *writer);
+
+/**
+ * @brief Whether commands should be replaced with a stop right now
+ *
+ * @param monitor The monitor
+ * @param neutral Whether the command to send is a neutral stick, which
+ * releases a stop once the link is back
+ *
+ * @return 1 to send a stop instead
+ */
+int link_monitor_stopped(struct link_monitor *monitor, int neutral);
+
+/**
+ * @brief How much to space out commands and probes for the current state
+ *
+ * @param monitor The monitor
+ *
+ * @return 1 when good, LINK_SLOWDOWN otherwise
+ */
+int link_monitor_slowdown(const struct link_monitor *monitor);
+
+/**
+ * @brief Logs the time spent degraded and lost
+ *
+ * @param monitor The monitor
+ * @param now_ns CLOCK_MONOTONIC now
+ */
+void link_monitor_log(const struct link_monitor *monitor, int64_t now_ns);
+
+#endif /* end of include guard LINK_MONITOR_H */
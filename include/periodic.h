@@ -0,0 +1,110 @@
+/**
+ * @file        : periodic
+ * @brief A drift free periodic task built on a timerfd
+ *
+ * The timer is armed once with an absolute start time on CLOCK_MONOTONIC, so
+ * the k-th tick is always at start + k * period no matter how long the work in
+ * between took. Every wakeup is compared against that deadline to keep track
+ * of missed ticks and wakeup latency (jitter).
+ *
+ * @created     : Sunday Oct 18, 2026 16:06:11 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef PERIODIC_H
+
+#define PERIODIC_H
+
+// C Includes
+#include <stdint.h>
+#include <time.h>
+
+// Local Includes
+#include "stats.h"
+
+////////// Data Structures //////////
+
+/**
+ * Timing statistics for a periodic task
+ *
+ * @missed  Number of deadlines we slept through (timer expired more than
+ * once between two waits)
+ * @late_ns Wakeup latency after each deadline, one sample per tick. The
+ * standard deviation of this is the jitter
+ */
+struct periodic_stats {
+  uint64_t missed;
+  struct running_stats late_ns;
+};
+
+struct periodic_task {
+  int timer_fd;
+  int64_t period_ns;
+  struct timespec start;
+  uint64_t expirations; // Total expirations since start
+  struct periodic_stats stats;
+};
+
+/**
+ * @brief Creates and arms a periodic task
+ *
+ * @param task The task to initialize
+ * @param period The period in seconds
+ *
+ * @return 0 on success, -1 on error
+ */
+int periodic_init(struct periodic_task *task, double period);
+
+/**
+ * @brief Blocks until the next deadline
+ *
+ * @param task The periodic task
+ * @param stop_fd An fd that ends the wait early when readable (-1 for none)
+ *
+ * @return The number of periods that passed (more than 1 means we missed some),
+ * 0 if stop_fd fired and -1 on error
+ */
+int periodic_wait(struct periodic_task *task, int stop_fd);
+
+/**
+ * @brief Handles the timer being readable (for when someone else polls it)
+ *
+ * @param task The periodic task whose timer_fd is readable
+ *
+ * @return Number of periods that passed, 0 if it was a spurious wakeup, -1 on
+ * error
+ */
+int periodic_handle_tick(struct periodic_task *task);
+
+/**
+ * @brief Resets the statistics, the timer keeps running
+ *
+ * @param task The periodic task
+ */
+void periodic_reset_stats(struct periodic_task *task);
+
+/**
+ * @brief Logs a one line summary of the timing statistics
+ *
+ * @param task The periodic task
+ * @param task_desc A description of the task
+ */
+void periodic_log_stats(const struct periodic_task *task,
+                        const char *task_desc);
+
+/**
+ * @brief Closes the timer
+ *
+ * @param task The periodic task
+ */
+void periodic_close(struct periodic_task *task);
+
+////////// UTILITY FUNCTIONS /////////
+/**
+ * @brief The current CLOCK_MONOTONIC time in nanoseconds
+ *
+ * @return Nanoseconds
+ */
+int64_t monotonic_ns();
+
+#endif /* end of include guard PERIODIC_H */
@@ -0,0 +1,137 @@
+/**
+ * @file        : probe
+ * @brief Round trip latency probe over the serial link
+ *
+ * Every so often the host sends a PROTO_PING with a nonce and its clock. The
+ * teensy answers with a PROTO_PONG that also has its micros() when it got the
+ * ping, when it next wrote the motors and when it answered. Taking the time
+ * the teensy held on to it out of the round trip leaves the time on the wire
+ * (both ways, radios included).
+ *
+ * The two clocks aren't synced, so splitting that into up and down is an
+ * estimate: the fastest round trip in a window of probes is assumed to be
+ * symmetric, which gives the offset between the clocks. Windows keep the
+ * offset from drifting with the crystals. Up latency plus the teensy's rx to
+ * apply time is what a command takes to reach the motors.
+ *
+ * @created     : Sunday Oct 18, 2026 16:23:48 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef PROBE_H
+
+#define PROBE_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+#include "protocol.h"
+#include "stats.h"
+
+#define PROBE_PERIOD 1.0
+// Seconds, slower than this might as well be off
+#define PROBE_PERIOD_MAX 3600.0
+// Probes per clock offset window
+#define PROBE_WINDOW 16
+// Pongs for a nonce older than this many pings back are ignored
+#define PROBE_MAX_AGE 8
+
+////////// Data Structures //////////
+
+/**
+ * @period_ns     Time between pings, 0 for never
+ * @next_ns       When the next ping is due
+ * @nonce         The next ping's nonce
+ * @sent          Pings sent
+ * @answered      Pongs matched to a ping
+ * @stale         Pongs too old or unknown
+ * @teensy_us     The teensy's clock unwrapped to 64 bits, as of last_rx_us
+ * @last_rx_us    rx_us of the last pong
+ * @offset_ns     Teensy clock minus host clock
+ * @window_rtt_ns Fastest round trip this window
+ * @window_clock  Teensy rx minus host tx for that round trip
+ * @window_count  Probes this window
+ * @last_rtt_ns   Round trip of the last answered ping
+ * @windows       Completed windows
+ * @rtt           Round trip on the wire
+ * @up            Host to teensy
+ * @down          Teensy to host
+ * @apply         Teensy receive to motor write
+ */
+struct latency_probe {
+  int64_t period_ns;
+  int64_t next_ns;
+  uint32_t nonce;
+  uint64_t sent;
+  uint64_t answered;
+  uint64_t stale;
+  int64_t teensy_us;
+  uint32_t last_rx_us;
+  int64_t offset_ns;
+  int64_t window_rtt_ns;
+  int64_t window_clock;
+  int window_count;
+  int64_t last_rtt_ns;
+  int windows;
+  struct histogram rtt;
+  struct histogram up;
+  struct histogram down;
+  struct histogram apply;
+};
+
+/**
+ * @brief Sets up a probe
+ *
+ * @param probe The probe
+ * @param period Seconds between pings, 0 turns the probe off
+ */
+void probe_init(struct latency_probe *probe, double period);
+
+/**
+ * @brief Changes how often pings go out, the one already scheduled stays
+ *
+ * @param probe The probe
+ * @param period Seconds between pings, 0 turns the probe off
+ */
+void probe_set_period(struct latency_probe *probe, double period);
+
+/**
+ * @brief When the next ping is due
+ *
+ * @param probe The probe
+ *
+ * @return CLOCK_MONOTONIC nanoseconds, INT64_MAX when the probe is off
+ */
+int64_t probe_next_ns(const struct latency_probe *probe);
+
+/**
+ * @brief Builds the next ping
+ *
+ * @param probe The probe
+ * @param frame The frame to fill in, seq is left for the writer
+ * @param now_ns CLOCK_MONOTONIC now, goes in the ping
+ */
+void probe_ping(struct latency_probe *probe, struct proto_frame *frame,
+                int64_t now_ns);
+
+/**
+ * @brief Handles a pong
+ *
+ * @param probe The probe
+ * @param pong The pong
+ * @param now_ns CLOCK_MONOTONIC when it arrived
+ *
+ * @return 1 if it answered one of our pings, 0 if it was stale
+ */
+int probe_pong(struct latency_probe *probe, const struct proto_pong *pong,
+               int64_t now_ns);
+
+/**
+ * @brief Logs the histograms
+ *
+ * @param probe The probe
+ */
+void probe_log(const struct latency_probe *probe);
+
+#endif /* end of include guard PROBE_H */
@@ -15,13 +15,13 @@
 #define WII_H
 
 // C Includes
-#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
 // Local Includes
 #include "log.h"
+#include "protocol.h"
 #include "wiiuse.h"
 
 #define MAX_WIIMOTES 1
@@ -36,9 +36,6 @@
 
 ////////// Data Structures //////////
 
-// A lock for when we interact with the robot
-pthread_mutex_t p_lock;
-
 struct robot_s; // Forward declare
 
 // In c++, you would call this a virtual class
@@ -57,6 +54,7 @@ struct drive_train {
 
   int linear_vel;
   int angular_vel;
+  int lateral_vel; // Sideways, right is positive. Only for holonomic chassis
 
   int cruising_speed;
   int speed_increment;
@@ -90,6 +88,21 @@ struct gun {
   int right_mag; // can ish be negative
 };
 
+/**
+ * What the robot last told us about itself
+ *
+ * @report      The last telemetry report from the teensy
+ * @received_ns When it arrived (CLOCK_MONOTONIC), 0 if nothing has yet
+ * @pose        The last pose, only robot-sim sends these
+ * @pose_ns     When it arrived, 0 if nothing has yet
+ */
+struct robot_telemetry {
+  struct proto_telemetry report;
+  int64_t received_ns;
+  struct proto_pose pose;
+  int64_t pose_ns;
+};
+
 // A robot type with all the information a robot needs
 struct robot_s {
   struct peripheral *p;
@@ -100,6 +113,20 @@ struct robot_s {
 
   uint8_t options;
   float period;
+
+  struct robot_telemetry telemetry;
+};
+
+/**
+ * Everything the serial side needs from a robot, copied out by value so it can
+ * be handed to another thread without sharing the robot itself
+ */
+struct robot_command {
+  int linear_vel;
+  int angular_vel;
+  int lateral_vel;
+  int gun_left;
+  int gun_right;
 };
 
 /**
@@ -147,6 +174,15 @@ void robot_unsetopt(struct robot_s *robot, uint8_t option);
  */
 void robot_changeopt(struct robot_s *robot, uint8_t option);
 
+/**
+ * @brief Copies out the robot's current command
+ *
+ * @param robot The robot to read
+ *
+ * @return The command, peripherals the robot doesn't have are 0
+ */
+struct robot_command robot_get_command(const struct robot_s *robot);
+
 /**
  * @brief Creates a default robot
  *
@@ -0,0 +1,77 @@
+/**
+ * @file        : rt_profile
+ * @brief An opt in real time execution profile
+ *
+ * Locks memory, preallocates the heap and puts threads on SCHED_FIFO pinned to
+ * a cpu so other processes on the robot computer can't stall the control
+ * loops. Every step is checked after it's applied and the result is logged,
+ * since most of them quietly fail without root / the right rlimits
+ *
+ * @created     : Sunday Oct 18, 2026 16:09:48 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef RT_PROFILE_H
+
+#define RT_PROFILE_H
+
+// C Includes
+#include <stddef.h>
+
+// Local Includes
+
+#define RT_WII_PRIORITY 80
+#define RT_SERIAL_PRIORITY 79
+#define RT_STACK_PREFAULT (256 * 1024)
+#define RT_HEAP_PREALLOC (4 * 1024 * 1024)
+
+////////// Data Structures //////////
+
+/**
+ * @enabled         0 leaves everything at the default
+ * @wii_priority    SCHED_FIFO priority of the wii (or reactor) thread
+ * @serial_priority SCHED_FIFO priority of the serial thread
+ * @cpu             The cpu to pin the control threads to, -1 for no pinning
+ * @stack_prefault  Bytes of stack to touch at thread start
+ * @heap_prealloc   Bytes of heap to touch and keep at process start
+ */
+struct rt_config {
+  int enabled;
+  int wii_priority;
+  int serial_priority;
+  int cpu;
+  size_t stack_prefault;
+  size_t heap_prealloc;
+};
+
+/**
+ * @brief The default (disabled) profile
+ *
+ * @return A config with enabled set to 0 and the default values above
+ */
+struct rt_config create_rt_config();
+
+/**
+ * @brief Process wide setup: mlockall and heap preallocation
+ * @note Call before creating any threads
+ *
+ * @param config The profile
+ *
+ * @return The number of settings that didn't take effect
+ */
+int rt_process_setup(const struct rt_config *config);
+
+/**
+ * @brief Per thread setup for the calling thread: SCHED_FIFO, cpu pinning and
+ * a prefaulted stack
+ *
+ * @param config The profile
+ * @param thread_desc The thread description for the log
+ * @param priority The SCHED_FIFO priority
+ *
+ * @return The number of settings that didn't take effect
+ */
+int rt_thread_setup(const struct rt_config *config, const char *thread_desc,
+                    int priority);
+
+#endif /* end of include guard RT_PROFILE_H */
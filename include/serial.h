@@ -18,6 +18,8 @@
 #include <unistd.h>
 
 // Local Includes
+#include "log.h"
+#include "serial_baud.h"
 
 //////////////////////////////////// Forward Decleration
 ////////////////////////////////////////
@@ -25,7 +27,7 @@
  * @brief Creates a new serial port opening with some default settings
  *
  * @param port The port to open (ex /dev/ttyUSB)
- * @param baud The baud to communicate with (an int converts to a new baud type
+ * @param baud The baud to communicate with, any rate the driver supports
  *
  * @return The file descriptor
  */
@@ -39,7 +41,8 @@ int new_serial_port(const char *port, int baud) {
   int fd;
   struct termios toptions;
 
-  fd = open(port, O_RDWR | O_NOCTTY);
+  // Reads and writes never block, see serial_writer.h and telemetry.h
+  fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
 
   if (fd == -1) {
     perror("init_serialport error : unable to open port \n");
@@ -48,34 +51,10 @@ int new_serial_port(const char *port, int baud) {
 
   if (tcgetattr(fd, &toptions) < 0) {
     perror("init_serialport error : Couldn't get term attribtues\n");
+    close(fd);
     return -1;
   }
 
-  speed_t brate = baud; // let you override switch below if needed
-  switch (baud) {
-  case 4800:
-    brate = B4800;
-    break;
-  case 9600:
-    brate = B9600;
-    break;
-  case 19200:
-    brate = B19200;
-    break;
-  case 38400:
-    brate = B38400;
-    break;
-  case 57600:
-    brate = B57600;
-    break;
-  case 115200:
-    brate = B115200;
-    break;
-  }
-
-  cfsetispeed(&toptions, brate);
-  cfsetospeed(&toptions, brate);
-
   // Options
   toptions.c_cflag &= ~PARENB;
   toptions.c_cflag &= ~CSTOPB;
@@ -93,8 +72,18 @@ int new_serial_port(const char *port, int baud) {
   toptions.c_cc[VTIME] = 20;
   if (tcsetattr(fd, TCSANOW, &toptions) < 0) {
     perror("init_serialport: Couldn't set term attributes");
+    close(fd);
+    return -1;
+  }
+
+  // Any rate the driver can do, not just the Bxxx ones
+  if (serial_set_baud(fd, baud)) {
+    close(fd);
     return -1;
   }
+  // Nice to have, not every driver does it (ptys don't)
+  if (serial_low_latency(fd))
+    log_info("%s: no low latency mode", port);
   return fd;
 }
 
@@ -0,0 +1,54 @@
+/**
+ * @file        : serial_baud
+ * @brief Any baud rate and low latency mode for a serial port
+ *
+ * termios only knows the Bxxx constants, so anything else goes through
+ * termios2 with BOTHER, which takes the rate as a plain number. The kernel's
+ * termios2 header can't be included next to <termios.h>, which is why this
+ * has its own file and works on a bare fd.
+ *
+ * @created     : Sunday Oct 18, 2026 16:30:54 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef SERIAL_BAUD_H
+
+#define SERIAL_BAUD_H
+
+// C Includes
+
+// Local Includes
+
+/**
+ * @brief Sets the input and output baud to any rate the driver can do
+ * @note Reads the rate back, a driver that can't hit it closely enough is an
+ * error
+ *
+ * @param fd The serial fd
+ * @param baud The rate
+ *
+ * @return 0 on success, -1 on error
+ */
+int serial_set_baud(int fd, int baud);
+
+/**
+ * @brief The output baud the port is actually running at
+ *
+ * @param fd The serial fd
+ *
+ * @return The rate, -1 on error
+ */
+int serial_get_baud(int fd);
+
+/**
+ * @brief Turns on ASYNC_LOW_LATENCY
+ * @note On FTDI adapters this drops the latency timer from 16 ms to 1 ms, so
+ * small frames don't sit in the adapter waiting for more
+ *
+ * @param fd The serial fd
+ *
+ * @return 0 on success, -1 if the driver doesn't support it
+ */
+int serial_low_latency(int fd);
+
+#endif /* end of include guard SERIAL_BAUD_H */
@@ -0,0 +1,179 @@
+/**
+ * @file        : serial_writer
+ * @brief A non blocking frame writer that never lets commands pile up
+ *
+ * The serial is opened O_NONBLOCK, so write() takes what fits and we finish
+ * the frame later. A new frame only starts once the tty's output queue
+ * (TIOCOUTQ) is down to max_queued bytes, so the kernel never sits on a
+ * backlog of old commands. Until then the newest frame waits in a single
+ * pending slot, and anything newer replaces it: when the link is congested
+ * the stale commands are dropped instead of sent late.
+ *
+ * The writer stamps seq when a frame actually starts going out, so frames
+ * that were replaced never leave a gap for the teensy to count as lost.
+ *
+ * @created     : Sunday Oct 18, 2026 16:26:43 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef SERIAL_WRITER_H
+
+#define SERIAL_WRITER_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Local Includes
+#include "protocol.h"
+#include "xbee.h"
+
+// Bytes the kernel can hold before we stop starting new frames
+#define SERIAL_MAX_QUEUED 0
+// Room for a frame, or an xbee packet of them
+#define SERIAL_WRITER_BUF XBEE_MAX_FRAME
+
+// What serial_writer_flush returns
+#define SERIAL_WRITER_IDLE 0
+#define SERIAL_WRITER_STARTED 1
+#define SERIAL_WRITER_BUSY 2
+
+////////// Data Structures //////////
+
+/**
+ * The frame that most recently started going out
+ *
+ * @type         Frame type
+ * @seq          The seq it got
+ * @submitted_ns When it was submitted
+ */
+struct serial_sent {
+  uint8_t type;
+  uint8_t seq;
+  int64_t submitted_ns;
+};
+
+/**
+ * @fd            The serial, O_NONBLOCK
+ * @xbee          API mode transport, NULL for transparent (raw frames)
+ * @max_queued    Start a new frame only with this many bytes queued or less
+ * @byte_ns       Time to send one byte at the configured baud
+ * @seq           seq of the next frame to go out
+ * @pending       The frame waiting for room
+ * @has_pending   Set when pending holds a frame
+ * @pending_ns    When pending was submitted
+ * @buf           The frame (or xbee packet) going out right now
+ * @len           Bytes in buf
+ * @off           Bytes of buf already written
+ * @retry_ns      When to try again while something is waiting, 0 for now
+ * @sent          The last frame that started going out
+ * @frames        Frames started
+ * @replaced      Frames dropped for a newer one before they went out
+ * @partial       Writes that only took part of a frame
+ * @held          Times a frame had to wait for the queue to drain
+ * @written       Bytes write() took, the tx policy measures the link off it
+ */
+struct serial_writer {
+  int fd;
+  struct xbee_link *xbee;
+  int max_queued;
+  int64_t byte_ns;
+  uint8_t seq;
+  struct proto_frame pending;
+  int has_pending;
+  int64_t pending_ns;
+  uint8_t buf[SERIAL_WRITER_BUF];
+  size_t len;
+  size_t off;
+  int64_t retry_ns;
+  struct serial_sent sent;
+  uint64_t frames;
+  uint64_t replaced;
+  uint64_t partial;
+  uint64_t held;
+  uint64_t written;
+};
+
+/**
+ * @brief Sets up a writer
+ *
+ * @param writer The writer
+ * @param fd The serial (should be O_NONBLOCK), -1 for none
+ * @param baud The serial baud, to guess how long the queue takes to drain
+ * @param max_queued See SERIAL_MAX_QUEUED
+ * @param xbee API mode transport, NULL for transparent
+ */
+void serial_writer_init(struct serial_writer *writer, int fd, int baud,
+                        int max_queued, struct xbee_link *xbee);
+
+/**
+ * @brief Points the writer at a new serial (after a reconnect)
+ * @note Whatever was waiting for the old one is dropped, seq and the counters
+ * carry on
+ *
+ * @param writer The writer
+ * @param fd The serial (should be O_NONBLOCK), -1 for none
+ * @param baud The serial baud
+ */
+void serial_writer_reopen(struct serial_writer *writer, int fd, int baud);
+
+/**
+ * @brief Bytes waiting in the tty's output queue
+ *
+ * @param writer The writer
+ *
+ * @return Bytes, -1 if unknown
+ */
+int serial_writer_queued(const struct serial_writer *writer);
+
+/**
+ * @brief When a frame submitted would go out right away
+ *
+ * @param writer The writer
+ *
+ * @return CLOCK_MONOTONIC nanoseconds (0 for now), INT64_MAX while a frame is
+ * still waiting
+ */
+int64_t serial_writer_ready_ns(const struct serial_writer *writer);
+
+/**
+ * @brief Submits a frame, replacing one that hasn't started going out yet
+ * @note Call serial_writer_flush after
+ *
+ * @param writer The writer
+ * @param frame The frame, its seq is ignored
+ * @param now_ns CLOCK_MONOTONIC now
+ *
+ * @return Encoded size of the frame
+ */
+size_t serial_writer_submit(struct serial_writer *writer,
+                            const struct proto_frame *frame, int64_t now_ns);
+
+/**
+ * @brief Writes as much as the tty takes without blocking
+ *
+ * @param writer The writer
+ *
+ * @return SERIAL_WRITER_STARTED if a new frame started going out (see sent),
+ * SERIAL_WRITER_BUSY if something is still waiting, SERIAL_WRITER_IDLE if
+ * everything is out, -1 on a write error
+ */
+int serial_writer_flush(struct serial_writer *writer);
+
+/**
+ * @brief When serial_writer_flush is worth calling again
+ *
+ * @param writer The writer
+ *
+ * @return CLOCK_MONOTONIC nanoseconds, INT64_MAX if nothing is waiting
+ */
+int64_t serial_writer_next_ns(const struct serial_writer *writer);
+
+/**
+ * @brief Logs what the writer did
+ *
+ * @param writer The writer
+ */
+void serial_writer_log(const struct serial_writer *writer);
+
+#endif /* end of include guard SERIAL_WRITER_H */
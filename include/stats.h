@@ -0,0 +1,121 @@
+/**
+ * @file        : stats
+ * @brief Running statistics for timing measurements
+ *
+ * Keeps min / max / mean / standard deviation of a stream of samples without
+ * storing them (Welford's method), so it's cheap enough to update every loop.
+ * When the shape matters (tails, more than one mode) there's also a fixed
+ * size log2 histogram
+ *
+ * @created     : Sunday Oct 18, 2026 16:08:39 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef STATS_H
+
+#define STATS_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+
+#define HISTOGRAM_BUCKETS 24
+
+////////// Data Structures //////////
+
+/**
+ * @count Number of samples
+ * @min   Smallest sample
+ * @max   Largest sample
+ * @mean  Running mean
+ * @m2    Running sum of squared differences from the mean
+ */
+struct running_stats {
+  uint64_t count;
+  int64_t min;
+  int64_t max;
+  double mean;
+  double m2;
+};
+
+/**
+ * A log2 histogram of nanosecond samples with microsecond buckets. Bucket 0 is
+ * under 1 us, bucket i is [2^(i-1), 2^i) us, and the last one takes
+ * everything bigger
+ *
+ * @counts Samples per bucket
+ * @stats  Exact min / max / mean of the same samples
+ */
+struct histogram {
+  uint64_t counts[HISTOGRAM_BUCKETS];
+  struct running_stats stats;
+};
+
+/**
+ * @brief Clears all samples
+ *
+ * @param stats The stats to reset
+ */
+void stats_reset(struct running_stats *stats);
+
+/**
+ * @brief Adds a sample
+ *
+ * @param stats The stats to add to
+ * @param value The sample
+ */
+void stats_add(struct running_stats *stats, int64_t value);
+
+/**
+ * @brief The sample standard deviation
+ *
+ * @param stats The stats to read
+ *
+ * @return The standard deviation, 0 with less than two samples
+ */
+double stats_stddev(const struct running_stats *stats);
+
+/**
+ * @brief Logs a one line summary, treating samples as nanoseconds
+ *
+ * @param stats The stats to log
+ * @param desc What was measured
+ */
+void stats_log_ns(const struct running_stats *stats, const char *desc);
+
+/**
+ * @brief Clears a histogram
+ *
+ * @param hist The histogram
+ */
+void histogram_reset(struct histogram *hist);
+
+/**
+ * @brief Adds a sample, negative samples go in bucket 0
+ *
+ * @param hist The histogram
+ * @param ns The sample in nanoseconds
+ */
+void histogram_add(struct histogram *hist, int64_t ns);
+
+/**
+ * @brief An upper bound on a percentile
+ *
+ * @param hist The histogram
+ * @param percent 0 to 100
+ *
+ * @return The top of the bucket the percentile falls in, in nanoseconds (0 if
+ * empty)
+ */
+int64_t histogram_percentile(const struct histogram *hist, double percent);
+
+/**
+ * @brief Logs the stats, a few percentiles and the non empty buckets
+ *
+ * @param hist The histogram
+ * @param desc What was measured
+ */
+void histogram_log_ns(const struct histogram *hist, const char *desc);
+
+#endif /* end of include guard STATS_H */
@@ -0,0 +1,140 @@
+/**
+ * @file        : telemetry
+ * @brief Reads the teensy's telemetry reports off the serial
+ *
+ * The teensy sends a PROTO_TELEMETRY frame every so often with what it
+ * actually wrote to the motors, its loop timing, its receive error counters
+ * and the supply voltage. The reader only ever reads what's already there, so
+ * it can sit in the same loop that sends commands. Since each report echoes
+ * the seq of the last command applied, matching it against when we sent that
+ * seq gives a send to apply time, and the teensy's error counters going up
+ * is how we notice a link that's dropping frames. Pongs are handed to the
+ * latency probe (see probe.h), and poses from the simulator (tests/robot_sim)
+ * go out with the reports. The teensy also times its own stages and sends
+ * one stage's numbers at a time when it has nothing better to send, those
+ * are added up per stage for the summary. With an xbee in API mode the frames come
+ * wrapped in Receive Packets, which the reader unwraps first (see xbee.h).
+ *
+ * @created     : Sunday Oct 18, 2026 16:20:52 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef TELEMETRY_H
+
+#define TELEMETRY_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+#include "probe.h"
+#include "protocol.h"
+#include "robot_control.h"
+#include "stats.h"
+#include "xbee.h"
+
+// Bytes read per wakeup, a few reports worth
+#define TELEMETRY_READ_SIZE 256
+
+// Warn when the teensy had this many bytes waiting in Serial1, half its ring.
+// Past the ring the uart drops them
+#define TELEMETRY_RX_PEAK_WARN 512
+
+////////// Data Structures //////////
+
+/**
+ * One firmware stage, every PROTO_PERF for it added up. In cpu cycles
+ *
+ * @runs   Times it ran
+ * @cycles All of them together
+ * @min    Shortest run
+ * @max    Longest run
+ * @hist   Runs per bucket, see PROTO_PERF_SHIFT
+ */
+struct telemetry_perf {
+  uint64_t runs;
+  uint64_t cycles;
+  uint32_t min;
+  uint32_t max;
+  uint64_t hist[PROTO_PERF_BUCKETS];
+};
+
+/**
+ * @decoder       Frame decoder for everything the teensy sends
+ * @frame         The frame being decoded
+ * @latest        The latest report and when it came in
+ * @reports       Telemetry reports received
+ * @poses         Pose frames received
+ * @perf_frames   Stage timing frames received
+ * @other_frames  Good frames that weren't telemetry, poses, timings or pongs
+ * @probe         Gets the pongs, can be NULL
+ * @xbee          Unwraps API mode packets, NULL for transparent
+ * @sent_ns       When each drive seq went out, 0 once it's been matched
+ * @apply_ns      Time from sending a command to a report saying it was
+ * applied. Reports only come every so often so this is an upper bound
+ * @min_supply_mv Lowest supply voltage reported
+ * @busy_max_us   Longest teensy control tick reported
+ * @perf          Each teensy stage's timings
+ * @mhz           The teensy's cycles per microsecond
+ * @rx_peak       Most bytes the teensy has had waiting in Serial1
+ */
+struct telemetry_reader {
+  struct proto_decoder decoder;
+  struct proto_frame frame;
+  struct robot_telemetry latest;
+  uint64_t reports;
+  uint64_t poses;
+  uint64_t perf_frames;
+  uint64_t other_frames;
+  struct latency_probe *probe;
+  struct xbee_link *xbee;
+  int64_t sent_ns[UINT8_MAX + 1];
+  struct running_stats apply_ns;
+  uint16_t min_supply_mv;
+  uint16_t busy_max_us;
+  struct telemetry_perf perf[PROTO_PERF_STAGES];
+  uint16_t mhz;
+  uint16_t rx_peak;
+};
+
+/**
+ * @brief Sets up a reader
+ *
+ * @param reader The reader
+ * @param probe The latency probe to hand pongs to, NULL to ignore them
+ * @param xbee The API mode link (shared with the writer), NULL for transparent
+ */
+void telemetry_init(struct telemetry_reader *reader,
+                    struct latency_probe *probe, struct xbee_link *xbee);
+
+/**
+ * @brief Records when a drive frame was sent
+ *
+ * @param reader The reader
+ * @param seq The frame's seq
+ * @param now_ns CLOCK_MONOTONIC now
+ */
+void telemetry_sent(struct telemetry_reader *reader, uint8_t seq,
+                    int64_t now_ns);
+
+/**
+ * @brief Reads whatever the serial has and decodes it
+ * @note The serial is O_NONBLOCK so this never blocks, call it when fd is
+ * readable
+ *
+ * @param reader The reader
+ * @param fd The serial fd
+ *
+ * @return Number of new reports and poses (the last of each is in latest), -1
+ * on a read error
+ */
+int telemetry_read(struct telemetry_reader *reader, int fd);
+
+/**
+ * @brief Logs a summary of everything received, with a line per teensy stage
+ *
+ * @param reader The reader
+ */
+void telemetry_log(const struct telemetry_reader *reader);
+
+#endif /* end of include guard TELEMETRY_H */
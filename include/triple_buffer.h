@@ -0,0 +1,91 @@
+/**
+ * @file        : triple_buffer
+ * @brief A lock free single writer / single reader snapshot
+ *
+ * Three slots: the writer owns one (back), the reader owns one (front) and the
+ * third (middle) is swapped atomically between them. The writer fills its
+ * slot and publishes it in one exchange, the reader grabs the newest published
+ * slot in one exchange. Nobody ever waits and nobody ever sees a half written
+ * value.
+ *
+ * @created     : Sunday Oct 18, 2026 16:11:03 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef TRIPLE_BUFFER_H
+
+#define TRIPLE_BUFFER_H
+
+// C Includes
+#include <stdatomic.h>
+#include <stddef.h>
+
+// Local Includes
+
+#define TB_INDEX_MASK 0x3
+#define TB_FRESH 0x4
+
+////////// Data Structures //////////
+
+/**
+ * @slots  3 * size bytes of storage
+ * @size   The size of one slot
+ * @middle The shared slot index, ORed with TB_FRESH when the reader hasn't
+ * seen it yet
+ * @back   Writer owned slot index
+ * @front  Reader owned slot index
+ */
+struct triple_buffer {
+  unsigned char *slots;
+  size_t size;
+  atomic_uint middle;
+  unsigned back;
+  unsigned front;
+};
+
+/**
+ * @brief Sets up a triple buffer over caller owned storage
+ *
+ * @param tb The triple buffer
+ * @param slots Storage for three values (ex struct thing slots[3])
+ * @param size The size of one value
+ * @param initial The value all three slots start as
+ */
+void triple_buffer_init(struct triple_buffer *tb, void *slots, size_t size,
+                        const void *initial);
+
+/**
+ * @brief The writer's slot, fill this in then call triple_buffer_publish
+ *
+ * @param tb The triple buffer
+ *
+ * @return The writer's slot
+ */
+void *triple_buffer_back(struct triple_buffer *tb);
+
+/**
+ * @brief Publishes the writer's slot (writer side only)
+ *
+ * @param tb The triple buffer
+ */
+void triple_buffer_publish(struct triple_buffer *tb);
+
+/**
+ * @brief Takes the newest published slot if there is one (reader side only)
+ *
+ * @param tb The triple buffer
+ *
+ * @return 1 if the front changed, 0 if nothing new was published
+ */
+int triple_buffer_update(struct triple_buffer *tb);
+
+/**
+ * @brief The reader's slot, stays valid until the next triple_buffer_update
+ *
+ * @param tb The triple buffer
+ *
+ * @return The reader's slot
+ */
+const void *triple_buffer_front(const struct triple_buffer *tb);
+
+#endif /* end of include guard TRIPLE_BUFFER_H */
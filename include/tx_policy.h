@@ -0,0 +1,170 @@
+/**
+ * @file        : tx_policy
+ * @brief Decides when the serial side sends a command
+ *
+ * A changed command goes out right away, as long as it has been at least
+ * spacing since the last send. When nothing changes we only send a keepalive
+ * every so often. spacing adapts to the link: it never drops below the
+ * configured minimum, and never below the time the link actually needs to
+ * drain a frame, so we don't queue commands faster than they can leave.
+ *
+ * The link rate starts out as the baud and is then measured off the tty's
+ * output queue (TIOCOUTQ) and the bytes the writer has actually handed to
+ * write(). Between two samples the bytes that left the tty are what was
+ * written in between plus what the queue went down by. While a frame drains
+ * the queue is sampled every TX_SAMPLE. Two samples with bytes still queued
+ * and nothing written in between say how fast the link really goes, so the
+ * estimate can come down, otherwise the link was idle for part of it and it
+ * is only at least that fast. Either way the estimate never goes past what
+ * the baud can carry.
+ *
+ * @created     : Sunday Oct 18, 2026 16:16:20 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef TX_POLICY_H
+
+#define TX_POLICY_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Local Includes
+
+// How much slower than the measured link rate we send, at most
+#define TX_HEADROOM 1.5
+// Weight of a new throughput sample
+#define TX_EWMA_WEIGHT 0.2
+// Seconds between output queue samples while a frame drains
+#define TX_SAMPLE 0.002
+
+////////// Data Structures //////////
+
+/**
+ * @min_spacing_ns  Never send two frames closer than this
+ * @keepalive_ns    Resend an unchanged command this often
+ * @spacing_ns      Current spacing, min_spacing_ns or more if the link is slow
+ * @last_send_ns    When we last sent (0 before the first send)
+ * @last_bytes      Size of the last frame sent
+ * @last_sample_ns  When the output queue was last sampled
+ * @last_queued     Bytes in the output queue at the last sample
+ * @last_written    The writer's bytes written at the last sample
+ * @pending         A changed command hasn't gone out yet
+ * @bytes_per_sec   Estimated link throughput
+ * @line_rate       Most the baud can carry, bytes a second
+ * @samples         Drain rate samples taken with the queue busy throughout
+ * @frames          Frames sent
+ * @keepalives      Frames sent without a change
+ * @changes         Times the command changed
+ */
+struct tx_policy {
+  int64_t min_spacing_ns;
+  int64_t keepalive_ns;
+  int64_t spacing_ns;
+  int64_t last_send_ns;
+  size_t last_bytes;
+  int64_t last_sample_ns;
+  int last_queued;
+  uint64_t last_written;
+  int pending;
+  double bytes_per_sec;
+  double line_rate;
+  uint64_t samples;
+  uint64_t frames;
+  uint64_t keepalives;
+  uint64_t changes;
+};
+
+/**
+ * @brief Sets up a policy
+ *
+ * @param policy The policy
+ * @param min_spacing Minimum seconds between frames
+ * @param keepalive Seconds between frames when nothing changes
+ * @param baud The serial baud, the first guess at throughput (10 bits a byte)
+ */
+void tx_policy_init(struct tx_policy *policy, double min_spacing,
+                    double keepalive, int baud);
+
+/**
+ * @brief Starts the throughput estimate over at a new baud
+ *
+ * @param policy The policy
+ * @param baud The serial baud
+ */
+void tx_policy_set_baud(struct tx_policy *policy, int baud);
+
+/**
+ * @brief Changes the minimum spacing, for when the link can't take as much
+ *
+ * @param policy The policy
+ * @param min_spacing Minimum seconds between frames
+ */
+void tx_policy_set_min_spacing(struct tx_policy *policy, double min_spacing);
+
+/**
+ * @brief Tells the policy the command changed
+ *
+ * @param policy The policy
+ */
+void tx_policy_changed(struct tx_policy *policy);
+
+/**
+ * @brief Whether we should send now
+ *
+ * @param policy The policy
+ * @param now_ns CLOCK_MONOTONIC now
+ *
+ * @return 1 to send, 0 to wait
+ */
+int tx_policy_due(const struct tx_policy *policy, int64_t now_ns);
+
+/**
+ * @brief When the next send could be due, for picking a poll timeout
+ *
+ * @param policy The policy
+ *
+ * @return CLOCK_MONOTONIC nanoseconds
+ */
+int64_t tx_policy_next_ns(const struct tx_policy *policy);
+
+/**
+ * @brief When the output queue should be sampled next
+ *
+ * @param policy The policy
+ * @param written The writer's bytes written so far
+ *
+ * @return CLOCK_MONOTONIC nanoseconds (0 for now), INT64_MAX when nothing is
+ * draining
+ */
+int64_t tx_policy_sample_ns(const struct tx_policy *policy, uint64_t written);
+
+/**
+ * @brief Records an output queue sample and updates the throughput estimate
+ *
+ * @param policy The policy
+ * @param now_ns CLOCK_MONOTONIC now
+ * @param queued Bytes in the output queue (from TIOCOUTQ), -1 if unknown
+ * @param written The writer's bytes written so far
+ */
+void tx_policy_drained(struct tx_policy *policy, int64_t now_ns, int queued,
+                       uint64_t written);
+
+/**
+ * @brief Records a send
+ *
+ * @param policy The policy
+ * @param now_ns CLOCK_MONOTONIC now
+ * @param bytes Size of the frame sent, the spacing is worked out from it
+ */
+void tx_policy_sent(struct tx_policy *policy, int64_t now_ns, size_t bytes);
+
+/**
+ * @brief Logs what the policy did
+ *
+ * @param policy The policy
+ */
+void tx_policy_log(const struct tx_policy *policy);
+
+#endif /* end of include guard TX_POLICY_H */
@@ -14,25 +14,55 @@
 
 // C Includes
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 #include <wiiuse.h>
 
 // Local Includes
+#include "baud_upgrade.h"
+#include "hotplug.h"
 #include "kermit.h"
+#include "link_monitor.h"
 #include "log.h"
+#include "periodic.h"
+#include "probe.h"
+#include "protocol.h"
 #include "robot_control.h"
+#include "rt_profile.h"
 #include "serial.h"
+#include "serial_writer.h"
+#include "stats.h"
+#include "telemetry.h"
+#include "triple_buffer.h"
+#include "tx_policy.h"
 #include "wii_controller.h"
+#include "xbee.h"
 
-#define DRIVE 'd'
-#define STOP 's'
-#define TRIGGER 't'
+// A changed command goes out right away, but never closer together than this
+#define SERIAL_MIN_SPACING 0.01
+// An unchanged command is resent this often so the teensy knows we're alive
+#define SERIAL_KEEPALIVE 0.25
 
-#define SERIAL_PERIOD 0.1
-#define PERIOD_CONV 1000000
+#define REACTOR_MAX_EVENTS 8
+
+// What woke the serial thread up (see wait_serial)
+#define SERIAL_WAKE_COMMAND (1 << 0)
+#define SERIAL_WAKE_READ (1 << 1)
+#define SERIAL_WAKE_HANGUP (1 << 2)
+
+// Configuration the teensy gets whenever the link (re)starts (see
+// serial_config)
+#define CONFIG_LIMITS (1 << 0)
+#define CONFIG_MIXER (1 << 1)
 
 /////////////////////////////////////////// Globals
 ///////////////////////////////////////////////////
@@ -43,34 +73,101 @@
  * @scan_signal A signal triggered ON to stop a scanner
  * @running     A signal triggered off to stop a running serial / wii remote
  * thread
+ * @caught_signal The last signal recieved, logged once the threads are joined
  */
-volatile int scan_signal;
-volatile int running;
+volatile sig_atomic_t scan_signal;
+volatile sig_atomic_t running;
+volatile sig_atomic_t caught_signal;
 
 /**
  * Thread synchronizers
  *
- * The serial thread waits until wii is ready
- * and the wii thread waits for the serial thread
+ * These are eventfds. Once written they are never read back, so they stay
+ * readable and every poll on them returns right away from then on. A thread
+ * blocked on one sleeps in the kernel instead of spinning.
+ *
+ * @shutdown_event     Written on SIGINT / SIGTERM or a fatal error
+ * @wii_ready_event    Written by the wii thread once a wiimote connects
+ * @serial_ready_event Written by the serial thread once it has a port
+ * @command_event      Written by the wii thread when it publishes a new
+ * command. This one is the exception, the serial thread clears it
+ */
+int shutdown_event;
+int wii_ready_event;
+int serial_ready_event;
+int command_event;
+
+/**
+ * Input to serial latency benchmark
+ *
+ * @last_input_ns The oldest handled input that hasn't been written to the
+ * serial yet (0 if there is none). Set by the wii side, taken by the serial
+ * side
+ * @input_latency Time from handling input to writing the command, only touched
+ * by the serial side
+ */
+_Atomic int64_t last_input_ns;
+struct running_stats input_latency;
+
+/**
+ * Execution profile
+ *
+ * @rt_profile    The real time profile the threads apply to themselves
+ * @jitter_report Seconds between loop timing reports, 0 only reports on exit
  */
-volatile int wii_ready;
-volatile int serial_ready;
+struct rt_config rt_profile;
+double jitter_report;
+
+/**
+ * Serial link
+ *
+ * @probe_period Seconds between latency probes, 0 turns them off
+ * @max_baud     Fastest baud to negotiate up to, 0 stays at the scan baud
+ * @port_match   The USB adapter to use, empty takes the first port that opens
+ * @xbee_api     The port is an xbee in API mode (AP=1), not a transparent link
+ * @xbee_dest    64 bit address of the teensy's radio
+ * @xbee_retries Times to resend a packet the radio couldn't deliver
+ * @motion_limits Slew / jerk limits and watchdog timeout for the teensy
+ * @drive_mixer  How the teensy mixes vx / vy / omega into the drive motors
+ * @send_config  What serial_config sends whenever the link (re)starts,
+ * CONFIG_LIMITS when motion_limits were given (otherwise the teensy keeps its
+ * defaults) and always CONFIG_MIXER
+ * @wheel_speed  mm/s a full command asks of each wheel, the teensy holds it
+ * off its encoders. 0 sends raw throttles instead
+ * @full_command The drive train's max_speed, what a full command is
+ */
+double probe_period;
+int max_baud;
+struct serial_match port_match;
+int xbee_api;
+uint64_t xbee_dest;
+int xbee_retries;
+struct proto_limits motion_limits;
+struct proto_mixer drive_mixer;
+int send_config;
+int wheel_speed;
+int full_command;
 
 /**
  * The main global robot data structure element
  *
- * This is the only shared data structure that could feature race conditions
- * I declare it here to denote that (I don't need it global, but it helps to
- * see which data is subjected to race conditions)
+ * Only the wii thread (or the reactor) touches this once things are running.
+ * The serial thread reads the command the wii thread publishes to
+ * command_buffer instead, which needs no lock and can't tear. Telemetry goes
+ * the other way through telemetry_buffer
  */
 struct robot_s robot_main;
+struct robot_command command_slots[3];
+struct triple_buffer command_buffer;
+struct robot_telemetry telemetry_slots[3];
+struct triple_buffer telemetry_buffer;
 
 //////////////////////////////////////////// Data Strucutres
 ///////////////////////////////////////////
 // Context for writing to the serial
 struct serial_context {
   int fd;
-  struct robot_s robot;
+  int debug;
 };
 
 struct robot_context {
@@ -86,15 +183,100 @@ struct port_context {
   const int size;
   const int baud;
   const int num_ports_to_scan;
+  const struct serial_match *match; // Which adapter, see hotplug.h
 };
 
 ////////////////////////////////////////// Forward Declaration
 ///////////////////////////////////////////
 
+/**
+ * @brief Creates the shutdown and ready events
+ *
+ * @return 0 on success, -1 if an eventfd couldn't be created
+ */
+int init_events();
+
+/**
+ * @brief Closes the events created by init_events
+ */
+void close_events();
+
+/**
+ * @brief Marks an event as happened, waking everyone waiting on it
+ *
+ * @note Only uses write, so this is safe to call from a signal handler
+ *
+ * @param event The eventfd to signal
+ */
+void signal_event(int event);
+
+/**
+ * @brief Resets an event so it can be waited on again
+ *
+ * @param event The eventfd to clear
+ */
+void clear_event(int event);
+
+/**
+ * @brief Blocks until event is signaled, a shutdown is requested or timeout_ms
+ * passes
+ *
+ * @param event The eventfd to wait on
+ * @param timeout_ms Milliseconds to wait, -1 waits forever
+ *
+ * @return 1 if the event happened, 0 on shutdown or timeout
+ */
+int wait_event(int event, int timeout_ms);
+
+/**
+ * @brief Blocks until there's a new command, the serial has something to
+ * read, a shutdown is requested or timeout_ms passes
+ *
+ * @param fd The serial fd (-1 to only wait for commands)
+ * @param timeout_ms Milliseconds to wait, -1 waits forever
+ *
+ * @return SERIAL_WAKE_* flags for what happened, 0 on shutdown or timeout
+ */
+int wait_serial(int fd, int timeout_ms);
+
+/**
+ * @brief Sleeps, but wakes up early if a shutdown is requested
+ *
+ * @param timeout_ms Milliseconds to sleep
+ *
+ * @return 1 if we slept the whole time, 0 if a shutdown was requested
+ */
+int shutdown_sleep(int timeout_ms);
+
+/**
+ * @brief Stops both threads and wakes them up wherever they are blocked
+ *
+ * @note Safe to call from a signal handler
+ */
+void request_shutdown();
+
+/**
+ * @brief Marks that input changed the command, for the latency benchmark
+ */
+void mark_input();
+
+/**
+ * @brief Marks that the latest command was written, for the latency benchmark
+ */
+void mark_sent();
+
+/**
+ * @brief Logs and resets a loop's timing stats every jitter_report seconds
+ *
+ * @param task The loop's periodic task
+ * @param task_desc The loop description
+ */
+void report_jitter(struct periodic_task *task, const char *task_desc);
+
 /**
  * @brief Handle Signals
  *
- * @note For now, it just sets both scan_signal and running
+ * @note For now, it just requests a shutdown
  * In the future though, this is were we would define conditions for the
  * type of signal
  *
@@ -102,7 +284,7 @@ struct port_context {
  * signal(SIGINT, signal_handler); // or another signal
  * @param signal The signal recieved
  */
-void signal_hander(int signal);
+void signal_handler(int signal);
 
 /**
  * @brief Scans a single prefix through specified ranges
@@ -111,34 +293,241 @@ void signal_hander(int signal);
  * @param baud Serial baud - default 9600
  * @param num_ports_to_scan Number of ports to scan (ex "/dev/ttyUSB0 -
  * /dev/ttyUSB29" is 30)
+ * @param match Only ports on this adapter
  *
  * @return The file descriptor this cannot be used alone because you must close
- * fd
+ * fd, -1 if nothing opened
  */
 int scan_serial(const char *const prefix, const int baud,
-                int num_ports_to_scan);
+                int num_ports_to_scan, const struct serial_match *match);
+
+/**
+ * @brief One pass over every prefix, doesn't wait
+ *
+ * @param ports The port_context
+ *
+ * @return The fd to the new port, -1 if nothing opened
+ */
+int scan_ports(const struct port_context *ports);
+
+/**
+ * @brief Sleeps until a tty is plugged in, the timeout or shutdown
+ *
+ * @param hotplug The uevent socket, closed and set to -1 if it breaks (-1 just
+ * sleeps)
+ * @param timeout_ms The timeout
+ * @param port Set to the tty that was added
+ * @param len Size of port
+ *
+ * @return 1 if a tty was added, 0 on timeout, -1 on shutdown
+ */
+int wait_port(int *hotplug, int timeout_ms, char *port, size_t len);
 
 /**
  * @brief Scans serial ports with a list of prefixes
  * @note, this is almost a serial function because I was origionally going to
- * make it one, but alas nah
+ * make it one, but alas nah. Between passes it sleeps on uevents, so a port
+ * that gets plugged in is opened right away
  *
  * @param context A port_context struct
  *
- * @return The fd to the new port, mst be closed
+ * @return The fd to the new port, mst be closed. -1 on shutdown
  */
 int serial_scanner_thread(void *context);
 
+/**
+ * @brief Gets a freshly opened port ready: baud negotiation (-B) and the
+ * writer
+ *
+ * @param fd The new port
+ * @param ports The port_context
+ * @param writer The serial writer
+ *
+ * @return The baud the link ended up at
+ */
+int link_start(int fd, const struct port_context *ports,
+               struct serial_writer *writer);
+
+/**
+ * @brief Renegotiates a link that was lost at a faster baud
+ * @note The teensy falls back to BAUD on its own after a second without a
+ * good frame, so a link lost above the starting baud may never come back
+ * there. Goes back to the starting baud, waits out the teensy's revert and
+ * upgrades again. Blocks for a few seconds, the robot is stopped anyway
+ *
+ * @param fd The port
+ * @param ports The port_context
+ * @param writer The serial writer
+ * @param policy The tx policy, starts over at the new baud
+ *
+ * @return The baud the link ended up at
+ */
+int link_rebaud(int fd, const struct port_context *ports,
+                struct serial_writer *writer, struct tx_policy *policy);
+
+/**
+ * @brief Sets up the xbee link if the port is a radio in API mode (-x)
+ *
+ * @param xbee The link to set up
+ *
+ * @return xbee for the writer and reader, NULL for a transparent link
+ */
+struct xbee_link *link_xbee(struct xbee_link *xbee);
+
+/**
+ * @brief Closes a port that went away, the writer waits with no port
+ *
+ * @param fd The port
+ * @param ports The port_context
+ * @param writer The serial writer
+ */
+void link_drop(int fd, const struct port_context *ports,
+               struct serial_writer *writer);
+
+/**
+ * @brief Drops the port and blocks until it (or another match) is back
+ *
+ * @param fd The port that went away
+ * @param ports The port_context
+ * @param writer The serial writer
+ * @param baud Set to the baud the new link ended up at
+ *
+ * @return The new port, -1 on shutdown
+ */
+int serial_reconnect(int fd, const struct port_context *ports,
+                     struct serial_writer *writer, int *baud);
+
 /**
  * @brief The robot command to write to the serial //TODO this probably doesn't
  * belong here
+ * @note Submits one PROTO_DRIVE frame, or a PROTO_VELOCITY frame with
+ * wheel_speed set, see protocol.h and serial_writer.h
+ *
+ * @param writer The serial writer
+ * @param command The command to send
+ * @param now_ns CLOCK_MONOTONIC now
+ *
+ * @return Encoded size of the frame
+ */
+size_t write_to_serial(struct serial_writer *writer,
+                       const struct robot_command *command, int64_t now_ns);
+
+/**
+ * @brief Submits the command if the tx policy says it's time
+ *
+ * @param policy The tx policy
+ * @param writer The serial writer
+ * @param command The command to send
+ * @param debug Don't actually write anything
+ *
+ * @return 1 if it was time to send, 0 otherwise
+ */
+int serial_tx(struct tx_policy *policy, struct serial_writer *writer,
+              const struct robot_command *command, int debug);
+
+/**
+ * @brief Samples the tty's output queue for the tx policy if a sample is due
+ *
+ * @param policy The tx policy
+ * @param writer The serial writer
+ */
+void serial_drain(struct tx_policy *policy, const struct serial_writer *writer);
+
+/**
+ * @brief Submits a latency probe ping if one is due and the writer is free
  *
- * @param msg A string message, for now, I'm just treating this like a single
- * char
- * @param fd The file to write to
- * @param robot The robot to get data from
+ * @param probe The probe
+ * @param writer The serial writer
+ *
+ * @return 1 if a ping was submitted, 0 otherwise
  */
-void write_to_serial(char *msg, int fd, struct robot_s *robot);
+int serial_probe(struct latency_probe *probe, struct serial_writer *writer);
+
+/**
+ * @brief Submits the next configuration frame that's due, if the writer is free
+ *
+ * @param due CONFIG_ bits the teensy still needs, each cleared once submitted
+ * @param writer The serial writer
+ *
+ * @return 1 if a frame was submitted, 0 otherwise
+ */
+int serial_config(int *due, struct serial_writer *writer);
+
+/**
+ * @brief Writes whatever the writer has waiting
+ * @note -1 means the port is gone, see serial_reconnect
+ *
+ * @param writer The serial writer
+ * @param reader The telemetry reader, told when each command went out
+ *
+ * @return See serial_writer_flush
+ */
+int serial_flush(struct serial_writer *writer,
+                 struct telemetry_reader *reader);
+
+/**
+ * @brief Updates the link monitor and, when the link changes state, slows
+ * commands and probes down or brings them back
+ *
+ * @param monitor The link monitor
+ * @param policy The tx policy
+ * @param probe The latency probe
+ * @param reader The telemetry reader
+ * @param writer The serial writer
+ *
+ * @return 1 if the link just came back from lost (the teensy might have
+ * restarted and forgotten the limits), 0 otherwise
+ */
+int link_check(struct link_monitor *monitor, struct tx_policy *policy,
+                struct latency_probe *probe,
+                const struct telemetry_reader *reader,
+                const struct serial_writer *writer);
+
+/**
+ * @brief The command to send, a stop while the link monitor says so
+ *
+ * @param monitor The link monitor
+ * @param command The command we'd like to send
+ *
+ * @return command or a stop
+ */
+const struct robot_command *link_command(struct link_monitor *monitor,
+                                         const struct robot_command *command);
+
+/**
+ * @brief Milliseconds until the serial side has something to do
+ *
+ * @param policy The tx policy
+ * @param writer The serial writer
+ * @param probe The latency probe
+ *
+ * @return A poll timeout, rounded up
+ */
+int serial_timeout(const struct tx_policy *policy,
+                   const struct serial_writer *writer,
+                   const struct latency_probe *probe);
+
+/**
+ * @brief Publishes robot_main's command for the serial thread if it changed
+ * @note Only the wii thread calls this
+ *
+ * @param input Whether the change came from wiimote input
+ */
+void publish_command(int input);
+
+/**
+ * @brief Hands the latest telemetry report to the wii thread
+ * @note Only the serial thread calls this
+ *
+ * @param telemetry The report
+ */
+void publish_telemetry(const struct robot_telemetry *telemetry);
+
+/**
+ * @brief Copies the latest published telemetry into robot_main
+ * @note Only the wii thread calls this
+ */
+void take_telemetry();
 
 /**
  * @brief The main serial thread
@@ -167,6 +556,20 @@ wiimote **scan_wii();
  */
 void *wii_thread(void *);
 
+/**
+ * @brief The single threaded alternative to wii_thread + serial_thread
+ * @note Everything runs from one epoll set: the wiimote sockets, the serial
+ * fd (for telemetry), a timerfd for the control tick and a signalfd for shutdown. Since only
+ * this thread touches robot_main nothing needs a lock. A command changed by
+ * input goes out straight away, anything else on the next tick (see
+ * tx_policy.h)
+ *
+ * @param context The port_context
+ *
+ * @return Make the compiler happy
+ */
+void *reactor_thread(void *context);
+
 /**
  * @brief A helper for thread management
  *
@@ -193,16 +596,111 @@ int thread_joiner(pthread_t *thread, const char *thread_desc);
 //////////////////////////////////////////////////// Func Definicitons
 ///////////////////////////////////
 
-void signal_handler(int sig) {
-  pthread_mutex_lock(&p_lock);
-  log_info("Recieved signal: %d", sig);
+int init_events() {
+  shutdown_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  wii_ready_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  serial_ready_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  command_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (shutdown_event == -1 || wii_ready_event == -1 ||
+      serial_ready_event == -1 || command_event == -1) {
+    log_error("Error %d creating events: %s", errno, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+void close_events() {
+  close(shutdown_event);
+  close(wii_ready_event);
+  close(serial_ready_event);
+  close(command_event);
+}
+
+void signal_event(int event) {
+  uint64_t one = 1;
+  // Can only fail if the counter would overflow, which means it's already set
+  if (write(event, &one, sizeof(one)) == -1)
+    return;
+}
+
+void clear_event(int event) {
+  uint64_t count;
+  // EAGAIN just means it was already clear
+  if (read(event, &count, sizeof(count)) == -1)
+    return;
+}
+
+int wait_event(int event, int timeout_ms) {
+  struct pollfd fds[2] = {{event, POLLIN, 0}, {shutdown_event, POLLIN, 0}};
+  int ret;
+
+  do {
+    ret = poll(fds, 2, timeout_ms);
+  } while (ret == -1 && errno == EINTR && running);
+
+  if (ret > 0 && (fds[0].revents & POLLIN))
+    return 1;
+  return 0;
+}
+
+int wait_serial(int fd, int timeout_ms) {
+  struct pollfd fds[3] = {{command_event, POLLIN, 0},
+                          {shutdown_event, POLLIN, 0},
+                          {fd, POLLIN, 0}}; // poll skips it if fd is -1
+  int wake = 0;
+  int ret;
+
+  do {
+    ret = poll(fds, 3, timeout_ms);
+  } while (ret == -1 && errno == EINTR && running);
+
+  if (ret <= 0)
+    return 0;
+  if (fds[0].revents & POLLIN)
+    wake |= SERIAL_WAKE_COMMAND;
+  if (fds[2].revents & POLLIN)
+    wake |= SERIAL_WAKE_READ;
+  if (fds[2].revents & (POLLHUP | POLLERR))
+    wake |= SERIAL_WAKE_HANGUP;
+  return wake;
+}
+
+int shutdown_sleep(int timeout_ms) {
+  return !wait_event(shutdown_event, timeout_ms);
+}
+
+void request_shutdown() {
   scan_signal = 1;
   running = 0;
-  pthread_mutex_unlock(&p_lock);
+  signal_event(shutdown_event);
+}
+
+void mark_input() {
+  int64_t none = 0;
+  atomic_compare_exchange_strong(&last_input_ns, &none, monotonic_ns());
+}
+
+void mark_sent() {
+  int64_t input = atomic_exchange(&last_input_ns, 0);
+  if (input)
+    stats_add(&input_latency, monotonic_ns() - input);
+}
+
+void report_jitter(struct periodic_task *task, const char *task_desc) {
+  if (jitter_report > 0 &&
+      task->stats.late_ns.count * task->period_ns >= jitter_report * 1e9) {
+    periodic_log_stats(task, task_desc);
+    periodic_reset_stats(task);
+  }
+}
+
+void signal_handler(int sig) {
+  caught_signal = sig;
+  request_shutdown();
 }
 
 int scan_serial(const char *const prefix, const int baud,
-                int num_ports_to_scan) {
+                int num_ports_to_scan, const struct serial_match *match) {
   int fd;
   int size;
 
@@ -218,78 +716,309 @@ int scan_serial(const char *const prefix, const int baud,
 
   for (i = 0; i < num_ports_to_scan && !scan_signal; ++i) {
     sprintf(port, "%s%d", prefix, i);
+    if (!serial_match_port(match, port))
+      continue;
     fd = new_serial_port(port, baud);
-    if (fd != -1)
+    if (fd != -1) {
+      log_info("Opened %s", port);
       return fd; // A try catch might be better here
+    }
   }
+  return -1;
+}
+
+int scan_ports(const struct port_context *ports) {
+  int fd = -1;
+  for (int i = 0; i < ports->size && fd == -1 && !scan_signal; ++i)
+    fd = scan_serial(ports->prefixes[i], ports->baud,
+                     ports->num_ports_to_scan, ports->match);
   return fd;
 }
 
+int wait_port(int *hotplug, int timeout_ms, char *port, size_t len) {
+  struct pollfd fds[2] = {{shutdown_event, POLLIN, 0}, {*hotplug, POLLIN, 0}};
+  int ret;
+
+  do {
+    ret = poll(fds, 2, timeout_ms);
+  } while (ret == -1 && errno == EINTR && running);
+
+  if (ret == -1 || (fds[0].revents & POLLIN) || !running)
+    return -1;
+  if (ret == 0 || !(fds[1].revents & POLLIN))
+    return 0;
+  ret = hotplug_read(*hotplug, port, len);
+  if (ret == -1) {
+    // Still rescans every HOTPLUG_RESCAN_MS without it
+    close(*hotplug);
+    *hotplug = -1;
+    return 0;
+  }
+  return ret;
+}
+
 int serial_scanner_thread(void *context) {
   struct port_context *prefixes_to_scan = (struct port_context *)context;
-  int fd;
+  char added[HOTPLUG_MAX_PORT];
+  int hotplug = hotplug_open();
+  int retries = 0;
+  int fd = -1;
 
-  int size = prefixes_to_scan->size;
-  int baud = prefixes_to_scan->baud;
   int num_ports = prefixes_to_scan->num_ports_to_scan;
 
-  do {
-    for (int i = 0; i < size && fd == -1; ++i) {
-      fd = scan_serial(prefixes_to_scan->prefixes[i], baud, num_ports);
-      if (scan_signal) {
-        return -1;
-      }
+  // Open the socket before the first pass so nothing plugged in during it is
+  // missed
+  while ((fd = scan_ports(prefixes_to_scan)) == -1 && !scan_signal) {
+    if (!retries)
       log_info("Scanned %d ports", num_ports);
-      sleep(1);
+    switch (wait_port(&hotplug, retries ? HOTPLUG_RETRY_MS : HOTPLUG_RESCAN_MS,
+                      added, sizeof(added))) {
+    case -1:
+      request_shutdown();
+      break;
+    case 1:
+      log_info("%s plugged in", added[0] ? added : "A tty was");
+      retries = HOTPLUG_RETRIES;
+      break;
+    default:
+      if (retries)
+        retries--;
+      break;
     }
-  } while (fd == -1);
+  }
+  if (hotplug != -1)
+    close(hotplug);
   if (scan_signal) {
+    if (fd != -1)
+      close(fd);
     return -1;
   }
-  serial_ready = 1;
+  signal_event(serial_ready_event);
+  return fd;
+}
+
+int link_start(int fd, const struct port_context *ports,
+               struct serial_writer *writer) {
+  int baud = ports->baud;
+  if (max_baud)
+    baud = baud_upgrade(fd, shutdown_event, baud, max_baud, &writer->seq);
+  serial_writer_reopen(writer, fd, baud);
+  return baud;
+}
+
+int link_rebaud(int fd, const struct port_context *ports,
+                struct serial_writer *writer, struct tx_policy *policy) {
+  int baud;
+
+  log_warn("Baud: link lost above %d, going back to renegotiate", ports->baud);
+  if (baud_revert(fd, shutdown_event, ports->baud))
+    log_error("Baud: couldn't go back to %d", ports->baud);
+  baud = link_start(fd, ports, writer);
+  tx_policy_set_baud(policy, baud);
+  return baud;
+}
+
+struct xbee_link *link_xbee(struct xbee_link *xbee) {
+  if (!xbee_api)
+    return NULL;
+  xbee_init(xbee, xbee_dest, xbee_retries, XBEE_STATUS_TIMEOUT);
+  return xbee;
+}
+
+void link_drop(int fd, const struct port_context *ports,
+               struct serial_writer *writer) {
+  log_warn("Lost the serial port, waiting for it to come back");
+  close(fd);
+  serial_writer_reopen(writer, -1, ports->baud);
+}
+
+int serial_reconnect(int fd, const struct port_context *ports,
+                     struct serial_writer *writer, int *baud) {
+  link_drop(fd, ports, writer);
+  fd = serial_scanner_thread((void *)ports);
+  if (fd != -1)
+    *baud = link_start(fd, ports, writer);
   return fd;
 }
 
 // This will change
-void write_to_serial(char *msg, int fd, struct robot_s *robot) {
-  int ret;
-  msg[0] = DRIVE;
-  msg[1] = 2 * robot->drive->linear_vel;
-  msg[2] = 2 * robot->drive->angular_vel;
-  msg[3] = 2 * robot->gun->left_mag;
-  msg[4] = 2 * robot->gun->right_mag;
+size_t write_to_serial(struct serial_writer *writer,
+                       const struct robot_command *command, int64_t now_ns) {
+  struct proto_frame frame;
+  struct proto_drive drive;
+  struct proto_velocity velocity;
+  int left = command->linear_vel + command->angular_vel;
+  int right = command->linear_vel - command->angular_vel;
+
+  // The teensy's tank mix, in wheel speeds
+  if (wheel_speed && full_command) {
+    velocity.speed[0] = constrain(-wheel_speed,
+                                  left * wheel_speed / full_command,
+                                  wheel_speed);
+    velocity.speed[1] = constrain(-wheel_speed,
+                                  right * wheel_speed / full_command,
+                                  wheel_speed);
+    velocity.gun1 = constrain(INT8_MIN, 2 * command->gun_left, INT8_MAX);
+    velocity.gun2 = constrain(INT8_MIN, 2 * command->gun_right, INT8_MAX);
+    proto_pack_velocity(&frame, 0, &velocity);
+    return serial_writer_submit(writer, &frame, now_ns);
+  }
+
+  drive.vx = constrain(INT8_MIN, 2 * command->linear_vel, INT8_MAX);
+  drive.vy = constrain(INT8_MIN, 2 * command->lateral_vel, INT8_MAX);
+  drive.omega = constrain(INT8_MIN, 2 * command->angular_vel, INT8_MAX);
+  drive.gun1 = constrain(INT8_MIN, 2 * command->gun_left, INT8_MAX);
+  drive.gun2 = constrain(INT8_MIN, 2 * command->gun_right, INT8_MAX);
+  proto_pack_drive(&frame, 0, &drive); // The writer stamps seq
+  return serial_writer_submit(writer, &frame, now_ns);
+}
+
+int serial_tx(struct tx_policy *policy, struct serial_writer *writer,
+              const struct robot_command *command, int debug) {
+  int64_t now = monotonic_ns();
+  size_t bytes = 0;
 
-  ret = write(fd, msg, 5);
+  if (!tx_policy_due(policy, now))
+    return 0;
 
+  if (!debug)
+    bytes = write_to_serial(writer, command, now);
+  else
+    mark_sent(); // Nothing is written, so it's as sent as it gets
+  tx_policy_sent(policy, now, bytes);
+  return 1;
+}
+
+void serial_drain(struct tx_policy *policy,
+                  const struct serial_writer *writer) {
+  int64_t now = monotonic_ns();
+
+  if (writer->fd != -1 && now >= tx_policy_sample_ns(policy, writer->written))
+    tx_policy_drained(policy, now, serial_writer_queued(writer),
+                      writer->written);
+}
+
+int serial_probe(struct latency_probe *probe, struct serial_writer *writer) {
+  struct proto_frame frame;
+  int64_t now = monotonic_ns();
+
+  // A ping stuck behind a command would time the queue, not the link
+  if (writer->fd == -1 || now < probe_next_ns(probe) ||
+      now < serial_writer_ready_ns(writer))
+    return 0;
+  probe_ping(probe, &frame, now);
+  serial_writer_submit(writer, &frame, now);
+  return 1;
+}
+
+int serial_config(int *due, struct serial_writer *writer) {
+  struct proto_frame frame;
+  int64_t now = monotonic_ns();
+
+  // Same as a ping, nothing can replace it before it goes out
+  if (!*due || writer->fd == -1 || now < serial_writer_ready_ns(writer))
+    return 0;
+  if (*due & CONFIG_LIMITS) {
+    proto_pack_limits(&frame, 0, &motion_limits);
+    *due &= ~CONFIG_LIMITS;
+  } else {
+    proto_pack_mixer(&frame, 0, &drive_mixer);
+    *due &= ~CONFIG_MIXER;
+  }
+  serial_writer_submit(writer, &frame, now);
+  return 1;
+}
+
+int serial_flush(struct serial_writer *writer,
+                 struct telemetry_reader *reader) {
+  int ret;
+
+  if (writer->fd == -1)
+    return SERIAL_WRITER_IDLE;
+  ret = serial_writer_flush(writer);
   if (ret == -1) {
-    // https://linux.die.net/man/2/write
-    switch (errno) {
-    case EBADF: {
-      log_error("Error %d closing fd and exiting safely: %s", errno,
-                strerror(errno));
-      running = 0;
-      break;
-    }
-    case EIO: {
-      log_error("Error %d: %s", errno, strerror(errno));
-      log_info("Trying one more time for input output error");
-      if (write(fd, msg, 5) == -1) {
-        log_error("Failed again with error %d, exiting thread", errno);
-        running = 0;
-      }
-      break;
-    }
-    default: {
-      log_error("Error %d: %s", errno, strerror(errno));
-      log_info("Trying one more time");
-      if (write(fd, msg, 3) == -1) {
-        log_info("Failed again with error %d, exiting thread", errno);
-        running = 0;
-      }
-      break;
-    }
-    }
+    log_warn("Couldn't write to the serial");
+  } else if (ret == SERIAL_WRITER_STARTED &&
+             proto_is_command(writer->sent.type)) {
+    telemetry_sent(reader, writer->sent.seq, writer->sent.submitted_ns);
+    mark_sent();
   }
+  return ret;
+}
+
+int link_check(struct link_monitor *monitor, struct tx_policy *policy,
+               struct latency_probe *probe,
+               const struct telemetry_reader *reader,
+               const struct serial_writer *writer) {
+  enum link_state prev = monitor->state;
+  int slowdown;
+
+  if (!link_monitor_update(monitor, monotonic_ns(), reader, probe, writer))
+    return 0;
+  slowdown = link_monitor_slowdown(monitor);
+  tx_policy_set_min_spacing(policy, SERIAL_MIN_SPACING * slowdown);
+  probe_set_period(probe, probe_period * slowdown);
+  // A stop (or the command again) goes out right away
+  tx_policy_changed(policy);
+  return prev == LINK_LOST;
+}
+
+const struct robot_command *link_command(struct link_monitor *monitor,
+                                         const struct robot_command *command) {
+  static const struct robot_command stop = {0, 0, 0, 0, 0};
+  int neutral =
+      !command->linear_vel && !command->angular_vel && !command->lateral_vel;
+  return link_monitor_stopped(monitor, neutral) ? &stop : command;
+}
+
+int serial_timeout(const struct tx_policy *policy,
+                   const struct serial_writer *writer,
+                   const struct latency_probe *probe) {
+  int64_t next = tx_policy_next_ns(policy);
+  int64_t ping = probe_next_ns(probe);
+  int64_t wait_ns;
+
+  if (serial_writer_next_ns(writer) < next)
+    next = serial_writer_next_ns(writer);
+  if (writer->fd != -1 && tx_policy_sample_ns(policy, writer->written) < next)
+    next = tx_policy_sample_ns(policy, writer->written);
+  if (ping < next && serial_writer_ready_ns(writer) > ping)
+    ping = serial_writer_ready_ns(writer);
+  if (ping < next)
+    next = ping;
+  wait_ns = next - monotonic_ns();
+  return wait_ns > 0 ? (wait_ns + 999999) / 1000000 : 0;
+}
+
+void publish_command(int input) {
+  // The command buffer starts out as the robot's starting command, which is
+  // all zeros
+  static struct robot_command published = {0, 0, 0, 0, 0};
+  struct robot_command command = robot_get_command(&robot_main);
+  struct robot_command *back;
+
+  if (!memcmp(&command, &published, sizeof(command)))
+    return;
+
+  back = triple_buffer_back(&command_buffer);
+  *back = command;
+  if (input)
+    mark_input();
+  triple_buffer_publish(&command_buffer);
+  published = command;
+  signal_event(command_event);
+}
+
+void publish_telemetry(const struct robot_telemetry *telemetry) {
+  struct robot_telemetry *back = triple_buffer_back(&telemetry_buffer);
+  *back = *telemetry;
+  triple_buffer_publish(&telemetry_buffer);
+}
+
+void take_telemetry() {
+  if (triple_buffer_update(&telemetry_buffer))
+    robot_main.telemetry = *(const struct robot_telemetry *)triple_buffer_front(
+        &telemetry_buffer);
 }
 
 void *serial_thread(void *context) {
@@ -297,7 +1026,14 @@ void *serial_thread(void *context) {
   struct port_context *port_cont = (struct port_context *)context;
   int fd = -1;
 
-  if (!(robot_main.options & DEBUG)) {
+  // DEBUG can't change at runtime, and the wii thread doesn't start changing
+  // options until we're ready, so this is the one safe look at robot_main
+  int debug = robot_main.options & DEBUG;
+
+  rt_thread_setup(&rt_profile, "Serial Communication",
+                  rt_profile.serial_priority);
+
+  if (!debug) {
     // Underlying file descriptor
     fd = serial_scanner_thread(port_cont);
     if (fd != -1)
@@ -305,21 +1041,95 @@ void *serial_thread(void *context) {
     else
       log_error("Invalid file desc");
   } else {
-    serial_ready = 1;
+    signal_event(serial_ready_event);
   }
-  struct serial_context cont = {fd, robot_main};
+  struct serial_context cont = {fd, debug};
+  struct tx_policy policy;
+  struct serial_writer writer;
+  struct latency_probe probe;
+  struct telemetry_reader reader;
+  struct xbee_link xbee;
+  struct xbee_link *radio = link_xbee(&xbee);
+  struct link_monitor monitor;
+  int baud = port_cont->baud;
+  int config_due = send_config;
+  int64_t baud_ns = 0;
+  int lost = 0;
+  int wake;
+
+  serial_writer_init(&writer, -1, baud, SERIAL_MAX_QUEUED, radio);
+  if (cont.fd != -1)
+    baud = link_start(cont.fd, port_cont, &writer);
+  tx_policy_init(&policy, SERIAL_MIN_SPACING, SERIAL_KEEPALIVE, baud);
+  probe_init(&probe, cont.debug ? 0 : probe_period); // Nothing would answer
+  telemetry_init(&reader, &probe, radio);
 
-  char msg[5];
-  for (; running && !wii_ready;)
-    ;
+  // Sleeps until the wii thread is ready (or we get told to stop)
+  wait_event(wii_ready_event, -1);
+  link_monitor_init(&monitor, !cont.debug, monotonic_ns());
   while (running) {
-    if (!(cont.robot.options & DEBUG)) {
-      write_to_serial(msg, cont.fd, &robot_main); // handles errors here
+    // Sleep until there's a new command or telemetry, the next send is due or
+    // shutdown
+    wake = wait_serial(cont.fd, serial_timeout(&policy, &writer, &probe));
+    if (wake & SERIAL_WAKE_COMMAND) {
+      clear_event(command_event);
+      if (triple_buffer_update(&command_buffer))
+        tx_policy_changed(&policy);
+    }
+    if (wake & (SERIAL_WAKE_READ | SERIAL_WAKE_HANGUP)) {
+      switch (telemetry_read(&reader, cont.fd)) {
+      case -1:
+        lost = 1;
+        break;
+      case 0:
+        lost = wake & SERIAL_WAKE_HANGUP;
+        break;
+      default:
+        publish_telemetry(&reader.latest);
+        break;
+      }
+    }
+    if (running && !lost) {
+      if (link_check(&monitor, &policy, &probe, &reader, &writer))
+        config_due = send_config;
+      // Only a link that worked at this baud since it was negotiated, a
+      // fresh one hasn't had a chance to report yet
+      if (cont.fd != -1 && monitor.state == LINK_LOST &&
+          baud != port_cont->baud && reader.latest.received_ns > baud_ns) {
+        baud = link_rebaud(cont.fd, port_cont, &writer, &policy);
+        baud_ns = monotonic_ns();
+      }
+      serial_drain(&policy, &writer);
+      serial_tx(&policy, &writer,
+                link_command(&monitor, triple_buffer_front(&command_buffer)),
+                cont.debug);
+      if (!serial_probe(&probe, &writer))
+        serial_config(&config_due, &writer);
+      lost = serial_flush(&writer, &reader) == -1;
+    }
+    if (running && lost) {
+      // Commands keep landing in the triple buffer, the newest goes out once
+      // the port is back
+      cont.fd = serial_reconnect(cont.fd, port_cont, &writer, &baud);
+      lost = 0;
+      // A replug can be quicker than LINK_LOST_GAP, and the teensy on the
+      // other end may have restarted with its defaults either way
+      if (cont.fd != -1) {
+        tx_policy_set_baud(&policy, baud);
+        baud_ns = monotonic_ns();
+        config_due = send_config;
+      }
     }
-    usleep(SERIAL_PERIOD * PERIOD_CONV);
   }
-  if (!(robot_main.options & DEBUG))
-    close(fd);
+  tx_policy_log(&policy);
+  serial_writer_log(&writer);
+  telemetry_log(&reader);
+  if (radio)
+    xbee_log(radio);
+  probe_log(&probe);
+  link_monitor_log(&monitor, monotonic_ns());
+  if (cont.fd != -1)
+    close(cont.fd);
   log_info("Safely closed file descriptor");
   return NULL;
 }
@@ -331,36 +1141,316 @@ wiimote **scan_wii() {
     if (scan_signal) {
       return NULL;
     }
-    sleep(1);
+    if (!wiimotes && !shutdown_sleep(1000))
+      return NULL;
   } while (!wiimotes);
   if (scan_signal) {
     return NULL;
   }
-  wii_ready = 1;
+  signal_event(wii_ready_event);
   return wiimotes;
 }
 
 void *wii_thread(void *context) {
 
+  rt_thread_setup(&rt_profile, "Wii Controller", rt_profile.wii_priority);
+
   // Create new wiimotes by scanning - this should never by nullptr
   wiimote **wiimotes = scan_wii();
 
   struct controller_s controller = kermit_controller();
 
   struct robot_context robot_cont = {&robot_main, &controller, wiimotes};
+  struct periodic_task tick;
 
   // Wait for serial to be ready
-  for (; running && !serial_ready;)
-    ;
+  wait_event(serial_ready_event, -1);
+  if (periodic_init(&tick, robot_cont.robot->period))
+    request_shutdown();
   while (running && heart_beat(robot_cont.wiimotes, 1)) {
-    event_loop(robot_cont.wiimotes, robot_cont.robot, robot_cont.controller);
-    usleep(robot_cont.robot->period * PERIOD_CONV);
+    take_telemetry();
+    publish_command(event_loop(robot_cont.wiimotes, robot_cont.robot,
+                               robot_cont.controller));
+    if (periodic_wait(&tick, shutdown_event) <= 0)
+      break;
+    report_jitter(&tick, "Wii loop");
   }
+  periodic_log_stats(&tick, "Wii loop");
+  periodic_close(&tick);
   if (wiimotes)
     wiiuse_cleanup(robot_cont.wiimotes, 1); // change number later, I'm lazy
   return NULL;
 }
 
+// Sends robot_main's command if it changed or a keepalive is due, -1 if the
+// port is gone
+static int reactor_tx(struct tx_policy *policy, struct serial_writer *writer,
+                      struct telemetry_reader *reader,
+                      struct link_monitor *monitor,
+                      struct robot_command *last, int input) {
+  struct robot_command command = robot_get_command(&robot_main);
+  if (memcmp(&command, last, sizeof(command))) {
+    if (input)
+      mark_input();
+    *last = command;
+    tx_policy_changed(policy);
+  }
+  serial_tx(policy, writer, link_command(monitor, &command),
+            robot_main.options & DEBUG);
+  return serial_flush(writer, reader) == -1 ? -1 : 0;
+}
+
+enum reactor_source {
+  REACTOR_SIGNAL,
+  REACTOR_SHUTDOWN,
+  REACTOR_TICK,
+  REACTOR_SERIAL,
+  REACTOR_WIIMOTE,
+  REACTOR_HOTPLUG
+};
+
+static int reactor_watch(int epfd, int fd, uint32_t events,
+                         enum reactor_source source) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.u64 = source;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+    log_error("Error %d watching fd %d: %s", errno, fd, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+void *reactor_thread(void *context) {
+  struct port_context *port_cont = (struct port_context *)context;
+  struct controller_s controller = kermit_controller();
+  struct periodic_task tick;
+  struct epoll_event events[REACTOR_MAX_EVENTS];
+  struct signalfd_siginfo info;
+  struct robot_command last_command = robot_get_command(&robot_main);
+  struct tx_policy policy;
+  struct serial_writer writer;
+  struct latency_probe probe;
+  struct telemetry_reader reader;
+  struct xbee_link xbee;
+  struct xbee_link *radio = link_xbee(&xbee);
+  struct link_monitor monitor;
+  char added[HOTPLUG_MAX_PORT];
+  int baud = port_cont->baud;
+  int reconnect = !(robot_main.options & DEBUG);
+  int config_due = send_config;
+  int64_t baud_ns = 0;
+  int64_t rescan_ns = 0;
+  int retries = 0;
+  int lost = 0;
+  int input = 0;
+  sigset_t mask;
+  wiimote **wiimotes;
+  int fd = -1;
+  int hotplug = -1;
+  int sig_fd = -1;
+  int epfd = -1;
+  int i, n;
+
+  rt_thread_setup(&rt_profile, "Reactor", rt_profile.wii_priority);
+
+  // Scanning still relies on the signal handler to be interrupted
+  if (!(robot_main.options & DEBUG)) {
+    fd = serial_scanner_thread(port_cont);
+    if (fd != -1)
+      log_info("Successfully found fd");
+    else
+      log_error("Invalid file desc");
+  }
+  serial_writer_init(&writer, -1, baud, SERIAL_MAX_QUEUED, radio);
+  if (fd != -1)
+    baud = link_start(fd, port_cont, &writer);
+  wiimotes = scan_wii();
+  tx_policy_init(&policy, SERIAL_MIN_SPACING, SERIAL_KEEPALIVE, baud);
+  probe_init(&probe, fd == -1 ? 0 : probe_period);
+  telemetry_init(&reader, &probe, radio);
+  link_monitor_init(&monitor, reconnect, monotonic_ns());
+
+  // From here on signals are read from the signalfd instead
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+
+  memset(&tick, 0, sizeof(tick));
+  tick.timer_fd = -1;
+  sig_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (sig_fd == -1 || epfd == -1 || periodic_init(&tick, robot_main.period) ||
+      reactor_watch(epfd, sig_fd, EPOLLIN, REACTOR_SIGNAL) ||
+      reactor_watch(epfd, shutdown_event, EPOLLIN, REACTOR_SHUTDOWN) ||
+      reactor_watch(epfd, tick.timer_fd, EPOLLIN, REACTOR_TICK)) {
+    log_error("Couldn't set up the reactor");
+    request_shutdown();
+  }
+
+  // Telemetry, errors and hangups (the last two are always reported)
+  if (running && fd != -1 && reactor_watch(epfd, fd, EPOLLIN, REACTOR_SERIAL))
+    request_shutdown();
+  // Tells us right away when the port comes back after a hangup
+  if (running && reconnect && (hotplug = hotplug_open()) != -1 &&
+      reactor_watch(epfd, hotplug, EPOLLIN, REACTOR_HOTPLUG))
+    request_shutdown();
+  for (i = 0; running && wiimotes && i < MAX_WIIMOTES; ++i)
+    if (wiimotes[i] && WIIMOTE_IS_CONNECTED(wiimotes[i]) &&
+        reactor_watch(epfd, wiimotes[i]->in_sock, EPOLLIN, REACTOR_WIIMOTE))
+      request_shutdown();
+
+  while (running && heart_beat(wiimotes, 1)) {
+    n = epoll_wait(epfd, events, REACTOR_MAX_EVENTS, -1);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      log_error("Error %d in epoll_wait: %s", errno, strerror(errno));
+      break;
+    }
+
+    for (i = 0; i < n; ++i) {
+      switch (events[i].data.u64) {
+      case REACTOR_SIGNAL: {
+        if (read(sig_fd, &info, sizeof(info)) == sizeof(info))
+          caught_signal = info.ssi_signo;
+        request_shutdown();
+        break;
+      }
+      case REACTOR_SHUTDOWN: {
+        // running is already 0, the loop ends after this batch
+        break;
+      }
+      case REACTOR_WIIMOTE: {
+        // Some input only shows up in the command after the next loop
+        if (poll_controller(wiimotes, &robot_main, &controller)) {
+          input = 1;
+          if (reactor_tx(&policy, &writer, &reader, &monitor, &last_command,
+                         input))
+            lost = 1;
+        }
+        break;
+      }
+      case REACTOR_SERIAL: {
+        if (lost)
+          break;
+        switch (telemetry_read(&reader, fd)) {
+        case -1:
+          lost = 1;
+          break;
+        case 0:
+          lost = (events[i].events & (EPOLLHUP | EPOLLERR)) != 0;
+          break;
+        default:
+          robot_main.telemetry = reader.latest;
+          break;
+        }
+        if (link_check(&monitor, &policy, &probe, &reader, &writer))
+          config_due = send_config;
+        // A transmit status frees the radio for the next packet
+        if (radio && !lost && serial_flush(&writer, &reader) == -1)
+          lost = 1;
+        break;
+      }
+      case REACTOR_TICK: {
+        if (periodic_handle_tick(&tick) <= 0)
+          break;
+        print_state(&robot_main, &controller);
+        (*robot_main.p->loop)(&robot_main);
+        // Notices a link that went quiet
+        if (link_check(&monitor, &policy, &probe, &reader, &writer))
+          config_due = send_config;
+        // Same as serial_thread
+        if (fd != -1 && monitor.state == LINK_LOST &&
+            baud != port_cont->baud && reader.latest.received_ns > baud_ns) {
+          baud = link_rebaud(fd, port_cont, &writer, &policy);
+          baud_ns = monotonic_ns();
+        }
+        serial_drain(&policy, &writer);
+        // Also picks up anything the writer was holding back
+        if (reactor_tx(&policy, &writer, &reader, &monitor, &last_command,
+                       input) ||
+            ((serial_probe(&probe, &writer) ||
+              serial_config(&config_due, &writer)) &&
+             serial_flush(&writer, &reader) == -1))
+          lost = 1;
+        input = 0;
+        report_jitter(&tick, "Reactor loop");
+
+        // One quick pass per tick at most, opening a port doesn't block
+        if (reconnect && fd == -1 && monotonic_ns() >= rescan_ns) {
+          fd = scan_ports(port_cont);
+          if (fd != -1) {
+            // Same as serial_thread, the teensy may have restarted
+            baud = link_start(fd, port_cont, &writer);
+            tx_policy_set_baud(&policy, baud);
+            baud_ns = monotonic_ns();
+            config_due = send_config;
+            if (reactor_watch(epfd, fd, EPOLLIN, REACTOR_SERIAL))
+              request_shutdown();
+          } else {
+            rescan_ns = monotonic_ns() +
+                        (retries ? HOTPLUG_RETRY_MS : HOTPLUG_RESCAN_MS) *
+                            1000000LL;
+            if (retries)
+              retries--;
+          }
+        }
+        break;
+      }
+      case REACTOR_HOTPLUG: {
+        switch (hotplug_read(hotplug, added, sizeof(added))) {
+        case -1:
+          // Closing it takes it out of the epoll, the tick still rescans
+          close(hotplug);
+          hotplug = -1;
+          break;
+        case 1:
+          if (fd == -1) {
+            log_info("%s plugged in", added[0] ? added : "A tty was");
+            rescan_ns = 0;
+            retries = HOTPLUG_RETRIES;
+          }
+          break;
+        }
+        break;
+      }
+      }
+    }
+
+    // After the batch, so nothing else in it uses the old fd
+    if (lost && fd != -1) {
+      link_drop(fd, port_cont, &writer);
+      fd = -1;
+      rescan_ns = 0;
+    }
+    lost = 0;
+  }
+
+  periodic_log_stats(&tick, "Reactor loop");
+  tx_policy_log(&policy);
+  serial_writer_log(&writer);
+  telemetry_log(&reader);
+  if (radio)
+    xbee_log(radio);
+  probe_log(&probe);
+  link_monitor_log(&monitor, monotonic_ns());
+  periodic_close(&tick);
+  if (epfd != -1)
+    close(epfd);
+  if (sig_fd != -1)
+    close(sig_fd);
+  if (hotplug != -1)
+    close(hotplug);
+  if (wiimotes)
+    wiiuse_cleanup(wiimotes, MAX_WIIMOTES);
+  if (fd != -1)
+    close(fd);
+  log_info("Safely closed file descriptor");
+  return NULL;
+}
+
 int thread_creator(pthread_t *thread, void *context, const char *thread_desc,
                    void *(*thread_fnc)(void *)) {
   if (pthread_create(thread, NULL, thread_fnc, context)) {
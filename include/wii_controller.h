@@ -142,6 +142,26 @@ wiimote **wiimote_init();
  */
 short heart_beat(wiimote **wm, int num_wiimotes);
 
+/**
+ * @brief Polls the wiimotes and runs the callbacks for any input
+ *
+ * @param wiimotes The wiimote array
+ * @param robot The robot to do stuff to
+ * @param controller The Controller structure
+ *
+ * @return The number of input events handled
+ */
+int poll_controller(wiimote **wiimotes, struct robot_s *robot,
+                    struct controller_s *controller);
+
+/**
+ * @brief Prints the robot and controller state if the robot is VERBOSE
+ *
+ * @param robot The robot to print
+ * @param controller The controller to print
+ */
+void print_state(struct robot_s *robot, struct controller_s *controller);
+
 /**
  * @brief The main loop executed once a cycle
  *
@@ -150,8 +170,10 @@ short heart_beat(wiimote **wm, int num_wiimotes);
  * @param controller The Controller structure
  * @param nunchuk the nunchuk structure
  * @param verbose Verbosity set to 1 prints all states of the controller
+ *
+ * @return The number of input events handled
  */
-void event_loop(wiimote **wiimotes, struct robot_s *robot,
-                struct controller_s *controller);
+int event_loop(wiimote **wiimotes, struct robot_s *robot,
+               struct controller_s *controller);
 
 #endif /* end of include guard WII_CONTROLLER_H */
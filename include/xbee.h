@@ -0,0 +1,203 @@
+/**
+ * @file        : xbee
+ * @brief XBee API mode transport for the host's radio
+ *
+ * In transparent mode the radio takes bytes and we never hear whether they
+ * made it. With the host's radio in API mode (AP=1, the teensy's stays
+ * transparent) every RF packet is a Transmit Request (0x10) with a frame id,
+ * and the radio answers each one with a Transmit Status (0x8B) once the other
+ * radio acked it or it gave up. Bytes from the teensy come back wrapped in
+ * Receive Packets (0x90).
+ *
+ * One packet is in flight at a time. Frames submitted while it's out are
+ * batched into the next packet (a newer drive frame replaces an older one in
+ * the batch), so a slow link costs fewer packets instead of a queue. A failed
+ * or timed out packet is sent again up to max_retries times, unless a newer
+ * command is already waiting, and every one that's given up on is counted.
+ *
+ * @note Escaped API mode (AP=2) isn't supported
+ *
+ * @created     : Sunday Oct 18, 2026 16:44:21 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef XBEE_H
+
+#define XBEE_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Local Includes
+#include "protocol.h"
+
+#define XBEE_START 0x7E
+#define XBEE_TX_REQUEST 0x10
+#define XBEE_TX_STATUS 0x8B
+#define XBEE_RX_PACKET 0x90
+
+// Bytes around the RF data in a Transmit Request (start, length, api id,
+// frame id, addresses, radius, options, checksum)
+#define XBEE_TX_OVERHEAD 18
+// Smallest NP of the firmwares we care about, the rest of the packet is ours
+#define XBEE_MAX_PAYLOAD 72
+#define XBEE_MAX_FRAME (XBEE_MAX_PAYLOAD + XBEE_TX_OVERHEAD)
+#define XBEE_BROADCAST 0xFFFFULL
+
+#define XBEE_RETRIES 2
+#define XBEE_STATUS_TIMEOUT 0.25 // Seconds, well over the radio's own retries
+
+////////// Data Structures //////////
+
+/**
+ * @dest           64 bit address of the teensy's radio
+ * @max_retries    Times a failed packet is sent again
+ * @timeout_ns     No status this long after sending counts as a failure
+ * @next_id        Frame id for the next packet, never 0
+ * @frame_id       Frame id of the packet in flight, 0 for none
+ * @deadline_ns    When the packet in flight times out
+ * @tries          Times the packet in flight has been sent
+ * @resend         The packet in flight failed and should go again
+ * @flight         RF data of the packet in flight
+ * @flight_len     Bytes in flight
+ * @flight_drive   The packet in flight has a drive frame
+ * @batch          RF data for the next packet, encoded proto frames
+ * @batch_len      Bytes in batch
+ * @batch_frames   Frames in batch
+ * @drive_off      Where the drive frame in batch starts, -1 for none
+ * @drive_len      Its encoded size
+ * @rx             The API frame being received
+ * @rx_len         Bytes of it so far
+ * @payload        RF data of the last Receive Packet
+ * @payload_len    Bytes in payload
+ * @packets        Packets handed to the radio (retries too)
+ * @frames         Proto frames sent
+ * @replaced       Drive frames replaced in a batch before they went out
+ * @delivered      Packets the radio says were delivered
+ * @failed         Packets the radio says failed
+ * @timeouts       Packets we never got a status for
+ * @retried        Packets sent again
+ * @lost           Packets given up on
+ * @radio_retries  Retries the radio did on its own, from the statuses
+ * @stale_status   Statuses for a packet we'd already given up on
+ * @rx_packets     Receive Packets
+ * @rx_errors      API frames with a bad checksum or length
+ * @rx_other       Good API frames we don't use
+ */
+struct xbee_link {
+  uint64_t dest;
+  int max_retries;
+  int64_t timeout_ns;
+  uint8_t next_id;
+  uint8_t frame_id;
+  int64_t deadline_ns;
+  int tries;
+  int resend;
+  uint8_t flight[XBEE_MAX_PAYLOAD];
+  size_t flight_len;
+  int flight_drive;
+  uint8_t batch[XBEE_MAX_PAYLOAD];
+  size_t batch_len;
+  int batch_frames;
+  int drive_off;
+  size_t drive_len;
+  uint8_t rx[XBEE_MAX_FRAME];
+  size_t rx_len;
+  const uint8_t *payload;
+  size_t payload_len;
+  uint64_t packets;
+  uint64_t frames;
+  uint64_t replaced;
+  uint64_t delivered;
+  uint64_t failed;
+  uint64_t timeouts;
+  uint64_t retried;
+  uint64_t lost;
+  uint64_t radio_retries;
+  uint64_t stale_status;
+  uint64_t rx_packets;
+  uint64_t rx_errors;
+  uint64_t rx_other;
+};
+
+/**
+ * @brief Sets up a link
+ *
+ * @param xbee The link
+ * @param dest 64 bit address of the teensy's radio
+ * @param max_retries Times a failed packet is sent again
+ * @param status_timeout Seconds to wait for a Transmit Status
+ */
+void xbee_init(struct xbee_link *xbee, uint64_t dest, int max_retries,
+               double status_timeout);
+
+/**
+ * @brief Forgets the packet in flight, the batch and any partial frame
+ * @note For a reconnect, the counters carry on
+ *
+ * @param xbee The link
+ */
+void xbee_reset(struct xbee_link *xbee);
+
+/**
+ * @brief Adds a frame to the next packet
+ *
+ * @param xbee The link
+ * @param frame The frame, seq already set
+ *
+ * @return 0 if it was added, -1 if the batch is full
+ */
+int xbee_add(struct xbee_link *xbee, const struct proto_frame *frame);
+
+/**
+ * @brief Builds the next Transmit Request if the radio is free
+ * @note A packet in flight past its deadline counts as failed here
+ *
+ * @param xbee The link
+ * @param out At least XBEE_MAX_FRAME bytes
+ * @param now_ns CLOCK_MONOTONIC now
+ *
+ * @return The API frame's size, 0 if there's nothing to send or a packet is
+ * still in flight
+ */
+size_t xbee_packet(struct xbee_link *xbee, uint8_t *out, int64_t now_ns);
+
+/**
+ * @brief When xbee_packet could have something
+ *
+ * @param xbee The link
+ *
+ * @return CLOCK_MONOTONIC nanoseconds, 0 for now, INT64_MAX if there's
+ * nothing to send
+ */
+int64_t xbee_next_ns(const struct xbee_link *xbee);
+
+/**
+ * @brief Whether a packet is in flight
+ *
+ * @param xbee The link
+ *
+ * @return 1 if one is, 0 if not
+ */
+int xbee_busy(const struct xbee_link *xbee);
+
+/**
+ * @brief Feeds one byte from the radio
+ * @note Transmit Statuses are handled here
+ *
+ * @param xbee The link
+ * @param byte The byte
+ *
+ * @return 1 when a Receive Packet is complete (see payload), 0 otherwise
+ */
+int xbee_rx_byte(struct xbee_link *xbee, uint8_t byte);
+
+/**
+ * @brief Logs the counters
+ *
+ * @param xbee The link
+ */
+void xbee_log(const struct xbee_link *xbee);
+
+#endif /* end of include guard XBEE_H */
@@ -0,0 +1,170 @@
+/**
+ * @file        : baud_upgrade
+ * @created     : Sunday Oct 18, 2026 16:30:54 MDT
+ */
+
+#include "baud_upgrade.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "periodic.h"
+#include "protocol.h"
+#include "serial_baud.h"
+
+#define NS_PER_MS 1000000LL
+
+// Waits for fd to be ready, 1 if it is, 0 on timeout or stop_fd, -1 on error
+static int wait_fd(int fd, short events, int stop_fd, int timeout_ms) {
+  struct pollfd fds[2] = {{fd, events, 0}, {stop_fd, POLLIN, 0}};
+  int ret;
+
+  do {
+    ret = poll(fds, 2, timeout_ms);
+  } while (ret == -1 && errno == EINTR);
+  if (ret == -1) {
+    log_error("Error %d waiting on serial: %s", errno, strerror(errno));
+    return -1;
+  }
+  if (ret == 0 || (fds[1].revents & POLLIN))
+    return 0;
+  if (fds[0].revents & (POLLERR | POLLHUP))
+    return -1;
+  return 1;
+}
+
+static int send_frame(int fd, int stop_fd, struct proto_frame *frame,
+                      uint8_t *seq) {
+  uint8_t buf[PROTO_MAX_ENCODED];
+  size_t len, off = 0;
+  ssize_t ret;
+
+  frame->seq = (*seq)++;
+  len = proto_encode(frame, buf);
+  while (off < len) {
+    ret = write(fd, buf + off, len - off);
+    if (ret > 0) {
+      off += ret;
+    } else if (ret == -1 && errno == EAGAIN) {
+      if (wait_fd(fd, POLLOUT, stop_fd, BAUD_ACK_TIMEOUT_MS) <= 0)
+        return -1;
+    } else if (!(ret == -1 && errno == EINTR)) {
+      log_error("Error %d writing serial: %s", errno, strerror(errno));
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Reads until a frame of type shows up, 1 if it did, 0 on timeout, -1 on error
+static int wait_frame(int fd, int stop_fd, struct proto_decoder *dec,
+                      uint8_t type, struct proto_frame *frame,
+                      int timeout_ms) {
+  int64_t deadline = monotonic_ns() + timeout_ms * NS_PER_MS;
+  int64_t left;
+  uint8_t byte;
+  ssize_t ret;
+  int ready;
+
+  for (;;) {
+    // One byte at a time so nothing after the frame gets eaten
+    while ((ret = read(fd, &byte, 1)) == 1)
+      if (proto_decode_byte(dec, byte, frame) == PROTO_FRAME &&
+          frame->type == type)
+        return 1;
+    if (ret == -1 && errno != EAGAIN && errno != EINTR) {
+      log_error("Error %d reading serial: %s", errno, strerror(errno));
+      return -1;
+    }
+
+    left = deadline - monotonic_ns();
+    if (left <= 0)
+      return 0;
+    ready = wait_fd(fd, POLLIN, stop_fd, (left + NS_PER_MS - 1) / NS_PER_MS);
+    if (ready <= 0)
+      return ready;
+  }
+}
+
+// Pings at the current baud, 1 if every one came back clean
+static int verify(int fd, int stop_fd, uint8_t *seq) {
+  struct proto_decoder dec;
+  struct proto_frame frame;
+  struct proto_ping ping;
+  struct proto_pong pong;
+  uint32_t i;
+
+  proto_decoder_init(&dec);
+  for (i = 0; i < BAUD_VERIFY_PINGS; ++i) {
+    ping.nonce = i;
+    ping.host_ns = monotonic_ns();
+    proto_pack_ping(&frame, 0, &ping);
+    if (send_frame(fd, stop_fd, &frame, seq) ||
+        wait_frame(fd, stop_fd, &dec, PROTO_PONG, &frame,
+                   BAUD_VERIFY_TIMEOUT_MS) != 1 ||
+        !proto_unpack_pong(&frame, &pong) || pong.nonce != i)
+      return 0;
+  }
+  return !dec.crc_errors && !dec.framing_errors;
+}
+
+int baud_revert(int fd, int stop_fd, int safe_baud) {
+  if (serial_set_baud(fd, safe_baud))
+    return -1;
+  if (wait_fd(-1, 0, stop_fd, BAUD_REVERT_MS) == -1)
+    return -1;
+  tcflush(fd, TCIOFLUSH);
+  return 0;
+}
+
+int baud_upgrade(int fd, int stop_fd, int safe_baud, int max_baud,
+                 uint8_t *seq) {
+  static const int rates[] = {BAUD_RATES};
+  struct proto_decoder dec;
+  struct proto_frame frame;
+  uint32_t acked;
+  size_t i;
+  int ret;
+
+  proto_decoder_init(&dec);
+  for (i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i) {
+    if (rates[i] > max_baud || rates[i] <= safe_baud)
+      continue;
+
+    proto_pack_baud(&frame, PROTO_BAUD, 0, rates[i]);
+    if (send_frame(fd, stop_fd, &frame, seq))
+      break;
+    ret = wait_frame(fd, stop_fd, &dec, PROTO_BAUD_ACK, &frame,
+                     BAUD_ACK_TIMEOUT_MS);
+    if (ret != 1 || !proto_unpack_baud(&frame, PROTO_BAUD_ACK, &acked)) {
+      log_warn("Baud: no answer from the teensy, staying at %d", safe_baud);
+      break;
+    }
+    if (acked != (uint32_t)rates[i]) {
+      log_info("Baud: teensy won't do %d", rates[i]);
+      continue;
+    }
+
+    // The ack was the last thing at the old rate on both sides
+    tcdrain(fd);
+    if (!serial_set_baud(fd, rates[i])) {
+      usleep(BAUD_SETTLE_MS * 1000);
+      tcflush(fd, TCIOFLUSH);
+      if (verify(fd, stop_fd, seq)) {
+        log_info("Baud: link upgraded to %d", rates[i]);
+        return rates[i];
+      }
+    }
+    log_warn("Baud: %d isn't reliable, back to %d", rates[i], safe_baud);
+    if (baud_revert(fd, stop_fd, safe_baud)) {
+      log_error("Baud: couldn't go back to %d", safe_baud);
+      break;
+    }
+  }
+  ret = serial_get_baud(fd);
+  return ret == -1 ? safe_baud : ret;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file        : hotplug
+ * @created     : Sunday Oct 18, 2026 16:35:10 MDT
+ */
+
+#define _GNU_SOURCE
+#include "hotplug.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/netlink.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define UEVENT_BUFFER 8192
+#define UEVENT_KERNEL_GROUP 1 // udev's rebroadcast is group 2
+
+// Reads a one line sysfs attribute, 0 if it's there
+static int read_attr(const char *dir, const char *name, char *out,
+                     size_t len) {
+  char path[PATH_MAX];
+  FILE *file;
+  int ok;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  file = fopen(path, "r");
+  if (!file)
+    return -1;
+  ok = fgets(out, len, file) != NULL;
+  fclose(file);
+  if (!ok)
+    return -1;
+  out[strcspn(out, "\n")] = '\0';
+  return 0;
+}
+
+int serial_match_parse(struct serial_match *match, const char *str) {
+  unsigned int vid, pid;
+  int end = 0;
+
+  if (sscanf(str, "%x:%x%n", &vid, &pid, &end) != 2 || vid > 0xFFFF ||
+      pid > 0xFFFF || (str[end] != '\0' && str[end] != ':'))
+    return -1;
+  match->vid = vid;
+  match->pid = pid;
+  match->serial = str[end] == ':' ? str + end + 1 : NULL;
+  return 0;
+}
+
+int serial_match_port(const struct serial_match *match, const char *port) {
+  char path[PATH_MAX];
+  char dir[PATH_MAX];
+  char attr[128];
+  const char *name = strrchr(port, '/');
+  char *slash;
+
+  if (!match->vid && !match->pid && !match->serial)
+    return 1;
+
+  // The tty's device is the USB interface, the ids are on a parent of it
+  snprintf(path, sizeof(path), "/sys/class/tty/%s/device",
+           name ? name + 1 : port);
+  if (!realpath(path, dir))
+    return 0;
+  while (read_attr(dir, "idVendor", attr, sizeof(attr))) {
+    slash = strrchr(dir, '/');
+    if (!slash || slash == dir)
+      return 0;
+    *slash = '\0';
+  }
+
+  if (match->vid && strtoul(attr, NULL, 16) != match->vid)
+    return 0;
+  if (match->pid && (read_attr(dir, "idProduct", attr, sizeof(attr)) ||
+                     strtoul(attr, NULL, 16) != match->pid))
+    return 0;
+  if (match->serial && (read_attr(dir, "serial", attr, sizeof(attr)) ||
+                        strcmp(attr, match->serial)))
+    return 0;
+  return 1;
+}
+
+int hotplug_open() {
+  struct sockaddr_nl addr;
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  NETLINK_KOBJECT_UEVENT);
+
+  if (fd == -1) {
+    log_error("Error %d opening uevent socket: %s", errno, strerror(errno));
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = UEVENT_KERNEL_GROUP;
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    log_error("Error %d binding uevent socket: %s", errno, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int hotplug_read(int fd, char *port, size_t len) {
+  char buf[UEVENT_BUFFER];
+  const char *action, *subsystem, *devname;
+  ssize_t n;
+  size_t i;
+  int added = 0;
+
+  if (len)
+    port[0] = '\0';
+  for (;;) {
+    n = recv(fd, buf, sizeof(buf) - 1, 0);
+    if (n == -1) {
+      if (errno == EAGAIN || errno == EINTR)
+        return added;
+      if (errno == ENOBUFS) // Missed some, a rescan catches up
+        return 1;
+      log_error("Error %d reading uevents: %s", errno, strerror(errno));
+      return -1;
+    }
+    buf[n] = '\0';
+
+    // "add@/devices/..." then KEY=value strings, all NUL separated
+    action = subsystem = devname = NULL;
+    for (i = strlen(buf) + 1; i < (size_t)n; i += strlen(buf + i) + 1) {
+      if (!strncmp(buf + i, "ACTION=", 7))
+        action = buf + i + 7;
+      else if (!strncmp(buf + i, "SUBSYSTEM=", 10))
+        subsystem = buf + i + 10;
+      else if (!strncmp(buf + i, "DEVNAME=", 8))
+        devname = buf + i + 8;
+    }
+    if (action && subsystem && devname && !strcmp(action, "add") &&
+        !strcmp(subsystem, "tty")) {
+      snprintf(port, len, "/dev/%s", devname);
+      added = 1;
+    }
+  }
+}
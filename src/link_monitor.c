@@ -0,0 +1,229 @@
+/**
+ * @file        : link_monitor
+ * @created     : Sunday Oct 18, 2026 16:48:27 MDT
+ */
+
+#include "link_monitor.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1e6
+
+static const char *state_names[] = {"good", "degraded", "lost"};
+
+// The bucket now falls in, emptied if it's left over from a lap ago
+static struct link_bucket *bucket_at(struct link_monitor *monitor,
+                                     int64_t now) {
+  int64_t width = LINK_BUCKET * NS_PER_SEC;
+  int64_t start = now - now % width;
+  struct link_bucket *bucket =
+      &monitor->buckets[(start / width) % LINK_BUCKETS];
+
+  if (bucket->start_ns != start) {
+    memset(bucket, 0, sizeof(*bucket));
+    bucket->start_ns = start;
+  }
+  return bucket;
+}
+
+// How many more the teensy counted since the last report, 0 if it restarted
+static uint32_t teensy_delta(uint16_t prev, uint16_t next) {
+  return next >= prev ? next - prev : 0;
+}
+
+static void take_counters(struct link_monitor *monitor, int64_t now,
+                          const struct telemetry_reader *reader,
+                          const struct latency_probe *probe,
+                          const struct serial_writer *writer) {
+  struct link_bucket *bucket = bucket_at(monitor, now);
+  const struct proto_telemetry *report = &reader->latest.report;
+  uint64_t host_bad =
+      reader->decoder.crc_errors + reader->decoder.framing_errors;
+  uint64_t good = reader->reports + reader->other_frames + probe->answered;
+  uint64_t xbee_failed = 0;
+  int64_t gap;
+
+  if (writer->xbee)
+    xbee_failed = writer->xbee->failed + writer->xbee->timeouts;
+
+  bucket->sent += writer->frames - monitor->frames;
+  bucket->good +=
+      good - (monitor->reports + monitor->other_frames + monitor->answered);
+  bucket->bad += host_bad - monitor->host_bad;
+  bucket->missed += xbee_failed - monitor->xbee_failed;
+
+  if (reader->reports != monitor->reports) {
+    gap = reader->latest.received_ns - monitor->last_report_ns;
+    if (gap > bucket->gap_ns)
+      bucket->gap_ns = gap;
+    monitor->last_report_ns = reader->latest.received_ns;
+
+    if (monitor->have_teensy) {
+      bucket->missed +=
+          teensy_delta(monitor->teensy.lost_frames, report->lost_frames);
+      bucket->bad +=
+          teensy_delta(monitor->teensy.crc_errors, report->crc_errors) +
+          teensy_delta(monitor->teensy.framing_errors, report->framing_errors);
+    }
+    monitor->teensy = *report;
+    monitor->have_teensy = 1;
+  }
+  if (probe->answered != monitor->answered) {
+    bucket->rtt_count++;
+    bucket->rtt_ns += probe->last_rtt_ns;
+  }
+
+  monitor->reports = reader->reports;
+  monitor->frames = writer->frames;
+  monitor->other_frames = reader->other_frames;
+  monitor->answered = probe->answered;
+  monitor->host_bad = host_bad;
+  monitor->xbee_failed = xbee_failed;
+}
+
+static void sum_window(struct link_monitor *monitor, int64_t now) {
+  struct link_window *window = &monitor->window;
+  int64_t oldest = now - LINK_BUCKETS * LINK_BUCKET * NS_PER_SEC;
+  uint64_t sent = 0, missed = 0, good = 0, bad = 0, rtts = 0;
+  int64_t rtt_ns = 0;
+  int i;
+
+  window->gap_ns = now - monitor->last_report_ns;
+  for (i = 0; i < LINK_BUCKETS; ++i) {
+    const struct link_bucket *bucket = &monitor->buckets[i];
+    if (bucket->start_ns <= oldest)
+      continue;
+    sent += bucket->sent;
+    missed += bucket->missed;
+    good += bucket->good;
+    bad += bucket->bad;
+    rtts += bucket->rtt_count;
+    rtt_ns += bucket->rtt_ns;
+    if (bucket->gap_ns > window->gap_ns)
+      window->gap_ns = bucket->gap_ns;
+  }
+
+  window->delivery = 1;
+  if (sent >= LINK_MIN_SAMPLES)
+    window->delivery = missed < sent ? 1 - (double)missed / sent : 0;
+  window->errors = 0;
+  if (good + bad >= LINK_MIN_SAMPLES)
+    window->errors = (double)bad / (good + bad);
+  window->rtt_ns = rtts ? rtt_ns / (int64_t)rtts : 0;
+}
+
+static int window_ok(const struct link_window *window) {
+  return window->delivery >= LINK_MIN_DELIVERY &&
+         window->errors <= LINK_MAX_ERRORS &&
+         window->rtt_ns <= LINK_MAX_RTT * NS_PER_SEC &&
+         window->gap_ns <= LINK_MAX_GAP * NS_PER_SEC;
+}
+
+static void enter(struct link_monitor *monitor, enum link_state state,
+                  int64_t now) {
+  const struct link_window *window = &monitor->window;
+  int64_t spent = now - monitor->state_ns;
+
+  if (monitor->state == LINK_DEGRADED)
+    monitor->degraded_ns += spent;
+  else if (monitor->state == LINK_LOST)
+    monitor->lost_ns += spent;
+  monitor->state = state;
+  monitor->state_ns = now;
+
+  switch (state) {
+  case LINK_GOOD:
+    log_info("Link: good");
+    break;
+  case LINK_DEGRADED:
+    monitor->degraded++;
+    log_warn("Link: degraded, slowing down (delivery %.1f%%, errors %.1f%%, "
+             "rtt %.1f ms, report gap %.0f ms)",
+             100 * window->delivery, 100 * window->errors,
+             window->rtt_ns / NS_PER_MS, window->gap_ns / NS_PER_MS);
+    break;
+  case LINK_LOST:
+    monitor->lost++;
+    monitor->stopped = 1;
+    log_error("Link: lost (no report for %.0f ms), stopping the robot",
+              window->gap_ns / NS_PER_MS);
+    break;
+  }
+}
+
+void link_monitor_init(struct link_monitor *monitor, int enabled,
+                       int64_t now_ns) {
+  memset(monitor, 0, sizeof(*monitor));
+  monitor->enabled = enabled;
+  monitor->state = LINK_GOOD;
+  monitor->state_ns = now_ns;
+  monitor->last_report_ns = now_ns;
+  monitor->window.delivery = 1;
+}
+
+int link_monitor_update(struct link_monitor *monitor, int64_t now_ns,
+                        const struct telemetry_reader *reader,
+                        const struct latency_probe *probe,
+                        const struct serial_writer *writer) {
+  enum link_state prev = monitor->state;
+  int lost;
+
+  if (!monitor->enabled)
+    return 0;
+  take_counters(monitor, now_ns, reader, probe, writer);
+  sum_window(monitor, now_ns);
+
+  lost = writer->fd == -1 ||
+         now_ns - monitor->last_report_ns >= LINK_LOST_GAP * NS_PER_SEC;
+  if (lost || !window_ok(&monitor->window))
+    monitor->good_ns = 0;
+  else if (!monitor->good_ns)
+    monitor->good_ns = now_ns;
+
+  if (lost) {
+    if (prev != LINK_LOST)
+      enter(monitor, LINK_LOST, now_ns);
+  } else if (prev == LINK_LOST) {
+    // A report made it through, but the window still has the outage in it
+    enter(monitor, LINK_DEGRADED, now_ns);
+  } else if (!monitor->good_ns) {
+    if (prev == LINK_GOOD)
+      enter(monitor, LINK_DEGRADED, now_ns);
+  } else if (prev == LINK_DEGRADED &&
+             now_ns - monitor->good_ns >= LINK_RECOVER * NS_PER_SEC) {
+    enter(monitor, LINK_GOOD, now_ns);
+  }
+  return monitor->state != prev;
+}
+
+int link_monitor_stopped(struct link_monitor *monitor, int neutral) {
+  if (monitor->stopped && monitor->state != LINK_LOST && neutral) {
+    monitor->stopped = 0;
+    log_info("Link: stick is neutral, driving again");
+  }
+  return monitor->stopped;
+}
+
+int link_monitor_slowdown(const struct link_monitor *monitor) {
+  return monitor->state == LINK_GOOD ? 1 : LINK_SLOWDOWN;
+}
+
+void link_monitor_log(const struct link_monitor *monitor, int64_t now_ns) {
+  int64_t degraded_ns = monitor->degraded_ns;
+  int64_t lost_ns = monitor->lost_ns;
+
+  if (!monitor->enabled)
+    return;
+  if (monitor->state == LINK_DEGRADED)
+    degraded_ns += now_ns - monitor->state_ns;
+  else if (monitor->state == LINK_LOST)
+    lost_ns += now_ns - monitor->state_ns;
+  log_info("Link: %s at exit, degraded %llu times for %.1f s, lost %llu "
+           "times for %.1f s",
+           state_names[monitor->state], (unsigned long long)monitor->degraded,
+           degraded_ns / (double)NS_PER_SEC, (unsigned long long)monitor->lost,
+           lost_ns / (double)NS_PER_SEC);
+}
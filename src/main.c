@@ -1,32 +1,334 @@
 
 #include "utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
 #include <signal.h>
+#include <unistd.h>
+
+void usage(const char *name) {
+  printf("Usage: %s [-r] [-R] [-c cpu] [-j seconds] [-p seconds] [-B baud]\n"
+         "       [-u vid:pid[:serial]] [-x addr] [-X retries]\n"
+         "       [-S slew:jerk] [-G slew:jerk] [-W ms] [-V mm_s]\n"
+         "       [-M layout] [-K lf:lb:rf:rb] [-h]\n"
+         "  -r  Run everything on one thread from a single epoll loop\n"
+         "  -R  Real time profile: SCHED_FIFO, mlockall, prefaulted memory\n"
+         "  -c  Pin the control threads to a cpu, 0 to %ld (with -R)\n"
+         "  -j  Log loop timing / jitter every few seconds\n"
+         "  -p  Seconds between serial latency probes, 0 for none, at most "
+         "%.0f\n"
+         "      (default 1)\n"
+         "  -B  Negotiate the serial link up to this baud, at most %d (wired\n"
+         "      links only)\n"
+         "  -u  Only use this USB serial adapter (ex 0403:6015)\n"
+         "  -x  The port is an xbee in API mode, send to this 64 bit address\n"
+         "      (hex, ffff for broadcast)\n"
+         "  -X  Resends when the xbee can't deliver a packet (default 2)\n"
+         "  -S  Drive motor limits, throttle units per second and per second\n"
+         "      squared, 0 for none (default %d:%d)\n"
+         "  -G  Same for the gun motors (default %d:%d)\n"
+         "  -W  Stop the motors after this long without a command (default "
+         "%d)\n"
+         "  -V  Send wheel speeds instead of throttles, a full command is this\n"
+         "      many mm/s (needs encoders on the teensy)\n"
+         "  -M  Chassis for the teensy's mixer: diff, mecanum or omni (default "
+         "diff)\n"
+         "  -K  Per drive motor scale in percent, negative for a motor\n"
+         "      mounted the other way (default -100:-100:100:100)\n"
+         "  -h  Show this message\n",
+         name, sysconf(_SC_NPROCESSORS_CONF) - 1, PROBE_PERIOD_MAX,
+         BAUD_RATE_MAX, PROTO_DRIVE_SLEW, PROTO_DRIVE_JERK, PROTO_GUN_SLEW,
+         PROTO_GUN_JERK, PROTO_COMMAND_TIMEOUT_MS);
+}
+
+// Parses slew:jerk into channels first..last-1 of the motion limits
+int parse_limits(const char *arg, int first, int last) {
+  unsigned int slew, jerk;
+  int i;
+
+  if (sscanf(arg, "%u:%u", &slew, &jerk) != 2 || slew > UINT16_MAX ||
+      jerk > UINT16_MAX)
+    return -1;
+  for (i = first; i < last; ++i) {
+    motion_limits.slew[i] = slew;
+    motion_limits.jerk[i] = jerk;
+  }
+  send_config |= CONFIG_LIMITS;
+  return 0;
+}
+
+// Parses the cpu to pin to, it has to be one this machine has
+int parse_cpu(const char *arg) {
+  char *end;
+  long cpu = strtol(arg, &end, 10);
+
+  if (end == arg || *end || cpu < 0 || cpu >= sysconf(_SC_NPROCESSORS_CONF))
+    return -1;
+  rt_profile.cpu = cpu;
+  return 0;
+}
+
+// Parses the seconds between loop timing reports
+int parse_jitter_report(const char *arg) {
+  char *end;
+  double seconds = strtod(arg, &end);
+
+  if (end == arg || *end || !(seconds > 0) || !isfinite(seconds))
+    return -1;
+  jitter_report = seconds;
+  return 0;
+}
+
+// Parses the seconds between latency probes, 0 turns them off
+int parse_probe_period(const char *arg) {
+  char *end;
+  double period = strtod(arg, &end);
+
+  if (end == arg || *end || !(period >= 0 && period <= PROBE_PERIOD_MAX))
+    return -1;
+  probe_period = period;
+  return 0;
+}
+
+// Parses the fastest baud to negotiate up to
+int parse_max_baud(const char *arg) {
+  char *end;
+  long baud = strtol(arg, &end, 10);
+
+  if (end == arg || *end || baud <= 0 || baud > BAUD_RATE_MAX)
+    return -1;
+  max_baud = baud;
+  return 0;
+}
+
+// Parses the command timeout in ms, it has to fit the config frame
+int parse_timeout(const char *arg) {
+  char *end;
+  long ms = strtol(arg, &end, 10);
+
+  if (end == arg || *end || ms <= 0 || ms > UINT16_MAX)
+    return -1;
+  motion_limits.timeout_ms = ms;
+  send_config |= CONFIG_LIMITS;
+  return 0;
+}
+
+// diff, mecanum or omni, -1 for anything else
+int parse_layout(const char *arg) {
+  if (!strcmp(arg, "diff"))
+    return PROTO_LAYOUT_DIFF;
+  if (!strcmp(arg, "mecanum"))
+    return PROTO_LAYOUT_MECANUM;
+  if (!strcmp(arg, "omni"))
+    return PROTO_LAYOUT_OMNI;
+  return -1;
+}
+
+// Parses lf:lb:rf:rb into the drive mixer's scales
+int parse_scales(const char *arg) {
+  int scale[PROTO_DRIVE_CHANNELS];
+  int i;
+
+  if (sscanf(arg, "%d:%d:%d:%d", &scale[0], &scale[1], &scale[2],
+             &scale[3]) != PROTO_DRIVE_CHANNELS)
+    return -1;
+  for (i = 0; i < PROTO_DRIVE_CHANNELS; ++i) {
+    if (scale[i] < -INT8_MAX || scale[i] > INT8_MAX)
+      return -1;
+    drive_mixer.scale[i] = scale[i];
+  }
+  return 0;
+}
+
+// Parses the teensy's 64 bit xbee address in hex
+int parse_xbee_dest(const char *arg) {
+  char *end;
+  unsigned long long dest;
+
+  // strtoull takes a sign and wraps negatives around
+  if (!isxdigit((unsigned char)*arg))
+    return -1;
+  errno = 0;
+  dest = strtoull(arg, &end, 16);
+  if (*end || errno == ERANGE)
+    return -1;
+  xbee_dest = dest;
+  return 0;
+}
+
+// Parses how many times a packet the radio couldn't deliver is resent
+int parse_retries(const char *arg) {
+  char *end;
+  long retries = strtol(arg, &end, 10);
+
+  if (end == arg || *end || retries < 0 || retries > INT_MAX)
+    return -1;
+  xbee_retries = retries;
+  return 0;
+}
 
 /**
  * These are globals
  * Globals are bad.
  * Please don't use globals.
  */
-void init_state_system() {
+int init_state_system() {
+
+  scan_signal = 0;
+  running = 1;
+  caught_signal = 0;
+
+  // Before any thread exists so the whole process is locked
+  if (rt_process_setup(&rt_profile))
+    log_warn("Not every real time setting took effect, see above");
+
+  // The events need to exist before a signal can write to them
+  if (init_events())
+    return -1;
 
   // Set signal to sigint and term
   // int is ctrl c
   signal(SIGINT, signal_handler);
   signal(SIGTERM, signal_handler);
 
-  scan_signal = 0;
-  running = 1;
-
-  wii_ready = 0;
-  serial_ready = 0;
-
   // Create the main robot
   robot_main = kermit_robot();
+  full_command = robot_main.drive->max_speed;
+  return 0;
+}
+
+void init_buffers() {
+  // The serial thread starts from whatever robot_main starts as
+  struct robot_command command = robot_get_command(&robot_main);
+  triple_buffer_init(&command_buffer, command_slots, sizeof(command), &command);
+  triple_buffer_init(&telemetry_buffer, telemetry_slots,
+                     sizeof(robot_main.telemetry), &robot_main.telemetry);
 }
 
-int main() {
+int main(int argc, char **argv) {
+  int opt;
+  int reactor = 0;
+  int layout = PROTO_LAYOUT_DIFF;
+  const char *scales = NULL;
 
-  init_state_system();
+  rt_profile = create_rt_config();
+  jitter_report = 0;
+  probe_period = PROBE_PERIOD;
+  max_baud = 0;
+  memset(&port_match, 0, sizeof(port_match));
+  xbee_api = 0;
+  xbee_dest = XBEE_BROADCAST;
+  xbee_retries = XBEE_RETRIES;
+  proto_limits_default(&motion_limits);
+  send_config = CONFIG_MIXER;
+  wheel_speed = 0;
+
+  while ((opt = getopt(argc, argv, "rRc:j:p:B:u:x:X:S:G:W:V:M:K:h")) != -1) {
+    switch (opt) {
+    case 'r':
+      reactor = 1;
+      break;
+    case 'R':
+      rt_profile.enabled = 1;
+      break;
+    case 'c':
+      if (parse_cpu(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'j':
+      if (parse_jitter_report(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'p':
+      if (parse_probe_period(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'B':
+      if (parse_max_baud(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'u':
+      if (serial_match_parse(&port_match, optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'x':
+      xbee_api = 1;
+      if (parse_xbee_dest(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'X':
+      if (parse_retries(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'S':
+    case 'G':
+      if (opt == 'S' ? parse_limits(optarg, 0, PROTO_DRIVE_CHANNELS)
+                     : parse_limits(optarg, PROTO_DRIVE_CHANNELS,
+                                    PROTO_TELEMETRY_CHANNELS)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'W':
+      if (parse_timeout(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'V':
+      wheel_speed = atoi(optarg);
+      if (wheel_speed <= 0 || wheel_speed > INT16_MAX) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'M':
+      layout = parse_layout(optarg);
+      if (layout == -1) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'K':
+      scales = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  // The scales go on top of whatever layout was picked
+  proto_mixer_layout(&drive_mixer, layout);
+  if (scales && parse_scales(scales)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Baud negotiation talks raw frames, the radios have their own baud (ATBD)
+  if (xbee_api && max_baud) {
+    log_error("-B doesn't work through an xbee in API mode");
+    return 1;
+  }
+
+  if (init_state_system())
+    return 1;
 
   /**
    * You can set robot options. Valid options are:
@@ -49,25 +351,41 @@ int main() {
   robot_unsetopt(&robot_main, DISCLINANG);
   robot_unsetopt(&robot_main, NONLIN);
 
+  init_buffers();
+
   // These are the prefixes to scan.
   char const *prefixes[1] = {
       "/dev/ttyUSB"}; //"/dev/ttyACM"}; // USB is the xbee
   // To enter the serial thread
-  struct port_context p_cont = {prefixes, 1, 9600, 10};
+  struct port_context p_cont = {prefixes, 1, 9600, 10, &port_match};
+
+  if (reactor) {
+    // Everything on this thread, no locks or handshakes
+    log_info("Running in reactor mode");
+    reactor_thread(&p_cont);
+  } else {
+    // Create the two thread structs
+    pthread_t wii_thread_t;
+    pthread_t serial_thread_t;
+
+    // Creates a thread (thread_obj, parameters, description, callback
+    // function)
+    thread_creator(&wii_thread_t, NULL, "Wii Controller", wii_thread);
+    thread_creator(&serial_thread_t, &p_cont, "Serial Communication",
+                   serial_thread);
 
-  // Create the two thread structs
-  pthread_t wii_thread_t;
-  pthread_t serial_thread_t;
+    // Joins a thread
+    thread_joiner(&wii_thread_t, "Wii Controller Thread");
+    thread_joiner(&serial_thread_t, "Serial Communication thread");
+  }
 
-  // Creates a thread (thread_obj, parameters, description, callback function)
-  thread_creator(&wii_thread_t, NULL, "Wii Controller", wii_thread);
-  thread_creator(&serial_thread_t, &p_cont, "Serial Communication",
-                 serial_thread);
+  // Run once with and once without -r to compare the two designs
+  stats_log_ns(&input_latency, "Input to serial latency");
 
-  // Joins a thread
-  thread_joiner(&wii_thread_t, "Wii Controller Thread");
-  thread_joiner(&serial_thread_t, "Serial Communication thread");
+  if (caught_signal)
+    log_info("Recieved signal: %d", caught_signal);
 
+  close_events();
   robot_clean_up(&robot_main);
   return 0;
 }
@@ -0,0 +1,134 @@
+/**
+ * @file        : periodic
+ * @created     : Sunday Oct 18, 2026 16:06:11 MDT
+ */
+
+#include "periodic.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1000000.0
+
+static int64_t timespec_ns(const struct timespec *ts) {
+  return ts->tv_sec * NS_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec ns_timespec(int64_t ns) {
+  struct timespec ts;
+  ts.tv_sec = ns / NS_PER_SEC;
+  ts.tv_nsec = ns % NS_PER_SEC;
+  return ts;
+}
+
+int64_t monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return timespec_ns(&now);
+}
+
+int periodic_init(struct periodic_task *task, double period) {
+  struct itimerspec spec;
+
+  task->timer_fd = -1;
+  task->period_ns = period * NS_PER_SEC;
+  task->expirations = 0;
+  periodic_reset_stats(task);
+
+  if (task->period_ns <= 0) {
+    log_error("Invalid period %f", period);
+    return -1;
+  }
+
+  task->timer_fd =
+      timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (task->timer_fd == -1) {
+    log_error("Error %d creating timer: %s", errno, strerror(errno));
+    return -1;
+  }
+
+  // First deadline is one period from now, then every period after that
+  clock_gettime(CLOCK_MONOTONIC, &task->start);
+  spec.it_interval = ns_timespec(task->period_ns);
+  spec.it_value = ns_timespec(timespec_ns(&task->start) + task->period_ns);
+
+  if (timerfd_settime(task->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+    log_error("Error %d arming timer: %s", errno, strerror(errno));
+    close(task->timer_fd);
+    task->timer_fd = -1;
+    return -1;
+  }
+  return 0;
+}
+
+int periodic_handle_tick(struct periodic_task *task) {
+  uint64_t expired;
+  int64_t deadline;
+  struct periodic_stats *stats = &task->stats;
+
+  if (read(task->timer_fd, &expired, sizeof(expired)) != sizeof(expired)) {
+    if (errno == EAGAIN || errno == EINTR)
+      return 0;
+    log_error("Error %d reading timer: %s", errno, strerror(errno));
+    return -1;
+  }
+
+  // The deadline we're late for is the most recent one
+  task->expirations += expired;
+  deadline = timespec_ns(&task->start) + task->expirations * task->period_ns;
+  stats_add(&stats->late_ns, monotonic_ns() - deadline);
+  stats->missed += expired - 1;
+
+  return expired;
+}
+
+int periodic_wait(struct periodic_task *task, int stop_fd) {
+  struct pollfd fds[2] = {{task->timer_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+  int ret;
+
+  for (;;) {
+    ret = poll(fds, stop_fd == -1 ? 1 : 2, -1);
+    if (ret == -1) {
+      if (errno == EINTR)
+        continue;
+      log_error("Error %d waiting on timer: %s", errno, strerror(errno));
+      return -1;
+    }
+    if (fds[1].revents & POLLIN)
+      return 0;
+    if (fds[0].revents & POLLIN) {
+      ret = periodic_handle_tick(task);
+      if (ret)
+        return ret;
+    }
+  }
+}
+
+void periodic_reset_stats(struct periodic_task *task) {
+  task->stats.missed = 0;
+  stats_reset(&task->stats.late_ns);
+}
+
+void periodic_log_stats(const struct periodic_task *task,
+                        const char *task_desc) {
+  const struct running_stats *late = &task->stats.late_ns;
+  log_info("%s: period %.3f ms, %llu ticks, %llu missed, latency min %.3f ms "
+           "max %.3f ms mean %.3f ms, jitter %.3f ms",
+           task_desc, task->period_ns / NS_PER_MS,
+           (unsigned long long)late->count,
+           (unsigned long long)task->stats.missed, late->min / NS_PER_MS,
+           late->max / NS_PER_MS, late->mean / NS_PER_MS,
+           stats_stddev(late) / NS_PER_MS);
+}
+
+void periodic_close(struct periodic_task *task) {
+  if (task->timer_fd != -1)
+    close(task->timer_fd);
+  task->timer_fd = -1;
+}
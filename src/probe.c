@@ -0,0 +1,105 @@
+/**
+ * @file        : probe
+ * @created     : Sunday Oct 18, 2026 16:23:48 MDT
+ */
+
+#include "probe.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define NS_PER_SEC 1e9
+#define NS_PER_US 1000
+
+// Updates the clock offset from the fastest probe in each window
+static void update_offset(struct latency_probe *probe, int64_t rtt,
+                          int64_t clock) {
+  if (!probe->window_count || rtt < probe->window_rtt_ns) {
+    probe->window_rtt_ns = rtt;
+    probe->window_clock = clock;
+  }
+  probe->window_count++;
+
+  // Until the first window fills take the best we've got
+  if (!probe->windows || probe->window_count >= PROBE_WINDOW)
+    probe->offset_ns = probe->window_clock - probe->window_rtt_ns / 2;
+  if (probe->window_count >= PROBE_WINDOW) {
+    probe->window_count = 0;
+    probe->windows++;
+  }
+}
+
+void probe_init(struct latency_probe *probe, double period) {
+  memset(probe, 0, sizeof(*probe));
+  probe->period_ns = period * NS_PER_SEC;
+  histogram_reset(&probe->rtt);
+  histogram_reset(&probe->up);
+  histogram_reset(&probe->down);
+  histogram_reset(&probe->apply);
+}
+
+void probe_set_period(struct latency_probe *probe, double period) {
+  probe->period_ns = period * NS_PER_SEC;
+}
+
+int64_t probe_next_ns(const struct latency_probe *probe) {
+  return probe->period_ns > 0 ? probe->next_ns : INT64_MAX;
+}
+
+void probe_ping(struct latency_probe *probe, struct proto_frame *frame,
+                int64_t now_ns) {
+  struct proto_ping ping;
+
+  ping.nonce = probe->nonce++;
+  ping.host_ns = now_ns;
+  proto_pack_ping(frame, 0, &ping);
+  probe->next_ns = now_ns + probe->period_ns;
+  probe->sent++;
+}
+
+int probe_pong(struct latency_probe *probe, const struct proto_pong *pong,
+               int64_t now_ns) {
+  uint32_t age = probe->nonce - pong->nonce;
+  int64_t hold = (int64_t)(uint32_t)(pong->tx_us - pong->rx_us) * NS_PER_US;
+  int64_t rtt, clock, up;
+
+  if (!probe->sent || age == 0 || age > PROBE_MAX_AGE) {
+    probe->stale++;
+    return 0;
+  }
+
+  // micros() wraps every ~71 minutes, pongs come a lot more often than that
+  if (probe->answered)
+    probe->teensy_us += (uint32_t)(pong->rx_us - probe->last_rx_us);
+  else
+    probe->teensy_us = pong->rx_us;
+  probe->last_rx_us = pong->rx_us;
+
+  rtt = now_ns - pong->host_ns - hold;
+  clock = probe->teensy_us * NS_PER_US - pong->host_ns;
+  update_offset(probe, rtt, clock);
+  up = clock - probe->offset_ns;
+
+  probe->last_rtt_ns = rtt;
+  histogram_add(&probe->rtt, rtt);
+  histogram_add(&probe->up, up);
+  histogram_add(&probe->down, rtt - up);
+  histogram_add(&probe->apply,
+                (int64_t)(uint32_t)(pong->apply_us - pong->rx_us) * NS_PER_US);
+  probe->answered++;
+  return 1;
+}
+
+void probe_log(const struct latency_probe *probe) {
+  if (!probe->sent)
+    return;
+  log_info("Probe: %llu pings, %llu answered, %llu stale pongs",
+           (unsigned long long)probe->sent,
+           (unsigned long long)probe->answered,
+           (unsigned long long)probe->stale);
+  histogram_log_ns(&probe->rtt, "Probe round trip");
+  histogram_log_ns(&probe->up, "Probe host to teensy");
+  histogram_log_ns(&probe->down, "Probe teensy to host");
+  histogram_log_ns(&probe->apply, "Probe teensy rx to motors");
+}
@@ -6,10 +6,10 @@
 
 #include "robot_control.h"
 
+#include <string.h>
+
 // The two types of drive train callbacks
 void *discrete(struct robot_s *robot, int ang, int lin) {
-  pthread_mutex_lock(&p_lock);
-
   robot->drive->linear_vel = (!(robot->options & DISCLINANG) || !ang)
                                  ? lin * robot->drive->cruising_speed
                                  : 0;
@@ -17,14 +17,10 @@ void *discrete(struct robot_s *robot, int ang, int lin) {
                                   ? ang * robot->drive->cruising_speed
                                   : 0;
 
-  pthread_mutex_unlock(&p_lock);
-
   return NULL;
 }
 
 void *increment(struct robot_s *robot, int ang, int lin) {
-  pthread_mutex_lock(&p_lock);
-
   // TODO These tertiaries are getting pretty ugly, might want to switch to if
   // else
 
@@ -58,7 +54,6 @@ void *increment(struct robot_s *robot, int ang, int lin) {
             : 0;
   }
 
-  pthread_mutex_unlock(&p_lock);
   return NULL;
 }
 
@@ -66,6 +61,7 @@ static void drive_train_zeros(struct drive_train *dt) {
   if (dt) {
     dt->linear_vel = 0;
     dt->angular_vel = 0;
+    dt->lateral_vel = 0;
   }
 }
 
@@ -278,12 +274,27 @@ void robot_changeopt(struct robot_s *robot, uint8_t option) {
     robot_setopt(robot, option);
 }
 
+struct robot_command robot_get_command(const struct robot_s *robot) {
+  struct robot_command command = {0, 0, 0, 0, 0};
+  if (robot->drive) {
+    command.linear_vel = robot->drive->linear_vel;
+    command.angular_vel = robot->drive->angular_vel;
+    command.lateral_vel = robot->drive->lateral_vel;
+  }
+  if (robot->gun) {
+    command.gun_left = robot->gun->left_mag;
+    command.gun_right = robot->gun->right_mag;
+  }
+  return command;
+}
+
 struct robot_s create_robot() {
   struct robot_s robot;
   struct peripheral *p = malloc(sizeof(struct peripheral));
   robot.camera = NULL;
   robot.drive = NULL;
   robot.gun = NULL;
+  memset(&robot.telemetry, 0, sizeof(robot.telemetry));
   p->start = &start_robot;
   p->stop = &stop_robot;
   p->loop = &loop_robot;
@@ -0,0 +1,142 @@
+/**
+ * @file        : rt_profile
+ * @created     : Sunday Oct 18, 2026 16:09:48 MDT
+ */
+
+#define _GNU_SOURCE
+#include "rt_profile.h"
+
+#include <alloca.h>
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "log.h"
+
+static void check(const char *thread_desc, const char *setting, int ok,
+                  int *failed) {
+  if (ok) {
+    log_info("RT %s: %s ... ok", thread_desc, setting);
+  } else {
+    log_warn("RT %s: %s ... FAILED (%s)", thread_desc, setting,
+             strerror(errno));
+    (*failed)++;
+  }
+}
+
+// Reads VmLck out of /proc/self/status, -1 if we couldn't
+static long locked_kb() {
+  char line[128];
+  long kb = -1;
+  FILE *status = fopen("/proc/self/status", "r");
+  if (!status)
+    return -1;
+  while (fgets(line, sizeof(line), status))
+    if (sscanf(line, "VmLck: %ld kB", &kb) == 1)
+      break;
+  fclose(status);
+  return kb;
+}
+
+// Touches size bytes of this thread's stack so it's mapped (and locked)
+// before the loop needs it
+static void __attribute__((noinline)) prefault_stack(size_t size) {
+  unsigned char *stack = alloca(size);
+  memset(stack, 0, size);
+  __asm__ volatile("" : : "r"(stack) : "memory");
+}
+
+struct rt_config create_rt_config() {
+  struct rt_config config;
+  config.enabled = 0;
+  config.wii_priority = RT_WII_PRIORITY;
+  config.serial_priority = RT_SERIAL_PRIORITY;
+  config.cpu = -1;
+  config.stack_prefault = RT_STACK_PREFAULT;
+  config.heap_prealloc = RT_HEAP_PREALLOC;
+  return config;
+}
+
+int rt_process_setup(const struct rt_config *config) {
+  int failed = 0;
+  long page = sysconf(_SC_PAGESIZE);
+  unsigned char *heap;
+  size_t i;
+
+  if (!config->enabled)
+    return 0;
+
+  check("process", "mlockall", mlockall(MCL_CURRENT | MCL_FUTURE) == 0,
+        &failed);
+  check("process", "memory locked", locked_kb() > 0, &failed);
+
+  // Keep freed memory in the main arena: no trimming, no mmap for big
+  // chunks and no per thread arenas
+  errno = EINVAL; // mallopt doesn't set errno
+  check("process", "malloc tuning",
+        mallopt(M_TRIM_THRESHOLD, -1) && mallopt(M_MMAP_MAX, 0) &&
+            mallopt(M_ARENA_MAX, 1),
+        &failed);
+
+  heap = malloc(config->heap_prealloc);
+  if (heap) {
+    for (i = 0; i < config->heap_prealloc; i += page)
+      heap[i] = 0;
+    free(heap);
+  }
+  check("process", "heap preallocation", heap != NULL, &failed);
+  return failed;
+}
+
+int rt_thread_setup(const struct rt_config *config, const char *thread_desc,
+                    int priority) {
+  int failed = 0;
+  int policy;
+  long faults;
+  struct rusage usage;
+  struct sched_param param;
+  cpu_set_t cpus;
+  char setting[64];
+
+  if (!config->enabled)
+    return 0;
+
+  param.sched_priority = priority;
+  errno = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (!errno)
+    errno = pthread_getschedparam(pthread_self(), &policy, &param);
+  snprintf(setting, sizeof(setting), "SCHED_FIFO priority %d", priority);
+  check(thread_desc, setting,
+        !errno && policy == SCHED_FIFO && param.sched_priority == priority,
+        &failed);
+
+  if (config->cpu >= 0) {
+    CPU_ZERO(&cpus);
+    CPU_SET(config->cpu, &cpus);
+    errno = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (!errno)
+      errno = pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    snprintf(setting, sizeof(setting), "pinned to cpu %d", config->cpu);
+    check(thread_desc, setting,
+          !errno && CPU_COUNT(&cpus) == 1 && CPU_ISSET(config->cpu, &cpus),
+          &failed);
+  }
+
+  // If the first pass stuck, touching the stack again doesn't fault
+  prefault_stack(config->stack_prefault);
+  getrusage(RUSAGE_THREAD, &usage);
+  faults = usage.ru_minflt + usage.ru_majflt;
+  prefault_stack(config->stack_prefault);
+  getrusage(RUSAGE_THREAD, &usage);
+  errno = EFAULT;
+  check(thread_desc, "stack prefaulted",
+        usage.ru_minflt + usage.ru_majflt == faults, &failed);
+  return failed;
+}
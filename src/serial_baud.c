@@ -0,0 +1,68 @@
+/**
+ * @file        : serial_baud
+ * @created     : Sunday Oct 18, 2026 16:30:54 MDT
+ */
+
+#include "serial_baud.h"
+
+// Not <termios.h>, see the header
+#include <asm/termbits.h>
+#include <errno.h>
+#include <linux/serial.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "log.h"
+
+// How far off the driver's rate can be, a UART tolerates a few percent
+#define BAUD_TOLERANCE_PERCENT 2
+
+int serial_set_baud(int fd, int baud) {
+  struct termios2 tio;
+  int actual;
+
+  if (baud <= 0) {
+    log_error("Invalid baud %d", baud);
+    return -1;
+  }
+
+  if (ioctl(fd, TCGETS2, &tio) == -1) {
+    log_error("Error %d getting termios2: %s", errno, strerror(errno));
+    return -1;
+  }
+  tio.c_cflag &= ~CBAUD;
+  tio.c_cflag |= BOTHER;
+  tio.c_cflag &= ~(CBAUD << IBSHIFT); // input follows output
+  tio.c_ispeed = baud;
+  tio.c_ospeed = baud;
+  if (ioctl(fd, TCSETS2, &tio) == -1) {
+    log_error("Error %d setting baud %d: %s", errno, baud, strerror(errno));
+    return -1;
+  }
+
+  actual = serial_get_baud(fd);
+  if (actual == -1 || actual * 100 < baud * (100 - BAUD_TOLERANCE_PERCENT) ||
+      actual * 100 > baud * (100 + BAUD_TOLERANCE_PERCENT)) {
+    log_error("Asked for baud %d, the driver gave us %d", baud, actual);
+    return -1;
+  }
+  return 0;
+}
+
+int serial_get_baud(int fd) {
+  struct termios2 tio;
+  if (ioctl(fd, TCGETS2, &tio) == -1)
+    return -1;
+  return tio.c_ospeed;
+}
+
+int serial_low_latency(int fd) {
+  struct serial_struct serial;
+
+  if (ioctl(fd, TIOCGSERIAL, &serial) == -1)
+    return -1;
+  serial.flags |= ASYNC_LOW_LATENCY;
+  if (ioctl(fd, TIOCSSERIAL, &serial) == -1)
+    return -1;
+  return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file        : serial_writer
+ * @created     : Sunday Oct 18, 2026 16:26:43 MDT
+ */
+
+#include "serial_writer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "periodic.h"
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1000000LL
+#define BITS_PER_BYTE 10 // start + 8 data + stop
+
+// Moves the pending frame to buf if the queue has drained enough
+static int start_pending(struct serial_writer *writer, int64_t now) {
+  struct proto_frame *frame = &writer->pending;
+  int queued = serial_writer_queued(writer);
+
+  if (queued > writer->max_queued) {
+    // Come back about when it should have drained
+    writer->retry_ns = now + (queued - writer->max_queued) * writer->byte_ns;
+    writer->held++;
+    return 0;
+  }
+
+  frame->seq = writer->seq;
+  if (!writer->xbee) {
+    writer->len = proto_encode(frame, writer->buf);
+    writer->off = 0;
+  } else if (xbee_add(writer->xbee, frame)) {
+    // The batch is full, it empties when the packet in flight is done
+    writer->retry_ns = xbee_next_ns(writer->xbee);
+    writer->held++;
+    return 0;
+  }
+  writer->seq++;
+  writer->has_pending = 0;
+  writer->sent.type = frame->type;
+  writer->sent.seq = frame->seq;
+  writer->sent.submitted_ns = writer->pending_ns;
+  writer->frames++;
+  return 1;
+}
+
+// Puts the next xbee packet in buf, 0 if the radio isn't ready for one
+static size_t next_packet(struct serial_writer *writer, int64_t now) {
+  writer->len = xbee_packet(writer->xbee, writer->buf, now);
+  writer->off = 0;
+  return writer->len;
+}
+
+// Nothing went out: BUSY if something is still waiting to
+static int idle_status(const struct serial_writer *writer) {
+  if (writer->has_pending)
+    return SERIAL_WRITER_BUSY;
+  if (writer->xbee && xbee_next_ns(writer->xbee) != INT64_MAX)
+    return SERIAL_WRITER_BUSY;
+  return SERIAL_WRITER_IDLE;
+}
+
+void serial_writer_init(struct serial_writer *writer, int fd, int baud,
+                        int max_queued, struct xbee_link *xbee) {
+  memset(writer, 0, sizeof(*writer));
+  writer->fd = fd;
+  writer->xbee = xbee;
+  writer->max_queued = max_queued;
+  writer->byte_ns = baud > 0 ? NS_PER_SEC * BITS_PER_BYTE / baud : NS_PER_MS;
+}
+
+void serial_writer_reopen(struct serial_writer *writer, int fd, int baud) {
+  writer->fd = fd;
+  writer->byte_ns = baud > 0 ? NS_PER_SEC * BITS_PER_BYTE / baud : NS_PER_MS;
+  writer->has_pending = 0;
+  writer->len = 0;
+  writer->off = 0;
+  writer->retry_ns = 0;
+  if (writer->xbee)
+    xbee_reset(writer->xbee);
+}
+
+int serial_writer_queued(const struct serial_writer *writer) {
+  int queued;
+  if (ioctl(writer->fd, TIOCOUTQ, &queued) == -1)
+    return -1;
+  return queued;
+}
+
+int64_t serial_writer_ready_ns(const struct serial_writer *writer) {
+  int queued;
+
+  if (writer->has_pending || writer->off != writer->len ||
+      (writer->xbee && xbee_busy(writer->xbee)))
+    return INT64_MAX;
+  queued = serial_writer_queued(writer);
+  if (queued <= writer->max_queued)
+    return 0;
+  return monotonic_ns() + (queued - writer->max_queued) * writer->byte_ns;
+}
+
+size_t serial_writer_submit(struct serial_writer *writer,
+                            const struct proto_frame *frame, int64_t now_ns) {
+  uint8_t encoded[PROTO_MAX_ENCODED];
+
+  if (writer->has_pending)
+    writer->replaced++;
+  writer->pending = *frame;
+  writer->pending_ns = now_ns;
+  writer->has_pending = 1;
+  writer->retry_ns = 0;
+  return proto_encode(frame, encoded);
+}
+
+int serial_writer_flush(struct serial_writer *writer) {
+  int64_t now = monotonic_ns();
+  int started = 0;
+  ssize_t ret;
+
+  for (;;) {
+    if (writer->off == writer->len) {
+      if (writer->has_pending && start_pending(writer, now))
+        started = 1;
+      else if (!writer->xbee)
+        return started ? SERIAL_WRITER_STARTED : idle_status(writer);
+
+      // In API mode started only means it's in the next packet
+      if (writer->xbee && !next_packet(writer, now))
+        return started ? SERIAL_WRITER_STARTED : idle_status(writer);
+    }
+
+    ret = write(writer->fd, writer->buf + writer->off,
+                writer->len - writer->off);
+    if (ret == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN) {
+        writer->retry_ns = now + writer->byte_ns;
+        return started ? SERIAL_WRITER_STARTED : SERIAL_WRITER_BUSY;
+      }
+      log_error("Error %d writing serial: %s", errno, strerror(errno));
+      return -1;
+    }
+    if ((size_t)ret < writer->len - writer->off)
+      writer->partial++;
+    writer->off += ret;
+    writer->written += ret;
+  }
+}
+
+int64_t serial_writer_next_ns(const struct serial_writer *writer) {
+  int64_t next = INT64_MAX;
+
+  if (writer->has_pending || writer->off != writer->len)
+    next = writer->retry_ns;
+  // A status timeout or a batch waiting for the radio
+  if (writer->xbee && writer->off == writer->len &&
+      xbee_next_ns(writer->xbee) < next)
+    next = xbee_next_ns(writer->xbee);
+  return next;
+}
+
+void serial_writer_log(const struct serial_writer *writer) {
+  log_info("Serial writer: %llu frames, %llu stale replaced, %llu held for "
+           "the queue, %llu partial writes",
+           (unsigned long long)writer->frames,
+           (unsigned long long)writer->replaced,
+           (unsigned long long)writer->held,
+           (unsigned long long)writer->partial);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file        : stats
+ * @created     : Sunday Oct 18, 2026 16:08:39 MDT
+ */
+
+#include "stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+
+#define NS_PER_MS 1000000.0
+#define NS_PER_US 1000
+
+// Top of bucket i in nanoseconds
+static int64_t bucket_top(int i) { return ((int64_t)1 << i) * NS_PER_US; }
+
+void stats_reset(struct running_stats *stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+void stats_add(struct running_stats *stats, int64_t value) {
+  double delta;
+
+  stats->count++;
+  if (stats->count == 1 || value < stats->min)
+    stats->min = value;
+  if (stats->count == 1 || value > stats->max)
+    stats->max = value;
+
+  delta = value - stats->mean;
+  stats->mean += delta / stats->count;
+  stats->m2 += delta * (value - stats->mean);
+}
+
+double stats_stddev(const struct running_stats *stats) {
+  if (stats->count < 2)
+    return 0;
+  return sqrt(stats->m2 / (stats->count - 1));
+}
+
+void stats_log_ns(const struct running_stats *stats, const char *desc) {
+  log_info("%s: %llu samples, min %.3f ms max %.3f ms mean %.3f ms, "
+           "jitter %.3f ms",
+           desc, (unsigned long long)stats->count, stats->min / NS_PER_MS,
+           stats->max / NS_PER_MS, stats->mean / NS_PER_MS,
+           stats_stddev(stats) / NS_PER_MS);
+}
+
+void histogram_reset(struct histogram *hist) {
+  memset(hist->counts, 0, sizeof(hist->counts));
+  stats_reset(&hist->stats);
+}
+
+void histogram_add(struct histogram *hist, int64_t ns) {
+  int64_t us = ns / NS_PER_US;
+  int i = 0;
+
+  while (us > 0 && i < HISTOGRAM_BUCKETS - 1) {
+    us >>= 1;
+    i++;
+  }
+  hist->counts[i]++;
+  stats_add(&hist->stats, ns);
+}
+
+int64_t histogram_percentile(const struct histogram *hist, double percent) {
+  uint64_t target = ceil(hist->stats.count * percent / 100);
+  uint64_t seen = 0;
+  int i;
+
+  if (!hist->stats.count)
+    return 0;
+  for (i = 0; i < HISTOGRAM_BUCKETS - 1; ++i) {
+    seen += hist->counts[i];
+    if (seen >= target)
+      return bucket_top(i);
+  }
+  return hist->stats.max;
+}
+
+void histogram_log_ns(const struct histogram *hist, const char *desc) {
+  char buckets[HISTOGRAM_BUCKETS * 24];
+  size_t len = 0;
+  int i;
+
+  stats_log_ns(&hist->stats, desc);
+  if (!hist->stats.count)
+    return;
+
+  buckets[0] = '\0';
+  for (i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    if (!hist->counts[i])
+      continue;
+    len += snprintf(buckets + len, sizeof(buckets) - len, " %s%g:%llu",
+                    i == HISTOGRAM_BUCKETS - 1 ? ">" : "<",
+                    bucket_top(i == HISTOGRAM_BUCKETS - 1 ? i - 1 : i) /
+                        NS_PER_MS,
+                    (unsigned long long)hist->counts[i]);
+  }
+  log_info("%s: p50 < %.3f ms p90 < %.3f ms p99 < %.3f ms, ms buckets%s",
+           desc, histogram_percentile(hist, 50) / NS_PER_MS,
+           histogram_percentile(hist, 90) / NS_PER_MS,
+           histogram_percentile(hist, 99) / NS_PER_MS, buckets);
+}
@@ -0,0 +1,226 @@
+/**
+ * @file        : telemetry
+ * @created     : Sunday Oct 18, 2026 16:20:52 MDT
+ */
+
+#include "telemetry.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "periodic.h"
+
+// Warns when the teensy's counters went up between two reports
+static void check_link(const struct proto_telemetry *prev,
+                       const struct proto_telemetry *next) {
+  uint16_t bad = (uint16_t)(next->crc_errors - prev->crc_errors) +
+                 (uint16_t)(next->framing_errors - prev->framing_errors);
+  uint16_t lost = next->lost_frames - prev->lost_frames;
+  uint16_t dropped = next->tx_dropped - prev->tx_dropped;
+  uint16_t overruns = next->overruns - prev->overruns;
+  uint16_t failsafes = next->failsafes - prev->failsafes;
+
+  if (bad || lost)
+    log_warn("Link: teensy dropped %u bad and missed %u frames", bad, lost);
+  if (dropped)
+    log_warn("Link: teensy skipped %u reports, its tx is backed up",
+             dropped);
+  if (overruns)
+    log_warn("Teensy: %u control ticks overran", overruns);
+  if (failsafes)
+    log_warn("Teensy: no command for too long, it stopped the robot");
+}
+
+static void handle_report(struct telemetry_reader *reader,
+                          const struct proto_telemetry *report, int64_t now) {
+  int64_t sent = reader->sent_ns[report->ack_seq];
+
+  if (reader->reports)
+    check_link(&reader->latest.report, report);
+
+  // Only the first report after a command applies counts
+  if (sent) {
+    stats_add(&reader->apply_ns, now - sent);
+    reader->sent_ns[report->ack_seq] = 0;
+  }
+
+  if (!reader->reports || report->supply_mv < reader->min_supply_mv)
+    reader->min_supply_mv = report->supply_mv;
+  if (report->busy_max_us > reader->busy_max_us)
+    reader->busy_max_us = report->busy_max_us;
+
+  reader->latest.report = *report;
+  reader->latest.received_ns = now;
+  reader->reports++;
+}
+
+// What telemetry_log calls each PROTO_PERF stage
+static const char *perf_names[PROTO_PERF_STAGES] = {
+    "loop", "listen", "frame", "report", "tick",
+    "speed", "mix", "profile", "pwm write"};
+
+static void handle_perf(struct telemetry_reader *reader,
+                        const struct proto_perf *perf) {
+  struct telemetry_perf *stage = &reader->perf[perf->stage];
+  int i;
+
+  reader->perf_frames++;
+  reader->mhz = perf->mhz;
+  if (perf->rx_peak > reader->rx_peak) {
+    if (perf->rx_peak >= TELEMETRY_RX_PEAK_WARN)
+      log_warn("Teensy: %u bytes backed up in Serial1, loop() isn't keeping "
+               "up",
+               perf->rx_peak);
+    reader->rx_peak = perf->rx_peak;
+  }
+  if (!perf->count)
+    return;
+
+  if (!stage->runs || perf->min_cycles < stage->min)
+    stage->min = perf->min_cycles;
+  if (perf->max_cycles > stage->max)
+    stage->max = perf->max_cycles;
+  stage->runs += perf->count;
+  stage->cycles += (uint64_t)perf->mean_cycles * perf->count;
+  for (i = 0; i < PROTO_PERF_BUCKETS; ++i)
+    stage->hist[i] += perf->hist[i];
+}
+
+// The top of the bucket percent of the stage's runs fit in, in cycles. The
+// histogram saturates on the teensy, so this goes by its total not runs
+static uint32_t perf_percentile(const struct telemetry_perf *stage,
+                                double percent) {
+  uint64_t total = 0, seen = 0, target;
+  int i;
+
+  for (i = 0; i < PROTO_PERF_BUCKETS; ++i)
+    total += stage->hist[i];
+  target = ceil(total * percent / 100);
+  for (i = 0; i < PROTO_PERF_BUCKETS - 1; ++i) {
+    seen += stage->hist[i];
+    if (seen >= target)
+      return 1u << (PROTO_PERF_SHIFT + i);
+  }
+  return stage->max;
+}
+
+static void perf_log(const struct telemetry_reader *reader) {
+  double mhz = reader->mhz;
+  int i;
+
+  for (i = 0; i < PROTO_PERF_STAGES; ++i) {
+    const struct telemetry_perf *stage = &reader->perf[i];
+
+    if (!stage->runs)
+      continue;
+    log_info("Teensy %s: %llu runs, min %.2f us max %.2f us mean %.2f us, "
+             "p50 < %.2f us p99 < %.2f us",
+             perf_names[i], (unsigned long long)stage->runs, stage->min / mhz,
+             stage->max / mhz, (double)stage->cycles / stage->runs / mhz,
+             perf_percentile(stage, 50) / mhz,
+             perf_percentile(stage, 99) / mhz);
+  }
+  log_info("Teensy: at most %u bytes waiting in Serial1", reader->rx_peak);
+}
+
+// Decodes a run of raw protocol bytes, returns the number of reports and
+// poses
+static int decode(struct telemetry_reader *reader, const uint8_t *data,
+                  size_t len, int64_t now) {
+  struct proto_telemetry report;
+  struct proto_pose pose;
+  struct proto_perf perf;
+  struct proto_pong pong;
+  size_t i;
+  int reports = 0;
+
+  for (i = 0; i < len; ++i) {
+    if (proto_decode_byte(&reader->decoder, data[i], &reader->frame) !=
+        PROTO_FRAME)
+      continue;
+    if (proto_unpack_telemetry(&reader->frame, &report)) {
+      handle_report(reader, &report, now);
+      reports++;
+    } else if (proto_unpack_pose(&reader->frame, &pose)) {
+      reader->latest.pose = pose;
+      reader->latest.pose_ns = now;
+      reader->poses++;
+      reports++;
+    } else if (proto_unpack_perf(&reader->frame, &perf)) {
+      handle_perf(reader, &perf);
+    } else if (reader->probe && proto_unpack_pong(&reader->frame, &pong)) {
+      probe_pong(reader->probe, &pong, now);
+    } else {
+      reader->other_frames++;
+    }
+  }
+  return reports;
+}
+
+void telemetry_init(struct telemetry_reader *reader,
+                    struct latency_probe *probe, struct xbee_link *xbee) {
+  memset(reader, 0, sizeof(*reader));
+  reader->probe = probe;
+  reader->xbee = xbee;
+  proto_decoder_init(&reader->decoder);
+  stats_reset(&reader->apply_ns);
+}
+
+void telemetry_sent(struct telemetry_reader *reader, uint8_t seq,
+                    int64_t now_ns) {
+  reader->sent_ns[seq] = now_ns;
+}
+
+int telemetry_read(struct telemetry_reader *reader, int fd) {
+  uint8_t buf[TELEMETRY_READ_SIZE];
+  struct xbee_link *xbee = reader->xbee;
+  int64_t now;
+  ssize_t len;
+  ssize_t i;
+  int reports = 0;
+
+  // Until there's nothing left (EAGAIN) or the port hung up (0)
+  while ((len = read(fd, buf, sizeof(buf))) > 0) {
+    now = monotonic_ns();
+    if (!xbee) {
+      reports += decode(reader, buf, len, now);
+      continue;
+    }
+    // Transmit Status frames are handled by the link itself
+    for (i = 0; i < len; ++i)
+      if (xbee_rx_byte(xbee, buf[i]))
+        reports += decode(reader, xbee->payload, xbee->payload_len, now);
+  }
+  if (len == -1 && errno != EAGAIN && errno != EINTR) {
+    log_error("Error %d reading serial: %s", errno, strerror(errno));
+    return -1;
+  }
+  return reports;
+}
+
+void telemetry_log(const struct telemetry_reader *reader) {
+  const struct proto_decoder *dec = &reader->decoder;
+  const struct proto_telemetry *last = &reader->latest.report;
+
+  log_info("Telemetry: %llu reports, %llu poses, %llu timings, %llu other "
+           "frames, host saw %u bad crc %u bad framing %u lost",
+           (unsigned long long)reader->reports,
+           (unsigned long long)reader->poses,
+           (unsigned long long)reader->perf_frames,
+           (unsigned long long)reader->other_frames, dec->crc_errors,
+           dec->framing_errors, dec->lost_frames);
+  if (!reader->reports)
+    return;
+  log_info("Telemetry: teensy saw %u bad crc %u bad framing %u lost, "
+           "skipped %u reports, supply min %u mV, tick max %u us, %u ticks "
+           "overran, %u failsafe stops",
+           last->crc_errors, last->framing_errors, last->lost_frames,
+           last->tx_dropped, reader->min_supply_mv, reader->busy_max_us,
+           last->overruns, last->failsafes);
+  stats_log_ns(&reader->apply_ns, "Send to apply latency");
+  if (reader->perf_frames && reader->mhz)
+    perf_log(reader);
+}
@@ -0,0 +1,44 @@
+/**
+ * @file        : triple_buffer
+ * @created     : Sunday Oct 18, 2026 16:11:03 MDT
+ */
+
+#include "triple_buffer.h"
+
+#include <string.h>
+
+void triple_buffer_init(struct triple_buffer *tb, void *slots, size_t size,
+                        const void *initial) {
+  int i;
+  tb->slots = slots;
+  tb->size = size;
+  for (i = 0; i < 3; ++i)
+    memcpy(tb->slots + i * size, initial, size);
+  tb->front = 0;
+  atomic_init(&tb->middle, 1);
+  tb->back = 2;
+}
+
+void *triple_buffer_back(struct triple_buffer *tb) {
+  return tb->slots + tb->back * tb->size;
+}
+
+void triple_buffer_publish(struct triple_buffer *tb) {
+  // Release makes the slot's contents visible before the index is
+  unsigned prev = atomic_exchange_explicit(&tb->middle, tb->back | TB_FRESH,
+                                           memory_order_acq_rel);
+  tb->back = prev & TB_INDEX_MASK;
+}
+
+int triple_buffer_update(struct triple_buffer *tb) {
+  unsigned prev;
+  if (!(atomic_load_explicit(&tb->middle, memory_order_relaxed) & TB_FRESH))
+    return 0;
+  prev = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+  tb->front = prev & TB_INDEX_MASK;
+  return 1;
+}
+
+const void *triple_buffer_front(const struct triple_buffer *tb) {
+  return tb->slots + tb->front * tb->size;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file        : tx_policy
+ * @created     : Sunday Oct 18, 2026 16:16:20 MDT
+ */
+
+#include "tx_policy.h"
+
+#include "log.h"
+
+#define NS_PER_SEC 1e9
+#define NS_PER_MS 1e6
+#define BITS_PER_BYTE 10 // start + 8 data + stop
+
+// The time the link needs to drain the last frame, with headroom
+static void update_spacing(struct tx_policy *policy) {
+  double drain_ns = 0;
+
+  if (policy->bytes_per_sec > 0)
+    drain_ns = policy->last_bytes * TX_HEADROOM / policy->bytes_per_sec *
+               NS_PER_SEC;
+  policy->spacing_ns = policy->min_spacing_ns;
+  if (drain_ns > policy->spacing_ns)
+    policy->spacing_ns = drain_ns < policy->keepalive_ns
+                             ? (int64_t)drain_ns
+                             : policy->keepalive_ns;
+  // A change should never wait longer than a keepalive would
+  if (policy->spacing_ns > policy->keepalive_ns)
+    policy->spacing_ns = policy->keepalive_ns;
+}
+
+void tx_policy_init(struct tx_policy *policy, double min_spacing,
+                    double keepalive, int baud) {
+  policy->min_spacing_ns = min_spacing * NS_PER_SEC;
+  policy->keepalive_ns = keepalive * NS_PER_SEC;
+  policy->spacing_ns = policy->min_spacing_ns;
+  policy->last_send_ns = 0;
+  policy->last_bytes = 0;
+  policy->last_sample_ns = 0;
+  policy->last_queued = 0;
+  policy->last_written = 0;
+  policy->pending = 0;
+  policy->line_rate = (double)baud / BITS_PER_BYTE;
+  policy->bytes_per_sec = policy->line_rate;
+  policy->samples = 0;
+  policy->frames = 0;
+  policy->keepalives = 0;
+  policy->changes = 0;
+}
+
+void tx_policy_set_baud(struct tx_policy *policy, int baud) {
+  policy->line_rate = (double)baud / BITS_PER_BYTE;
+  policy->bytes_per_sec = policy->line_rate;
+  policy->last_sample_ns = 0;
+  policy->last_queued = 0;
+  update_spacing(policy);
+}
+
+void tx_policy_set_min_spacing(struct tx_policy *policy, double min_spacing) {
+  policy->min_spacing_ns = min_spacing * NS_PER_SEC;
+  // The next send works out the link's part again
+  policy->spacing_ns = policy->min_spacing_ns;
+  if (policy->spacing_ns > policy->keepalive_ns)
+    policy->spacing_ns = policy->keepalive_ns;
+}
+
+void tx_policy_changed(struct tx_policy *policy) {
+  policy->pending = 1;
+  policy->changes++;
+}
+
+int tx_policy_due(const struct tx_policy *policy, int64_t now_ns) {
+  return now_ns >= tx_policy_next_ns(policy);
+}
+
+int64_t tx_policy_next_ns(const struct tx_policy *policy) {
+  if (policy->last_send_ns == 0)
+    return 0;
+  return policy->last_send_ns +
+         (policy->pending ? policy->spacing_ns : policy->keepalive_ns);
+}
+
+int64_t tx_policy_sample_ns(const struct tx_policy *policy, uint64_t written) {
+  // Something new went out, where the queue starts from
+  if (written != policy->last_written)
+    return 0;
+  if (policy->last_queued <= 0)
+    return INT64_MAX;
+  return policy->last_sample_ns + (int64_t)(TX_SAMPLE * NS_PER_SEC);
+}
+
+void tx_policy_drained(struct tx_policy *policy, int64_t now_ns, int queued,
+                       uint64_t written) {
+  double elapsed = (now_ns - policy->last_sample_ns) / NS_PER_SEC;
+  double rate;
+
+  if (queued < 0)
+    return;
+  if (policy->last_sample_ns && elapsed > 0) {
+    // What left the tty: written since, plus what the queue went down by
+    rate = ((double)(written - policy->last_written) + policy->last_queued -
+            queued) /
+           elapsed;
+    if (policy->last_queued > 0 && queued > 0 &&
+        written == policy->last_written) {
+      // Busy the whole time, so that's the link's throughput
+      policy->bytes_per_sec = (1 - TX_EWMA_WEIGHT) * policy->bytes_per_sec +
+                              TX_EWMA_WEIGHT * rate;
+      policy->samples++;
+    } else if (rate > policy->bytes_per_sec) {
+      // Idle for part of it, so the link is at least this fast
+      policy->bytes_per_sec = rate;
+    }
+    // Nothing goes faster than the baud, a pty drains instantly
+    if (policy->bytes_per_sec > policy->line_rate)
+      policy->bytes_per_sec = policy->line_rate;
+    update_spacing(policy);
+  }
+  policy->last_sample_ns = now_ns;
+  policy->last_queued = queued;
+  policy->last_written = written;
+}
+
+void tx_policy_sent(struct tx_policy *policy, int64_t now_ns, size_t bytes) {
+  policy->last_bytes = bytes;
+  update_spacing(policy);
+
+  if (!policy->pending)
+    policy->keepalives++;
+  policy->frames++;
+  policy->pending = 0;
+  policy->last_send_ns = now_ns;
+}
+
+void tx_policy_log(const struct tx_policy *policy) {
+  log_info("Serial tx: %llu frames (%llu keepalives) for %llu changes, "
+           "link %.0f bytes/s (%llu drain samples), spacing %.3f ms",
+           (unsigned long long)policy->frames,
+           (unsigned long long)policy->keepalives,
+           (unsigned long long)policy->changes, policy->bytes_per_sec,
+           (unsigned long long)policy->samples,
+           policy->spacing_ns / NS_PER_MS);
+}
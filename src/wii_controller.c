@@ -44,8 +44,9 @@ short heart_beat(wiimote **wm, int num_wiimotes) {
   return 0;
 }
 
-void event_loop(wiimote **wiimotes, struct robot_s *robot,
-                struct controller_s *controller) {
+int poll_controller(wiimote **wiimotes, struct robot_s *robot,
+                    struct controller_s *controller) {
+  int inputs = 0;
   if (wiiuse_poll(wiimotes, MAX_WIIMOTES)) {
     int i = 0;
     for (; i < MAX_WIIMOTES; ++i) {
@@ -53,6 +54,7 @@ void event_loop(wiimote **wiimotes, struct robot_s *robot,
       case WIIUSE_EVENT:
         /* a generic event occurred */
         collect_controller_state(robot, wiimotes[i], controller);
+        inputs++;
         break;
       case WIIUSE_DISCONNECT:
       case WIIUSE_UNEXPECTED_DISCONNECT:
@@ -86,6 +88,10 @@ void event_loop(wiimote **wiimotes, struct robot_s *robot,
       }
     }
   }
+  return inputs;
+}
+
+void print_state(struct robot_s *robot, struct controller_s *controller) {
   if (robot->options & VERBOSE) {
     if (robot->options & ADVNCD) {
       printf("ADVANCED\n");
@@ -112,8 +118,22 @@ void event_loop(wiimote **wiimotes, struct robot_s *robot,
       printf("gun: State - %d Left - %d Right - %d\n", robot->gun->state,
              robot->gun->left_mag, robot->gun->right_mag);
     }
+    if (robot->telemetry.received_ns) {
+      const struct proto_telemetry *report = &robot->telemetry.report;
+      printf("teensy: Supply - %d mV  Loop - %d us  Applied - %d\n",
+             report->supply_mv, report->period_us, report->ack_seq);
+      printf("wheels: Left - %d mm/s  Right - %d mm/s\n", report->speed[0],
+             report->speed[1]);
+    }
   }
+}
+
+int event_loop(wiimote **wiimotes, struct robot_s *robot,
+               struct controller_s *controller) {
+  int inputs = poll_controller(wiimotes, robot, controller);
+  print_state(robot, controller);
   (*robot->p->loop)(robot);
+  return inputs;
 }
 
 void set_controller_zero(struct controller_s *controller) {
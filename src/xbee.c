@@ -0,0 +1,236 @@
+/**
+ * @file        : xbee
+ * @created     : Sunday Oct 18, 2026 16:44:21 MDT
+ */
+
+#include "xbee.h"
+
+#include <string.h>
+
+#include "log.h"
+
+#define NS_PER_SEC 1000000000LL
+#define XBEE_HEADER_SIZE 3 // Start and length
+#define XBEE_TX_DATA 14 // Transmit Request bytes before the RF data
+#define XBEE_STATUS_SIZE 7 // Transmit Status frame data
+#define XBEE_RX_DATA 12 // Receive Packet bytes before the RF data
+#define XBEE_DEST_16 0xFFFE // Unknown, the radio looks it up
+#define XBEE_DELIVERED 0x00
+
+static uint8_t checksum(const uint8_t *data, size_t len) {
+  uint8_t sum = 0;
+  size_t i;
+  for (i = 0; i < len; ++i)
+    sum += data[i];
+  return 0xFF - sum;
+}
+
+// The packet in flight didn't make it, send it again or give up on it. If it
+// had a command and a newer one is already waiting, resending is no use
+static void tx_failed(struct xbee_link *xbee) {
+  xbee->frame_id = 0;
+  if ((xbee->flight_drive && xbee->drive_off != -1) ||
+      xbee->tries > xbee->max_retries) {
+    xbee->lost++;
+    return;
+  }
+  xbee->resend = 1;
+}
+
+void xbee_init(struct xbee_link *xbee, uint64_t dest, int max_retries,
+               double status_timeout) {
+  memset(xbee, 0, sizeof(*xbee));
+  xbee->dest = dest;
+  xbee->max_retries = max_retries;
+  xbee->timeout_ns = status_timeout * NS_PER_SEC;
+  xbee->next_id = 1;
+  xbee->drive_off = -1;
+}
+
+void xbee_reset(struct xbee_link *xbee) {
+  xbee->frame_id = 0;
+  xbee->resend = 0;
+  xbee->flight_len = 0;
+  xbee->flight_drive = 0;
+  xbee->batch_len = 0;
+  xbee->batch_frames = 0;
+  xbee->drive_off = -1;
+  xbee->rx_len = 0;
+}
+
+int xbee_add(struct xbee_link *xbee, const struct proto_frame *frame) {
+  uint8_t encoded[PROTO_MAX_ENCODED];
+  size_t len = proto_encode(frame, encoded);
+  size_t end;
+
+  if (proto_is_command(frame->type) && xbee->drive_off != -1) {
+    end = xbee->drive_off + xbee->drive_len;
+    memmove(xbee->batch + xbee->drive_off, xbee->batch + end,
+            xbee->batch_len - end);
+    xbee->batch_len -= xbee->drive_len;
+    xbee->batch_frames--;
+    xbee->drive_off = -1;
+    xbee->replaced++;
+  }
+  if (xbee->batch_len + len > XBEE_MAX_PAYLOAD)
+    return -1;
+
+  if (proto_is_command(frame->type)) {
+    xbee->drive_off = xbee->batch_len;
+    xbee->drive_len = len;
+  }
+  memcpy(xbee->batch + xbee->batch_len, encoded, len);
+  xbee->batch_len += len;
+  xbee->batch_frames++;
+  xbee->frames++;
+  return 0;
+}
+
+size_t xbee_packet(struct xbee_link *xbee, uint8_t *out, int64_t now_ns) {
+  uint8_t *data = out + XBEE_HEADER_SIZE;
+  size_t len;
+  int i;
+
+  if (xbee->frame_id) {
+    if (now_ns < xbee->deadline_ns)
+      return 0;
+    xbee->timeouts++;
+    tx_failed(xbee);
+  }
+
+  if (xbee->resend) {
+    xbee->resend = 0;
+    xbee->retried++;
+    xbee->tries++;
+  } else if (xbee->batch_len) {
+    memcpy(xbee->flight, xbee->batch, xbee->batch_len);
+    xbee->flight_len = xbee->batch_len;
+    xbee->flight_drive = xbee->drive_off != -1;
+    xbee->batch_len = 0;
+    xbee->batch_frames = 0;
+    xbee->drive_off = -1;
+    xbee->tries = 1;
+  } else {
+    return 0;
+  }
+
+  xbee->frame_id = xbee->next_id;
+  xbee->next_id = xbee->next_id == UINT8_MAX ? 1 : xbee->next_id + 1;
+  xbee->deadline_ns = now_ns + xbee->timeout_ns;
+  xbee->packets++;
+
+  // Transmit Request: api id, frame id, 64 and 16 bit destination, radius,
+  // options, then our bytes
+  data[0] = XBEE_TX_REQUEST;
+  data[1] = xbee->frame_id;
+  for (i = 0; i < 8; ++i)
+    data[2 + i] = xbee->dest >> (56 - 8 * i);
+  data[10] = XBEE_DEST_16 >> 8;
+  data[11] = XBEE_DEST_16 & 0xFF;
+  data[12] = 0; // Max hops
+  data[13] = 0; // Radio's default options
+  memcpy(data + XBEE_TX_DATA, xbee->flight, xbee->flight_len);
+
+  len = XBEE_TX_DATA + xbee->flight_len;
+  out[0] = XBEE_START;
+  out[1] = len >> 8;
+  out[2] = len & 0xFF;
+  data[len] = checksum(data, len);
+  return XBEE_HEADER_SIZE + len + 1;
+}
+
+int64_t xbee_next_ns(const struct xbee_link *xbee) {
+  if (xbee->frame_id)
+    return xbee->deadline_ns;
+  if (xbee->resend || xbee->batch_len)
+    return 0;
+  return INT64_MAX;
+}
+
+int xbee_busy(const struct xbee_link *xbee) { return xbee->frame_id != 0; }
+
+// A complete API frame (without start, length and checksum)
+static int handle_frame(struct xbee_link *xbee, const uint8_t *data,
+                        size_t len) {
+  switch (data[0]) {
+  case XBEE_TX_STATUS:
+    if (len < XBEE_STATUS_SIZE) {
+      xbee->rx_errors++;
+      return 0;
+    }
+    if (!data[1] || data[1] != xbee->frame_id) {
+      xbee->stale_status++;
+      return 0;
+    }
+    xbee->radio_retries += data[4];
+    if (data[5] == XBEE_DELIVERED) {
+      xbee->delivered++;
+      xbee->frame_id = 0;
+    } else {
+      xbee->failed++;
+      tx_failed(xbee);
+    }
+    return 0;
+  case XBEE_RX_PACKET:
+    if (len < XBEE_RX_DATA) {
+      xbee->rx_errors++;
+      return 0;
+    }
+    xbee->payload = data + XBEE_RX_DATA;
+    xbee->payload_len = len - XBEE_RX_DATA;
+    xbee->rx_packets++;
+    return 1;
+  default:
+    xbee->rx_other++;
+    return 0;
+  }
+}
+
+int xbee_rx_byte(struct xbee_link *xbee, uint8_t byte) {
+  size_t len;
+
+  // Anything between frames is skipped until the next start byte
+  if (!xbee->rx_len && byte != XBEE_START)
+    return 0;
+  xbee->rx[xbee->rx_len++] = byte;
+  if (xbee->rx_len < XBEE_HEADER_SIZE)
+    return 0;
+
+  len = xbee->rx[1] << 8 | xbee->rx[2];
+  if (!len || XBEE_HEADER_SIZE + len + 1 > sizeof(xbee->rx)) {
+    xbee->rx_errors++;
+    xbee->rx_len = 0;
+    return 0;
+  }
+  if (xbee->rx_len < XBEE_HEADER_SIZE + len + 1)
+    return 0;
+
+  xbee->rx_len = 0;
+  if (checksum(xbee->rx + XBEE_HEADER_SIZE, len) !=
+      xbee->rx[XBEE_HEADER_SIZE + len]) {
+    xbee->rx_errors++;
+    return 0;
+  }
+  return handle_frame(xbee, xbee->rx + XBEE_HEADER_SIZE, len);
+}
+
+void xbee_log(const struct xbee_link *xbee) {
+  log_info("XBee: %llu packets for %llu frames (%llu drives replaced in a "
+           "batch), %llu delivered, %llu failed, %llu timed out, %llu "
+           "retried, %llu lost",
+           (unsigned long long)xbee->packets,
+           (unsigned long long)xbee->frames,
+           (unsigned long long)xbee->replaced,
+           (unsigned long long)xbee->delivered,
+           (unsigned long long)xbee->failed,
+           (unsigned long long)xbee->timeouts,
+           (unsigned long long)xbee->retried,
+           (unsigned long long)xbee->lost);
+  log_info("XBee: radio retried %llu times, %llu late statuses, %llu packets "
+           "received, %llu bad api frames, %llu other api frames",
+           (unsigned long long)xbee->radio_retries,
+           (unsigned long long)xbee->stale_status,
+           (unsigned long long)xbee->rx_packets,
+           (unsigned long long)xbee->rx_errors,
+           (unsigned long long)xbee->rx_other);
+}
@@ -2,38 +2,46 @@
 #define ROBOT_H
 
 #include "Arduino.h"
+#include "robot_core.h"
 
 /**
  * I know this is lazy, but I'm lazy, also c++ is for dweeps, so
  * we want to keep memory allocation concentrated to compile time
  * macros are the best way to store data without memory allocation
  * this lets that smart ass compiler do its shit better
+ *
+ * This is the board: pins, calibration and the hal.h functions on top of
+ * Arduino. Everything else is in lib/robot_core so it runs off the board too
  */
 // PWM Constants
-#define PWM_SCALAR 5.12
-#define PWM_ZERO 1535
 #define PWM_RES 12
 #define PWM_INIT 250
 
-// Throttle and Robot Constants
-#define MAX_THROTTLE 100
-#define BAUD 9600
-#define NUM_MOTORS 6
-
-// Pins and indexes
-#define LF_INDEX 0
-#define LB_INDEX 1
-#define RF_INDEX 2
-#define RB_INDEX 3
-#define GUN_1_IN 4
-#define GUN_2_IN 5
-
+// Pins. The encoders need FTM1 and FTM2 as quadrature decoders, which takes
+// their pins (3, 4, 29, 30) away from the escs
+#ifdef ENCODERS
+#define LF_PIN 6
+#define GUN_1 35
+#define GUN_2 36
+#else
 #define LF_PIN 4
+#define GUN_1 29
+#define GUN_2 30
+#endif
 #define LB_PIN 5
 #define RF_PIN 16
 #define RB_PIN 7
-#define GUN_1 29
-#define GUN_2 30
+
+// Encoders, left on FTM1 (pins 3 and 4), right on FTM2 (pins 29 and 30)
+#define WHEEL_MM_PER_COUNT 0.23f // 150 mm wheels, 512 lines counted x4
+
+// Serial1's rx ring is 64 bytes, about 0.3 ms at BAUD_MAX. This is added to
+// it so a control step never makes us drop bytes
+#define RX_BUFFER_SIZE 1024
+
+// Telemetry
+#define VBAT_PIN A9
+#define VBAT_MV_PER_COUNT 35.48 // 3.3 V over 10 bits behind an 11:1 divider
 
 #define LED1 15
 #define LED2 18
@@ -42,10 +50,6 @@ int led1;
 int led2;
 int led3;
 
-// Signals
-#define DRIVE 'd'
-#define STOP 's'
-
 void led_toggle(int led, int pin) {
   if (led)
     digitalWrite(pin, HIGH);
@@ -54,109 +58,105 @@ void led_toggle(int led, int pin) {
   led = !led;
 }
 
+// Indexed like the motors, tune these per esc
+const struct motor_cal motor_cals[NUM_MOTORS] = {
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT,
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT};
+
+// Indexed like the wheels, without encoders the speed loops are feedforward
+#ifdef ENCODERS
+const struct wheel_cal wheel_cals[NUM_WHEELS] = {
+    {WHEEL_MM_PER_COUNT, PID_GAINS_DEFAULT},
+    {WHEEL_MM_PER_COUNT, PID_GAINS_DEFAULT}};
+#else
+const struct wheel_cal wheel_cals[NUM_WHEELS] = {WHEEL_CAL_DEFAULT,
+                                                 WHEEL_CAL_DEFAULT};
+#endif
+
+// One FTM in quadrature decoder mode, free running over the whole 16 bits
+#define QUAD_INIT(ftm)                                                         \
+  do {                                                                         \
+    ftm##_MODE = FTM_MODE_WPDIS | FTM_MODE_FTMEN;                              \
+    ftm##_SC = 0;                                                              \
+    ftm##_CNTIN = 0;                                                           \
+    ftm##_MOD = 0xFFFF;                                                        \
+    ftm##_CNT = 0;                                                             \
+    ftm##_QDCTRL = FTM_QDCTRL_QUADEN;                                          \
+    ftm##_SC = FTM_SC_CLKS(1);                                                 \
+  } while (0)
+
 /**
- * @brief Initialize motors
- * @note this is the most "changeable" thing - i.e. essentially this
- * is hard coded
- *
- * @param motors a motor array pointer
+ * @brief Starts the encoder counters, nothing without ENCODERS
  */
-void configure_motors(int motors[NUM_MOTORS]) {
-  led1 = 1;
-  led2 = 0;
-  led3 = 0;
-  motors[LF_INDEX] = LF_PIN;
-  motors[LB_INDEX] = LB_PIN;
-  motors[RB_INDEX] = RF_PIN;
-  motors[RF_INDEX] = RB_PIN;
-  motors[GUN_1_IN] = GUN_1;
-  motors[GUN_2_IN] = GUN_2;
+void encoders_init() {
+#ifdef ENCODERS
+  CORE_PIN3_CONFIG = PORT_PCR_MUX(7);
+  CORE_PIN4_CONFIG = PORT_PCR_MUX(7);
+  CORE_PIN29_CONFIG = PORT_PCR_MUX(6);
+  CORE_PIN30_CONFIG = PORT_PCR_MUX(6);
+  QUAD_INIT(FTM1);
+  QUAD_INIT(FTM2);
+#endif
 }
 
-/**
- * @brief Convert a int8_t to a pwm likeable number //TODO change to macro
- *
- * @param throttle the dummed down throttle
- *
- * @return The nice PWM throttle
- */
-int convert(const int8_t &throttle_) {
-  int throttle;
-  if (throttle_ < -MAX_THROTTLE)
-    throttle = -MAX_THROTTLE;
-  else if (throttle_ > MAX_THROTTLE)
-    throttle = MAX_THROTTLE;
-  else
-    throttle = throttle_;
-  return PWM_ZERO + (throttle * PWM_SCALAR);
+// Each motor's esc pin, indexed like the motors. How the motors move the
+// robot is the mixer's business, and the host sends that
+const int motor_pins[NUM_MOTORS] = {LF_PIN, LB_PIN, RF_PIN,
+                                    RB_PIN, GUN_1,  GUN_2};
+
+// hal.h for the teensy
+extern "C" {
+
+uint32_t hal_millis(void) { return millis(); }
+
+uint32_t hal_micros(void) { return micros(); }
+
+// The DWT's counter, setup() turns it on
+uint32_t hal_cycles(void) { return ARM_DWT_CYCCNT; }
+
+uint32_t hal_cycles_per_us(void) { return F_CPU / 1000000; }
+
+int hal_serial_available(void) { return Serial1.available(); }
+
+int hal_serial_read(void) { return Serial1.read(); }
+
+size_t hal_serial_write_space(void) { return Serial1.availableForWrite(); }
+
+void hal_serial_write(const uint8_t *buf, size_t len) {
+  Serial1.write(buf, len);
 }
 
-/**
- * @brief Listens to the serial port and does stuff
- *
- * @param message A reference to a message so we are not allocating a ton of
- * data
- * @param lin A reference to a linear val so we are not allocating a ton of data
- * @param ang A reference to a ....
- */
-int success; // No allocations
-void serial_listen(char message[5], int8_t &lin, int8_t &ang, int8_t &gun1,
-                   int8_t &gun2) {
-  if (Serial1.available()) {
-    success = Serial1.readBytes(message, 5) == 5;
-
-    // here's our message format
-    if (success && message[0] == DRIVE) {
-
-      success = 1;
-      lin = (message[1] == -1 ? (success = 0) : 2 * message[1]);
-      ang = (message[2] == -1 ? (success = 0) : 2 * message[2]); // Temporary
-      gun1 = (message[3] == -1 ? (success = 0) : 2 * message[3]);
-      gun2 = (message[4] == -1 ? (success = 0) : 2 * message[4]);
-
-      success ? digitalWrite(LED2, HIGH) : digitalWrite(LED3, HIGH);
-    }
-
-    // Stop stops the robot.
-    else if (message[0] == STOP) {
-      lin = 0;
-      ang = 0;
-    } else { // I know it's redundant, but I'm gonna change this later
-      digitalWrite(LED3, HIGH); // Error
-      lin = 0;
-      ang = 0;
-    }
-  }
+void hal_serial_begin(uint32_t baud) {
+  Serial1.flush();
+  Serial1.begin(baud);
 }
 
-/**
- * @brief What did the chicken say to the dinosaur
- *
- * @param throttle I don't know
- * @param lin I didn't think this far ahead
- * @param ang Please don't get mad
- */
-void callback_velocity(int8_t throttle[NUM_MOTORS], const int8_t &lin,
-                       const int8_t &ang, const int8_t &gun1,
-                       const int8_t gun2) {
-  throttle[LF_INDEX] = -(lin + ang);
-  throttle[LB_INDEX] = -(lin + ang);
-  throttle[RF_INDEX] = lin - ang;
-  throttle[RB_INDEX] = lin - ang;
-  throttle[GUN_1_IN] = -gun1;
-  throttle[GUN_2_IN] = gun2;
+void hal_pwm_write(int motor, uint16_t duty) {
+  analogWrite(motor_pins[motor], duty);
 }
 
-/**
- * @brief Write to dem motors
- *
- * @param motors[NUM_MOTORS] The global motor array
- * @param throttle[NUM_MOTORS] The global throttle array
- */
-void motor_write(const int motors[NUM_MOTORS],
-                 const int8_t throttle[NUM_MOTORS]) {
-  for (int i = 0; i < NUM_MOTORS; i++)
-    analogWrite(motors[i], convert(throttle[i]));
+// The left encoder is mounted mirrored, it counts down going forward
+uint16_t hal_encoder_count(int wheel) {
+#ifdef ENCODERS
+  if (wheel == WHEEL_LEFT)
+    return -(uint16_t)FTM1_CNT;
+  return FTM2_CNT;
+#else
+  return 0;
+#endif
+}
+
+uint16_t hal_supply_mv(void) {
+  return analogRead(VBAT_PIN) * VBAT_MV_PER_COUNT;
+}
+
+void hal_led(int led, int on) {
+  digitalWrite(led == HAL_LED_RX ? LED2 : LED3, on ? HIGH : LOW);
+}
+
+void hal_irq_disable(void) { noInterrupts(); }
+
+void hal_irq_enable(void) { interrupts(); }
 }
 
 #endif
@@ -0,0 +1,143 @@
+/**
+ * @file        : hal_mock
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ */
+
+#include "hal_mock.h"
+#include "robot_core.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+struct hal_mock mock;
+
+// Which motor drives each wheel and which way round it's mounted, the same
+// as the default mixer (PROTO_LAYOUT_DIFF)
+static const int wheel_motor[MOCK_WHEELS] = {LF_INDEX, RF_INDEX};
+static const int wheel_sign[MOCK_WHEELS] = {-1, 1};
+
+void hal_mock_reset(void) {
+  memset(&mock, 0, sizeof(mock));
+  mock.tx_space = MOCK_TX_SIZE;
+  mock.supply_mv = 12000;
+  mock.max_mm_s = MOCK_MAX_MM_S;
+  mock.tau_s = MOCK_TAU_S;
+  mock.mm_per_count = MOCK_MM_PER_COUNT;
+}
+
+void hal_mock_advance(uint32_t us) {
+  float dt = us * 1e-6f;
+  float lag = 1 - expf(-dt / mock.tau_s);
+
+  mock.now_us += us;
+  mock.cycles += us * MOCK_CYCLES_PER_US;
+  if (mock.external_plant)
+    return;
+  for (int i = 0; i < MOCK_WHEELS; i++) {
+    uint16_t duty = mock.duty[wheel_motor[i]];
+    float throttle = duty ? wheel_sign[i] * (duty - PWM_ZERO) / (float)PWM_SPAN : 0;
+    float want = 0;
+
+    if (fabsf(throttle) > mock.deadband)
+      want = throttle * mock.max_mm_s * (1 - mock.load);
+    mock.wheel_mm_s[i] += (want - mock.wheel_mm_s[i]) * lag;
+    mock.wheel_mm[i] += mock.wheel_mm_s[i] * dt;
+  }
+}
+
+int hal_mock_rx(const uint8_t *buf, size_t len) {
+  memmove(mock.rx, mock.rx + mock.rx_pos, mock.rx_len - mock.rx_pos);
+  mock.rx_len -= mock.rx_pos;
+  mock.rx_pos = 0;
+  if (len > MOCK_RX_SIZE - mock.rx_len)
+    return -1;
+  memcpy(mock.rx + mock.rx_len, buf, len);
+  mock.rx_len += len;
+  return 0;
+}
+
+int hal_mock_tx_frame(struct proto_frame *frame) {
+  struct proto_decoder decoder;
+
+  // Every frame ends in a delimiter, so a fresh decoder per frame is fine
+  proto_decoder_init(&decoder);
+  while (mock.tx_pos < mock.tx_len)
+    if (proto_decode_byte(&decoder, mock.tx[mock.tx_pos++], frame) ==
+        PROTO_FRAME)
+      return 1;
+  // All read, start over so tx doesn't fill up
+  mock.tx_len = mock.tx_pos = 0;
+  return 0;
+}
+
+uint32_t hal_millis(void) { return mock.now_us / 1000; }
+
+uint32_t hal_micros(void) {
+  uint32_t now = mock.now_us;
+
+  mock.now_us += mock.micros_step;
+  return now;
+}
+
+uint32_t hal_cycles(void) {
+  uint32_t now = mock.cycles;
+  struct timespec ts;
+
+  if (mock.real_cycles) {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec) *
+           MOCK_CYCLES_PER_US / 1000;
+  }
+
+  mock.cycles += mock.cycle_step;
+  return now;
+}
+
+uint32_t hal_cycles_per_us(void) { return MOCK_CYCLES_PER_US; }
+
+int hal_serial_available(void) { return mock.rx_len - mock.rx_pos; }
+
+int hal_serial_read(void) {
+  return mock.rx_pos < mock.rx_len ? mock.rx[mock.rx_pos++] : -1;
+}
+
+size_t hal_serial_write_space(void) {
+  size_t left = MOCK_TX_SIZE - mock.tx_len;
+  return mock.tx_space < left ? mock.tx_space : left;
+}
+
+void hal_serial_write(const uint8_t *buf, size_t len) {
+  if (len > hal_serial_write_space())
+    len = hal_serial_write_space();
+  memcpy(mock.tx + mock.tx_len, buf, len);
+  mock.tx_len += len;
+}
+
+void hal_serial_begin(uint32_t baud) {
+  mock.baud = baud;
+  mock.begins++;
+}
+
+void hal_pwm_write(int motor, uint16_t duty) {
+  if (motor >= 0 && motor < MOCK_MOTORS)
+    mock.duty[motor] = duty;
+  mock.pwm_writes++;
+}
+
+uint16_t hal_encoder_count(int wheel) {
+  if (wheel < 0 || wheel >= MOCK_WHEELS)
+    return 0;
+  return (uint16_t)(int64_t)floor(mock.wheel_mm[wheel] / mock.mm_per_count);
+}
+
+uint16_t hal_supply_mv(void) { return mock.supply_mv; }
+
+void hal_led(int led, int on) {
+  if (led >= 0 && led < MOCK_LEDS)
+    mock.led[led] = on;
+}
+
+void hal_irq_disable(void) { mock.irq_depth++; }
+
+void hal_irq_enable(void) { mock.irq_depth--; }
@@ -0,0 +1,153 @@
+/**
+ * @file        : hal_mock
+ * @brief hal.h for native builds, so robot_core runs on the host
+ *
+ * The clock only moves when it's told to, Serial1 is a pair of byte buffers
+ * the test fills and drains, and pwm writes, leds and interrupt masking are
+ * recorded instead of done. The encoders count off a simple plant: each wheel
+ * follows its side's front motor with a first order lag, a deadband and a load
+ * that eats some of its speed, the way a wheel on the ground would. There's
+ * one board, so this is all globals.
+ * Nothing in the firmware includes this, so the teensy build never links it.
+ *
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef HAL_MOCK_H
+
+#define HAL_MOCK_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Local Includes
+#include "hal.h"
+#include "protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOCK_MOTORS 6
+#define MOCK_LEDS 2
+#define MOCK_RX_SIZE 4096
+#define MOCK_TX_SIZE 4096
+#define MOCK_WHEELS 2
+
+// The plant hal_mock_reset sets up
+#define MOCK_MAX_MM_S 2000     // Wheel speed at full throttle, no load
+#define MOCK_TAU_S 0.15f       // Time constant
+#define MOCK_MM_PER_COUNT 0.5f // Encoder resolution
+
+// The cycle counter runs off the clock at this, like a 96 MHz teensy
+#define MOCK_CYCLES_PER_US 96
+
+////////// Data Structures //////////
+
+/**
+ * @now_us      The clock, hal_millis is this over 1000
+ * @cycles      The cycle counter, moves MOCK_CYCLES_PER_US with every
+ * microsecond on the clock
+ * @cycle_step  Added to cycles after every hal_cycles, so back to back reads
+ * see code take time
+ * @micros_step Added to the clock after every hal_micros, so a tick can be
+ * made to run long (nothing else moves with it)
+ * @real_cycles Set to count cycles off the host's clock instead, at
+ * MOCK_CYCLES_PER_US, so robot-sim's timings are how long the core really took
+ * @rx          Bytes waiting to be read
+ * @rx_len      Bytes in rx
+ * @rx_pos      Bytes already read
+ * @tx          Bytes written
+ * @tx_len      Bytes in tx
+ * @tx_pos      Bytes hal_mock_tx_frame already went through
+ * @tx_space    What hal_serial_write_space says, capped by what's left in tx
+ * @baud        The last hal_serial_begin
+ * @begins      hal_serial_begin calls
+ * @duty        The last duty written to each motor, 0 if never
+ * @pwm_writes  hal_pwm_write calls, all motors
+ * @supply_mv   What hal_supply_mv says
+ * @led         Each led's state
+ * @irq_depth   hal_irq_disable without a matching hal_irq_enable yet
+ * @max_mm_s    The plant's speed at full throttle, no load
+ * @tau_s       The plant's time constant
+ * @deadband    The plant doesn't move below this fraction of full throttle
+ * @load        Fraction of speed the load takes away, 0 on blocks
+ * @mm_per_count Encoder resolution
+ * @wheel_mm_s  Each wheel's speed, forward is positive
+ * @wheel_mm    How far each wheel has gone
+ * @external_plant Set when something else moves the wheels and sets
+ * supply_mv (robot-sim), hal_mock_advance then only moves the clock
+ */
+struct hal_mock {
+  uint64_t now_us;
+  uint32_t cycles;
+  uint32_t cycle_step;
+  uint32_t micros_step;
+  int real_cycles;
+  uint8_t rx[MOCK_RX_SIZE];
+  size_t rx_len;
+  size_t rx_pos;
+  uint8_t tx[MOCK_TX_SIZE];
+  size_t tx_len;
+  size_t tx_pos;
+  size_t tx_space;
+  uint32_t baud;
+  uint32_t begins;
+  uint16_t duty[MOCK_MOTORS];
+  uint64_t pwm_writes;
+  uint16_t supply_mv;
+  int led[MOCK_LEDS];
+  int irq_depth;
+  float max_mm_s;
+  float tau_s;
+  float deadband;
+  float load;
+  float mm_per_count;
+  float wheel_mm_s[MOCK_WHEELS];
+  double wheel_mm[MOCK_WHEELS];
+  int external_plant;
+};
+
+extern struct hal_mock mock;
+
+/**
+ * @brief Puts the board back the way it powers up
+ * @note The clock starts at 0, tx has room for everything
+ */
+void hal_mock_reset(void);
+
+/**
+ * @brief Moves the clock forward, the cycle counter and (unless
+ * external_plant is set) the wheels move with it
+ *
+ * @param us Microseconds
+ */
+void hal_mock_advance(uint32_t us);
+
+/**
+ * @brief Bytes arriving on Serial1
+ * @note Whatever was already read is dropped first to make room
+ *
+ * @param buf The bytes
+ * @param len How many
+ *
+ * @return 0, -1 if they don't fit
+ */
+int hal_mock_rx(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Takes the next frame the firmware sent out of tx
+ *
+ * @param frame Where to decode it
+ *
+ * @return 1 if there was one, 0 if tx holds no whole good frame
+ */
+int hal_mock_tx_frame(struct proto_frame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard HAL_MOCK_H */
@@ -0,0 +1,528 @@
+/**
+ * @file        : protocol
+ * @created     : Sunday Oct 18, 2026 16:13:04 MDT
+ */
+
+#include "protocol.h"
+
+#include <string.h>
+
+// Gaps bigger than this are the other side restarting, not lost frames
+#define PROTO_MAX_SEQ_GAP 128
+
+static uint8_t *put_u16(uint8_t *out, uint16_t val) {
+  out[0] = val & 0xFF;
+  out[1] = val >> 8;
+  return out + 2;
+}
+
+static const uint8_t *get_u16(const uint8_t *in, uint16_t *val) {
+  *val = in[0] | (in[1] << 8);
+  return in + 2;
+}
+
+static const uint8_t *get_i16(const uint8_t *in, int16_t *val) {
+  uint16_t raw;
+  in = get_u16(in, &raw);
+  *val = (int16_t)raw;
+  return in;
+}
+
+static uint8_t *put_u32(uint8_t *out, uint32_t val) {
+  out = put_u16(out, val & 0xFFFF);
+  return put_u16(out, val >> 16);
+}
+
+static const uint8_t *get_u32(const uint8_t *in, uint32_t *val) {
+  uint16_t lo, hi;
+  in = get_u16(in, &lo);
+  in = get_u16(in, &hi);
+  *val = lo | ((uint32_t)hi << 16);
+  return in;
+}
+
+static uint8_t *put_i64(uint8_t *out, int64_t val) {
+  out = put_u32(out, (uint64_t)val & 0xFFFFFFFF);
+  return put_u32(out, (uint64_t)val >> 32);
+}
+
+static const uint8_t *get_i64(const uint8_t *in, int64_t *val) {
+  uint32_t lo, hi;
+  in = get_u32(in, &lo);
+  in = get_u32(in, &hi);
+  *val = (int64_t)(lo | ((uint64_t)hi << 32));
+  return in;
+}
+
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t read = 0;
+  size_t write = 1;
+  size_t code_index = 0;
+  uint8_t code = 1;
+
+  for (read = 0; read < len; ++read) {
+    if (in[read] == 0) {
+      out[code_index] = code;
+      code = 1;
+      code_index = write++;
+    } else {
+      out[write++] = in[read];
+      if (++code == 0xFF) {
+        out[code_index] = code;
+        code = 1;
+        code_index = write++;
+      }
+    }
+  }
+  out[code_index] = code;
+  return write;
+}
+
+// Safe to do in place, the output never gets ahead of the input
+static size_t cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t read = 0;
+  size_t write = 0;
+  uint8_t code;
+  uint8_t i;
+
+  while (read < len) {
+    code = in[read++];
+    if (code == 0 || read + code - 1 > len)
+      return 0;
+    for (i = 1; i < code; ++i)
+      out[write++] = in[read++];
+    if (code < 0xFF && read < len)
+      out[write++] = 0;
+  }
+  return write;
+}
+
+uint16_t proto_crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  size_t i;
+  int bit;
+
+  for (i = 0; i < len; ++i) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+size_t proto_encode(const struct proto_frame *frame, uint8_t *out) {
+  uint8_t raw[PROTO_MAX_RAW];
+  size_t len = PROTO_HEADER_SIZE + frame->len;
+  size_t written;
+  uint16_t crc;
+
+  if (frame->len > PROTO_MAX_PAYLOAD)
+    return 0;
+
+  raw[0] = PROTO_VERSION;
+  raw[1] = frame->type;
+  raw[2] = frame->seq;
+  memcpy(&raw[PROTO_HEADER_SIZE], frame->payload, frame->len);
+  crc = proto_crc16(raw, len);
+  raw[len++] = crc >> 8;
+  raw[len++] = crc & 0xFF;
+
+  written = cobs_encode(raw, len, out);
+  out[written++] = PROTO_DELIMITER;
+  return written;
+}
+
+void proto_decoder_init(struct proto_decoder *dec) {
+  memset(dec, 0, sizeof(*dec));
+}
+
+int proto_decode_byte(struct proto_decoder *dec, uint8_t byte,
+                      struct proto_frame *frame) {
+  size_t len;
+  uint16_t crc;
+  uint8_t gap;
+  uint8_t *raw = dec->buf;
+
+  if (byte != PROTO_DELIMITER) {
+    if (dec->len < sizeof(dec->buf))
+      dec->buf[dec->len++] = byte;
+    else
+      dec->overflow = 1;
+    return PROTO_MORE;
+  }
+
+  // Back to back delimiters are just idle line
+  if (dec->len == 0 && !dec->overflow)
+    return PROTO_MORE;
+
+  len = dec->len;
+  dec->len = 0;
+  if (dec->overflow) {
+    dec->overflow = 0;
+    dec->framing_errors++;
+    return PROTO_ERROR;
+  }
+
+  len = cobs_decode(dec->buf, len, raw);
+  if (len < PROTO_HEADER_SIZE + PROTO_CRC_SIZE || len > PROTO_MAX_RAW) {
+    dec->framing_errors++;
+    return PROTO_ERROR;
+  }
+
+  crc = (raw[len - 2] << 8) | raw[len - 1];
+  if (proto_crc16(raw, len - PROTO_CRC_SIZE) != crc) {
+    dec->crc_errors++;
+    return PROTO_ERROR;
+  }
+
+  if (raw[0] != PROTO_VERSION) {
+    dec->version_errors++;
+    return PROTO_ERROR;
+  }
+
+  frame->type = raw[1];
+  frame->seq = raw[2];
+  frame->len = len - PROTO_HEADER_SIZE - PROTO_CRC_SIZE;
+  memcpy(frame->payload, &raw[PROTO_HEADER_SIZE], frame->len);
+
+  gap = frame->seq - dec->last_seq - 1;
+  if (dec->have_seq && gap < PROTO_MAX_SEQ_GAP)
+    dec->lost_frames += gap;
+  dec->have_seq = 1;
+  dec->last_seq = frame->seq;
+  dec->frames++;
+  return PROTO_FRAME;
+}
+
+void proto_pack_empty(struct proto_frame *frame, uint8_t type, uint8_t seq) {
+  frame->type = type;
+  frame->seq = seq;
+  frame->len = 0;
+}
+
+void proto_pack_drive(struct proto_frame *frame, uint8_t seq,
+                      const struct proto_drive *drive) {
+  proto_pack_empty(frame, PROTO_DRIVE, seq);
+  frame->payload[0] = drive->vx;
+  frame->payload[1] = drive->vy;
+  frame->payload[2] = drive->omega;
+  frame->payload[3] = drive->gun1;
+  frame->payload[4] = drive->gun2;
+  frame->len = PROTO_DRIVE_SIZE;
+}
+
+int proto_unpack_drive(const struct proto_frame *frame,
+                       struct proto_drive *drive) {
+  if (frame->type != PROTO_DRIVE || frame->len != PROTO_DRIVE_SIZE)
+    return 0;
+  drive->vx = frame->payload[0];
+  drive->vy = frame->payload[1];
+  drive->omega = frame->payload[2];
+  drive->gun1 = frame->payload[3];
+  drive->gun2 = frame->payload[4];
+  return 1;
+}
+
+void proto_pack_velocity(struct proto_frame *frame, uint8_t seq,
+                         const struct proto_velocity *velocity) {
+  uint8_t *out = frame->payload;
+  int i;
+
+  proto_pack_empty(frame, PROTO_VELOCITY, seq);
+  for (i = 0; i < PROTO_WHEELS; ++i)
+    out = put_u16(out, velocity->speed[i]);
+  *out++ = velocity->gun1;
+  *out++ = velocity->gun2;
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_velocity(const struct proto_frame *frame,
+                          struct proto_velocity *velocity) {
+  const uint8_t *in = frame->payload;
+  int i;
+
+  if (frame->type != PROTO_VELOCITY || frame->len != PROTO_VELOCITY_SIZE)
+    return 0;
+  for (i = 0; i < PROTO_WHEELS; ++i)
+    in = get_i16(in, &velocity->speed[i]);
+  velocity->gun1 = *in++;
+  velocity->gun2 = *in;
+  return 1;
+}
+
+int proto_is_command(uint8_t type) {
+  return type == PROTO_DRIVE || type == PROTO_VELOCITY;
+}
+
+void proto_pack_telemetry(struct proto_frame *frame, uint8_t seq,
+                          const struct proto_telemetry *telemetry) {
+  uint8_t *out = frame->payload;
+  int i;
+
+  proto_pack_empty(frame, PROTO_TELEMETRY, seq);
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i)
+    *out++ = telemetry->throttle[i];
+  *out++ = telemetry->ack_seq;
+  out = put_u16(out, telemetry->period_us);
+  out = put_u16(out, telemetry->busy_max_us);
+  out = put_u16(out, telemetry->supply_mv);
+  out = put_u16(out, telemetry->crc_errors);
+  out = put_u16(out, telemetry->framing_errors);
+  out = put_u16(out, telemetry->lost_frames);
+  out = put_u16(out, telemetry->tx_dropped);
+  out = put_u16(out, telemetry->overruns);
+  out = put_u16(out, telemetry->failsafes);
+  for (i = 0; i < PROTO_WHEELS; ++i)
+    out = put_u16(out, telemetry->speed[i]);
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_telemetry(const struct proto_frame *frame,
+                           struct proto_telemetry *telemetry) {
+  const uint8_t *in = frame->payload;
+  int i;
+
+  if (frame->type != PROTO_TELEMETRY || frame->len != PROTO_TELEMETRY_SIZE)
+    return 0;
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i)
+    telemetry->throttle[i] = *in++;
+  telemetry->ack_seq = *in++;
+  in = get_u16(in, &telemetry->period_us);
+  in = get_u16(in, &telemetry->busy_max_us);
+  in = get_u16(in, &telemetry->supply_mv);
+  in = get_u16(in, &telemetry->crc_errors);
+  in = get_u16(in, &telemetry->framing_errors);
+  in = get_u16(in, &telemetry->lost_frames);
+  in = get_u16(in, &telemetry->tx_dropped);
+  in = get_u16(in, &telemetry->overruns);
+  in = get_u16(in, &telemetry->failsafes);
+  for (i = 0; i < PROTO_WHEELS; ++i)
+    in = get_i16(in, &telemetry->speed[i]);
+  return 1;
+}
+
+void proto_pack_ping(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_ping *ping) {
+  uint8_t *out = frame->payload;
+
+  proto_pack_empty(frame, PROTO_PING, seq);
+  out = put_u32(out, ping->nonce);
+  out = put_i64(out, ping->host_ns);
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_ping(const struct proto_frame *frame, struct proto_ping *ping) {
+  const uint8_t *in = frame->payload;
+
+  if (frame->type != PROTO_PING || frame->len != PROTO_PING_SIZE)
+    return 0;
+  in = get_u32(in, &ping->nonce);
+  get_i64(in, &ping->host_ns);
+  return 1;
+}
+
+void proto_pack_pong(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_pong *pong) {
+  uint8_t *out = frame->payload;
+
+  proto_pack_empty(frame, PROTO_PONG, seq);
+  out = put_u32(out, pong->nonce);
+  out = put_i64(out, pong->host_ns);
+  out = put_u32(out, pong->rx_us);
+  out = put_u32(out, pong->apply_us);
+  out = put_u32(out, pong->tx_us);
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_pong(const struct proto_frame *frame, struct proto_pong *pong) {
+  const uint8_t *in = frame->payload;
+
+  if (frame->type != PROTO_PONG || frame->len != PROTO_PONG_SIZE)
+    return 0;
+  in = get_u32(in, &pong->nonce);
+  in = get_i64(in, &pong->host_ns);
+  in = get_u32(in, &pong->rx_us);
+  in = get_u32(in, &pong->apply_us);
+  get_u32(in, &pong->tx_us);
+  return 1;
+}
+
+void proto_pack_baud(struct proto_frame *frame, uint8_t type, uint8_t seq,
+                     uint32_t baud) {
+  proto_pack_empty(frame, type, seq);
+  frame->len = put_u32(frame->payload, baud) - frame->payload;
+}
+
+int proto_unpack_baud(const struct proto_frame *frame, uint8_t type,
+                      uint32_t *baud) {
+  if (frame->type != type || frame->len != PROTO_BAUD_SIZE)
+    return 0;
+  get_u32(frame->payload, baud);
+  return 1;
+}
+
+void proto_limits_default(struct proto_limits *limits) {
+  int i;
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i) {
+    limits->slew[i] = i < PROTO_DRIVE_CHANNELS ? PROTO_DRIVE_SLEW
+                                               : PROTO_GUN_SLEW;
+    limits->jerk[i] = i < PROTO_DRIVE_CHANNELS ? PROTO_DRIVE_JERK
+                                               : PROTO_GUN_JERK;
+  }
+  limits->timeout_ms = PROTO_COMMAND_TIMEOUT_MS;
+}
+
+void proto_pack_limits(struct proto_frame *frame, uint8_t seq,
+                       const struct proto_limits *limits) {
+  uint8_t *out = frame->payload;
+  int i;
+
+  proto_pack_empty(frame, PROTO_LIMITS, seq);
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i)
+    out = put_u16(out, limits->slew[i]);
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i)
+    out = put_u16(out, limits->jerk[i]);
+  out = put_u16(out, limits->timeout_ms);
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_limits(const struct proto_frame *frame,
+                        struct proto_limits *limits) {
+  const uint8_t *in = frame->payload;
+  int i;
+
+  if (frame->type != PROTO_LIMITS || frame->len != PROTO_LIMITS_SIZE)
+    return 0;
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i)
+    in = get_u16(in, &limits->slew[i]);
+  for (i = 0; i < PROTO_TELEMETRY_CHANNELS; ++i)
+    in = get_u16(in, &limits->jerk[i]);
+  get_u16(in, &limits->timeout_ms);
+  return 1;
+}
+
+int proto_mixer_layout(struct proto_mixer *mixer, int layout) {
+  // Wheel forward for vx / vy / omega, by motor: LF, LB, RF, RB
+  static const int8_t diff[PROTO_DRIVE_CHANNELS][PROTO_AXES] = {
+      {1, 0, 1}, {1, 0, 1}, {1, 0, -1}, {1, 0, -1}};
+  static const int8_t mecanum[PROTO_DRIVE_CHANNELS][PROTO_AXES] = {
+      {1, 1, 1}, {1, -1, 1}, {1, -1, -1}, {1, 1, -1}};
+  const int8_t(*rows)[PROTO_AXES];
+  int one = PROTO_MIXER_ONE;
+  int i, j;
+
+  switch (layout) {
+  case PROTO_LAYOUT_DIFF:
+    rows = diff;
+    break;
+  case PROTO_LAYOUT_MECANUM:
+    rows = mecanum;
+    break;
+  case PROTO_LAYOUT_OMNI:
+    // Same directions as mecanum, each wheel is 45 degrees off the axes
+    rows = mecanum;
+    one = PROTO_MIXER_ONE * 707 / 1000;
+    break;
+  default:
+    return -1;
+  }
+  for (i = 0; i < PROTO_DRIVE_CHANNELS; ++i) {
+    for (j = 0; j < PROTO_AXES; ++j)
+      mixer->coef[i][j] = rows[i][j] * one;
+    mixer->scale[i] = i < PROTO_DRIVE_CHANNELS / 2 ? -100 : 100;
+  }
+  return 0;
+}
+
+void proto_pack_mixer(struct proto_frame *frame, uint8_t seq,
+                      const struct proto_mixer *mixer) {
+  uint8_t *out = frame->payload;
+  int i, j;
+
+  proto_pack_empty(frame, PROTO_MIXER, seq);
+  for (i = 0; i < PROTO_DRIVE_CHANNELS; ++i)
+    for (j = 0; j < PROTO_AXES; ++j)
+      out = put_u16(out, mixer->coef[i][j]);
+  for (i = 0; i < PROTO_DRIVE_CHANNELS; ++i)
+    *out++ = mixer->scale[i];
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_mixer(const struct proto_frame *frame,
+                       struct proto_mixer *mixer) {
+  const uint8_t *in = frame->payload;
+  int i, j;
+
+  if (frame->type != PROTO_MIXER || frame->len != PROTO_MIXER_SIZE)
+    return 0;
+  for (i = 0; i < PROTO_DRIVE_CHANNELS; ++i)
+    for (j = 0; j < PROTO_AXES; ++j)
+      in = get_i16(in, &mixer->coef[i][j]);
+  for (i = 0; i < PROTO_DRIVE_CHANNELS; ++i)
+    mixer->scale[i] = *in++;
+  return 1;
+}
+
+void proto_pack_pose(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_pose *pose) {
+  uint8_t *out = frame->payload;
+
+  proto_pack_empty(frame, PROTO_POSE, seq);
+  out = put_u32(out, (uint32_t)pose->x_mm);
+  out = put_u32(out, (uint32_t)pose->y_mm);
+  out = put_u16(out, (uint16_t)pose->heading_mrad);
+  out = put_u32(out, pose->t_us);
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_pose(const struct proto_frame *frame, struct proto_pose *pose) {
+  const uint8_t *in = frame->payload;
+  uint32_t x, y;
+
+  if (frame->type != PROTO_POSE || frame->len != PROTO_POSE_SIZE)
+    return 0;
+  in = get_u32(in, &x);
+  in = get_u32(in, &y);
+  in = get_i16(in, &pose->heading_mrad);
+  get_u32(in, &pose->t_us);
+  pose->x_mm = (int32_t)x;
+  pose->y_mm = (int32_t)y;
+  return 1;
+}
+
+void proto_pack_perf(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_perf *perf) {
+  uint8_t *out = frame->payload;
+  int i;
+
+  proto_pack_empty(frame, PROTO_PERF, seq);
+  *out++ = perf->stage;
+  out = put_u16(out, perf->mhz);
+  out = put_u16(out, perf->rx_peak);
+  out = put_u32(out, perf->count);
+  out = put_u32(out, perf->min_cycles);
+  out = put_u32(out, perf->max_cycles);
+  out = put_u32(out, perf->mean_cycles);
+  for (i = 0; i < PROTO_PERF_BUCKETS; ++i)
+    out = put_u16(out, perf->hist[i]);
+  frame->len = out - frame->payload;
+}
+
+int proto_unpack_perf(const struct proto_frame *frame, struct proto_perf *perf) {
+  const uint8_t *in = frame->payload;
+  int i;
+
+  if (frame->type != PROTO_PERF || frame->len != PROTO_PERF_SIZE ||
+      in[0] >= PROTO_PERF_STAGES)
+    return 0;
+  perf->stage = *in++;
+  in = get_u16(in, &perf->mhz);
+  in = get_u16(in, &perf->rx_peak);
+  in = get_u32(in, &perf->count);
+  in = get_u32(in, &perf->min_cycles);
+  in = get_u32(in, &perf->max_cycles);
+  in = get_u32(in, &perf->mean_cycles);
+  for (i = 0; i < PROTO_PERF_BUCKETS; ++i)
+    in = get_u16(in, &perf->hist[i]);
+  return 1;
+}
@@ -0,0 +1,613 @@
+/**
+ * @file        : protocol
+ * @brief The serial protocol shared by the host and the teensy
+ *
+ * Wire format (version 2):
+ *
+ *   COBS( version | type | seq | payload ... | crc hi | crc lo ) 0x00
+ *
+ * The crc is CRC-16/CCITT-FALSE over everything before it. COBS takes every
+ * zero byte out of the frame, so 0x00 only ever shows up as the delimiter. A
+ * receiver that drops or corrupts a byte loses at most the frame it was in and
+ * is back in sync at the next 0x00. seq counts up by one per frame (wrapping)
+ * so the receiver can count frames that never arrived.
+ *
+ * This is plain C so the same file builds on the host and in the firmware.
+ *
+ * @created     : Sunday Oct 18, 2026 16:13:04 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef PROTOCOL_H
+
+#define PROTOCOL_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROTO_VERSION 2
+
+#define PROTO_DELIMITER 0x00
+#define PROTO_HEADER_SIZE 3
+#define PROTO_CRC_SIZE 2
+#define PROTO_MAX_PAYLOAD 40 // The biggest is a PROTO_PERF
+#define PROTO_MAX_RAW (PROTO_HEADER_SIZE + PROTO_MAX_PAYLOAD + PROTO_CRC_SIZE)
+
+// COBS adds one byte per 254 plus one, then the delimiter
+#define PROTO_MAX_ENCODED (PROTO_MAX_RAW + PROTO_MAX_RAW / 254 + 2)
+
+// Frame types
+#define PROTO_DRIVE 'd'
+#define PROTO_STOP 's'
+#define PROTO_TELEMETRY 't' // teensy to host
+#define PROTO_PING 'p'
+#define PROTO_PONG 'P' // teensy to host
+#define PROTO_BAUD 'b'
+#define PROTO_BAUD_ACK 'B' // teensy to host
+#define PROTO_LIMITS 'l'
+#define PROTO_VELOCITY 'v'
+#define PROTO_MIXER 'm'
+#define PROTO_POSE 'o' // robot-sim to host, the real teensy can't know this
+#define PROTO_PERF 'f'  // teensy to host
+
+#define PROTO_DRIVE_SIZE 5
+#define PROTO_TELEMETRY_CHANNELS 6
+#define PROTO_WHEELS 2 // Encoders, left and right
+#define PROTO_TELEMETRY_SIZE                                                   \
+  (PROTO_TELEMETRY_CHANNELS + 1 + 9 * 2 + PROTO_WHEELS * 2)
+#define PROTO_PING_SIZE (4 + 8)
+#define PROTO_PONG_SIZE (PROTO_PING_SIZE + 3 * 4)
+#define PROTO_BAUD_SIZE 4
+#define PROTO_LIMITS_SIZE (PROTO_TELEMETRY_CHANNELS * 2 * 2 + 2)
+#define PROTO_VELOCITY_SIZE (PROTO_WHEELS * 2 + 2)
+#define PROTO_MIXER_SIZE (PROTO_DRIVE_CHANNELS * (PROTO_AXES * 2 + 1))
+#define PROTO_POSE_SIZE (4 + 4 + 2 + 4)
+#define PROTO_PERF_SIZE (1 + 2 + 2 + 4 * 4 + PROTO_PERF_BUCKETS * 2)
+
+// Channels 0 to 3 are the drive motors, the rest are the guns
+#define PROTO_DRIVE_CHANNELS 4
+
+// The mixer's inputs, vx / vy / omega
+#define PROTO_AXES 3
+#define PROTO_MIXER_ONE 256 // A mixer coefficient of 1
+
+// Chassis layouts proto_mixer_layout knows
+#define PROTO_LAYOUT_DIFF 0    // Tank, each side's motors together
+#define PROTO_LAYOUT_MECANUM 1 // Mecanum wheels, the usual roller layout
+#define PROTO_LAYOUT_OMNI 2    // Omni wheels at 45 degrees in the corners
+
+// Motion limits both ends start out with, in throttle units (full scale is
+// 100) per second and per second squared
+#define PROTO_DRIVE_SLEW 500
+#define PROTO_DRIVE_JERK 5000
+#define PROTO_GUN_SLEW 200
+#define PROTO_GUN_JERK 1000
+#define PROTO_COMMAND_TIMEOUT_MS 500
+
+// Firmware stages a PROTO_PERF times, loop() side then control tick side
+#define PROTO_PERF_LOOP 0    // A whole pass of loop()
+#define PROTO_PERF_LISTEN 1  // Draining Serial1, passes that found bytes
+#define PROTO_PERF_FRAME 2   // Handling one decoded frame
+#define PROTO_PERF_REPORT 3  // Building and sending a telemetry report
+#define PROTO_PERF_TICK 4    // A whole control tick
+#define PROTO_PERF_SPEED 5   // Encoders and speed pids, ticks that ran them
+#define PROTO_PERF_MIX 6     // The mixer and the watchdog
+#define PROTO_PERF_PROFILE 7 // The motion profile
+#define PROTO_PERF_WRITE 8   // Throttle to duty and the pwm writes
+#define PROTO_PERF_STAGES 9
+
+// A stage's times go in power of two buckets of cpu cycles: bucket 0 is under
+// 1 << PROTO_PERF_SHIFT, bucket k under 1 << (PROTO_PERF_SHIFT + k), the last
+// one is everything longer
+#define PROTO_PERF_BUCKETS 8
+#define PROTO_PERF_SHIFT 7
+
+// What proto_decode_byte returns
+#define PROTO_MORE 0
+#define PROTO_FRAME 1
+#define PROTO_ERROR -1
+
+////////// Data Structures //////////
+
+struct proto_frame {
+  uint8_t type;
+  uint8_t seq;
+  uint8_t len;
+  uint8_t payload[PROTO_MAX_PAYLOAD];
+};
+
+/**
+ * The payload of a PROTO_DRIVE frame, the robot's motion for the teensy's
+ * mixer to turn into motor throttles
+ *
+ * @vx    Forward
+ * @vy    Sideways, right is positive (0 on a tank)
+ * @omega Turning, clockwise from above is positive
+ * @gun1  Gun motor 1
+ * @gun2  Gun motor 2
+ */
+struct proto_drive {
+  int8_t vx;
+  int8_t vy;
+  int8_t omega;
+  int8_t gun1;
+  int8_t gun2;
+};
+
+/**
+ * The payload of a PROTO_VELOCITY frame, wheel speeds the teensy holds with
+ * its encoders instead of raw drive throttles. On the wire it's each speed
+ * int16_t little endian, then the guns
+ *
+ * @speed Wheel speeds, mm/s, forward is positive
+ * @gun1  Same as proto_drive
+ * @gun2  Same as proto_drive
+ */
+struct proto_velocity {
+  int16_t speed[PROTO_WHEELS];
+  int8_t gun1;
+  int8_t gun2;
+};
+
+/**
+ * The payload of a PROTO_TELEMETRY frame, the teensy sends one every so often.
+ * On the wire it's the throttles, ack_seq, then each uint16_t little endian
+ * in the order below. The counters wrap
+ *
+ * @throttle       The throttles last written to the motors
+ * @ack_seq        seq of the last drive frame applied
+ * @period_us      Time between the last two control ticks
+ * @busy_max_us    The longest control tick since the last report
+ * @supply_mv      Supply voltage
+ * @crc_errors     Frames the teensy dropped for a bad crc
+ * @framing_errors Frames the teensy dropped for bad framing
+ * @lost_frames    Frames that never reached the teensy going by seq
+ * @tx_dropped     Reports the teensy skipped because its tx buffer was full
+ * @overruns       Control ticks that started late or ran into the next one
+ * @failsafes      Times the command watchdog ran out and stopped the robot
+ * @speed          Measured wheel speeds, mm/s, 0 without encoders
+ */
+struct proto_telemetry {
+  int8_t throttle[PROTO_TELEMETRY_CHANNELS];
+  uint8_t ack_seq;
+  uint16_t period_us;
+  uint16_t busy_max_us;
+  uint16_t supply_mv;
+  uint16_t crc_errors;
+  uint16_t framing_errors;
+  uint16_t lost_frames;
+  uint16_t tx_dropped;
+  uint16_t overruns;
+  uint16_t failsafes;
+  int16_t speed[PROTO_WHEELS];
+};
+
+/**
+ * The payload of a PROTO_LIMITS frame, how fast the teensy lets each throttle
+ * move toward its setpoint. On the wire it's every slew, every jerk, then the
+ * timeout, each uint16_t little endian. A 0 slew or jerk is no limit
+ *
+ * @slew       Fastest a throttle changes, units per second
+ * @jerk       Fastest the rate of change changes, units per second squared
+ * @timeout_ms No drive or stop frame for this long and the teensy stops
+ */
+struct proto_limits {
+  uint16_t slew[PROTO_TELEMETRY_CHANNELS];
+  uint16_t jerk[PROTO_TELEMETRY_CHANNELS];
+  uint16_t timeout_ms;
+};
+
+/**
+ * The payload of a PROTO_MIXER frame, how the teensy turns vx / vy / omega
+ * into drive throttles. A motor's throttle is its row of coef dotted with the
+ * command, over PROTO_MIXER_ONE, times its scale in percent. If that puts any
+ * motor past full throttle they're all scaled down together, so the robot
+ * keeps its direction and just goes slower. On the wire it's every coef row
+ * by row, each int16_t little endian, then every scale
+ *
+ * @coef  Per drive motor, how much of vx / vy / omega turns its wheel forward
+ * @scale Per drive motor, percent. Negative for a motor mounted the other way
+ */
+struct proto_mixer {
+  int16_t coef[PROTO_DRIVE_CHANNELS][PROTO_AXES];
+  int8_t scale[PROTO_DRIVE_CHANNELS];
+};
+
+/**
+ * The payload of a PROTO_POSE frame, where the simulated robot is (see
+ * tests/robot_sim). On the wire it's x, y, heading then t_us, little endian
+ *
+ * @x_mm         Forward from where it started
+ * @y_mm         Left from where it started
+ * @heading_mrad Counterclockwise from where it started, -pi to pi
+ * @t_us         The simulator's micros() when it was there
+ */
+struct proto_pose {
+  int32_t x_mm;
+  int32_t y_mm;
+  int16_t heading_mrad;
+  uint32_t t_us;
+};
+
+/**
+ * The payload of a PROTO_PERF frame, how long one firmware stage took over
+ * the last window, in cpu cycles. The teensy sends one stage at a time, when
+ * there's nothing else to send, and starts that stage's window over. On the
+ * wire it's stage, then each field little endian in the order below
+ *
+ * @stage       PROTO_PERF_LOOP and friends
+ * @mhz         Cycles per microsecond
+ * @rx_peak     Most bytes ever waiting in Serial1's rx ring, since boot
+ * @count       Runs in the window
+ * @min_cycles  Shortest run
+ * @max_cycles  Longest run
+ * @mean_cycles Average run
+ * @hist        Runs per bucket (see PROTO_PERF_SHIFT), saturating
+ */
+struct proto_perf {
+  uint8_t stage;
+  uint16_t mhz;
+  uint16_t rx_peak;
+  uint32_t count;
+  uint32_t min_cycles;
+  uint32_t max_cycles;
+  uint32_t mean_cycles;
+  uint16_t hist[PROTO_PERF_BUCKETS];
+};
+
+/**
+ * The payload of a PROTO_PING frame, the host's half of a latency probe
+ *
+ * @nonce   Tells probes apart
+ * @host_ns The host's CLOCK_MONOTONIC when it sent the ping
+ */
+struct proto_ping {
+  uint32_t nonce;
+  int64_t host_ns;
+};
+
+/**
+ * The payload of a PROTO_PONG frame, the teensy's answer to a ping. The times
+ * are the teensy's micros() so only differences between them mean anything
+ * to the host
+ *
+ * @nonce    Copied from the ping
+ * @host_ns  Copied from the ping
+ * @rx_us    When the ping was decoded
+ * @apply_us When the motors were next written after that
+ * @tx_us    When the pong was sent
+ */
+struct proto_pong {
+  uint32_t nonce;
+  int64_t host_ns;
+  uint32_t rx_us;
+  uint32_t apply_us;
+  uint32_t tx_us;
+};
+
+/**
+ * A byte at a time decoder, it never blocks and never needs more than one
+ * frame of memory
+ *
+ * @buf            Encoded bytes since the last delimiter
+ * @len            Number of bytes in buf
+ * @overflow       Set when a frame got too long, dropped at the next delimiter
+ * @have_seq       Set once we've seen a good frame
+ * @last_seq       seq of the last good frame
+ * @frames         Good frames
+ * @crc_errors     Frames with a bad crc
+ * @framing_errors Frames that were too long, too short or bad COBS
+ * @version_errors Frames from a different protocol version
+ * @lost_frames    Frames missing going by seq
+ */
+struct proto_decoder {
+  uint8_t buf[PROTO_MAX_ENCODED];
+  uint8_t len;
+  uint8_t overflow;
+  uint8_t have_seq;
+  uint8_t last_seq;
+  uint32_t frames;
+  uint32_t crc_errors;
+  uint32_t framing_errors;
+  uint32_t version_errors;
+  uint32_t lost_frames;
+};
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ *
+ * @param data The bytes
+ * @param len Number of bytes
+ *
+ * @return The crc
+ */
+uint16_t proto_crc16(const uint8_t *data, size_t len);
+
+/**
+ * @brief Encodes a frame for the wire
+ *
+ * @param frame The frame to encode (len <= PROTO_MAX_PAYLOAD)
+ * @param out At least PROTO_MAX_ENCODED bytes
+ *
+ * @return Bytes written to out, delimiter included, 0 if frame is too long
+ */
+size_t proto_encode(const struct proto_frame *frame, uint8_t *out);
+
+/**
+ * @brief Resets a decoder and its counters
+ *
+ * @param dec The decoder
+ */
+void proto_decoder_init(struct proto_decoder *dec);
+
+/**
+ * @brief Feeds one received byte to the decoder
+ *
+ * @param dec The decoder
+ * @param byte The byte
+ * @param frame Filled in when a good frame finishes
+ *
+ * @return PROTO_FRAME when frame was filled in, PROTO_ERROR when a bad frame
+ * was dropped, PROTO_MORE otherwise
+ */
+int proto_decode_byte(struct proto_decoder *dec, uint8_t byte,
+                      struct proto_frame *frame);
+
+/**
+ * @brief Builds a PROTO_DRIVE frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param drive The drive values
+ */
+void proto_pack_drive(struct proto_frame *frame, uint8_t seq,
+                      const struct proto_drive *drive);
+
+/**
+ * @brief Reads a PROTO_DRIVE frame
+ *
+ * @param frame The frame
+ * @param drive Filled in with the drive values
+ *
+ * @return 1 if frame is a valid drive frame, 0 otherwise
+ */
+int proto_unpack_drive(const struct proto_frame *frame,
+                       struct proto_drive *drive);
+
+/**
+ * @brief Builds a PROTO_VELOCITY frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param velocity The wheel speeds
+ */
+void proto_pack_velocity(struct proto_frame *frame, uint8_t seq,
+                         const struct proto_velocity *velocity);
+
+/**
+ * @brief Reads a PROTO_VELOCITY frame
+ *
+ * @param frame The frame
+ * @param velocity Filled in with the wheel speeds
+ *
+ * @return 1 if frame is a valid velocity frame, 0 otherwise
+ */
+int proto_unpack_velocity(const struct proto_frame *frame,
+                          struct proto_velocity *velocity);
+
+/**
+ * @brief Whether a frame type is a command (drive or velocity), which the
+ * next command replaces and the teensy acks in telemetry
+ *
+ * @param type The frame type
+ *
+ * @return 1 if it is, 0 otherwise
+ */
+int proto_is_command(uint8_t type);
+
+/**
+ * @brief Builds a PROTO_TELEMETRY frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param telemetry The report
+ */
+void proto_pack_telemetry(struct proto_frame *frame, uint8_t seq,
+                          const struct proto_telemetry *telemetry);
+
+/**
+ * @brief Reads a PROTO_TELEMETRY frame
+ *
+ * @param frame The frame
+ * @param telemetry Filled in with the report
+ *
+ * @return 1 if frame is a valid telemetry frame, 0 otherwise
+ */
+int proto_unpack_telemetry(const struct proto_frame *frame,
+                           struct proto_telemetry *telemetry);
+
+/**
+ * @brief Builds a PROTO_PING frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param ping The ping
+ */
+void proto_pack_ping(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_ping *ping);
+
+/**
+ * @brief Reads a PROTO_PING frame
+ *
+ * @param frame The frame
+ * @param ping Filled in with the ping
+ *
+ * @return 1 if frame is a valid ping frame, 0 otherwise
+ */
+int proto_unpack_ping(const struct proto_frame *frame, struct proto_ping *ping);
+
+/**
+ * @brief Builds a PROTO_PONG frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param pong The pong
+ */
+void proto_pack_pong(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_pong *pong);
+
+/**
+ * @brief Reads a PROTO_PONG frame
+ *
+ * @param frame The frame
+ * @param pong Filled in with the pong
+ *
+ * @return 1 if frame is a valid pong frame, 0 otherwise
+ */
+int proto_unpack_pong(const struct proto_frame *frame, struct proto_pong *pong);
+
+/**
+ * @brief Builds a PROTO_BAUD or PROTO_BAUD_ACK frame
+ * @note The host asks for a baud with PROTO_BAUD, the teensy answers at the
+ * old baud with PROTO_BAUD_ACK (baud 0 if it won't) and then switches
+ *
+ * @param frame The frame to fill in
+ * @param type PROTO_BAUD or PROTO_BAUD_ACK
+ * @param seq The sequence number
+ * @param baud The baud
+ */
+void proto_pack_baud(struct proto_frame *frame, uint8_t type, uint8_t seq,
+                     uint32_t baud);
+
+/**
+ * @brief Reads a PROTO_BAUD or PROTO_BAUD_ACK frame
+ *
+ * @param frame The frame
+ * @param type The type expected
+ * @param baud Filled in with the baud
+ *
+ * @return 1 if frame is a valid frame of that type, 0 otherwise
+ */
+int proto_unpack_baud(const struct proto_frame *frame, uint8_t type,
+                      uint32_t *baud);
+
+/**
+ * @brief Fills in the default limits (PROTO_DRIVE_SLEW and friends)
+ *
+ * @param limits The limits
+ */
+void proto_limits_default(struct proto_limits *limits);
+
+/**
+ * @brief Builds a PROTO_LIMITS frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param limits The limits
+ */
+void proto_pack_limits(struct proto_frame *frame, uint8_t seq,
+                       const struct proto_limits *limits);
+
+/**
+ * @brief Reads a PROTO_LIMITS frame
+ *
+ * @param frame The frame
+ * @param limits Filled in with the limits
+ *
+ * @return 1 if frame is a valid limits frame, 0 otherwise
+ */
+int proto_unpack_limits(const struct proto_frame *frame,
+                        struct proto_limits *limits);
+
+/**
+ * @brief Fills in a layout's mixer, the left motors mounted mirrored and every
+ * scale 100
+ * @note The motors are LF, LB, RF, RB
+ *
+ * @param mixer The mixer
+ * @param layout PROTO_LAYOUT_DIFF, PROTO_LAYOUT_MECANUM or PROTO_LAYOUT_OMNI
+ *
+ * @return 0, -1 for a layout we don't know (mixer is untouched)
+ */
+int proto_mixer_layout(struct proto_mixer *mixer, int layout);
+
+/**
+ * @brief Builds a PROTO_MIXER frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param mixer The mixer
+ */
+void proto_pack_mixer(struct proto_frame *frame, uint8_t seq,
+                      const struct proto_mixer *mixer);
+
+/**
+ * @brief Reads a PROTO_MIXER frame
+ *
+ * @param frame The frame
+ * @param mixer Filled in with the mixer
+ *
+ * @return 1 if frame is a valid mixer frame, 0 otherwise
+ */
+int proto_unpack_mixer(const struct proto_frame *frame,
+                       struct proto_mixer *mixer);
+
+/**
+ * @brief Builds a PROTO_POSE frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param pose The pose
+ */
+void proto_pack_pose(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_pose *pose);
+
+/**
+ * @brief Reads a PROTO_POSE frame
+ *
+ * @param frame The frame
+ * @param pose Filled in with the pose
+ *
+ * @return 1 if frame is a valid pose frame, 0 otherwise
+ */
+int proto_unpack_pose(const struct proto_frame *frame, struct proto_pose *pose);
+
+/**
+ * @brief Builds a PROTO_PERF frame
+ *
+ * @param frame The frame to fill in
+ * @param seq The sequence number
+ * @param perf The stage's timings
+ */
+void proto_pack_perf(struct proto_frame *frame, uint8_t seq,
+                     const struct proto_perf *perf);
+
+/**
+ * @brief Reads a PROTO_PERF frame
+ *
+ * @param frame The frame
+ * @param perf Filled in with the stage's timings
+ *
+ * @return 1 if frame is a valid perf frame for a stage we know, 0 otherwise
+ */
+int proto_unpack_perf(const struct proto_frame *frame, struct proto_perf *perf);
+
+/**
+ * @brief Builds a payload-less frame (ex PROTO_STOP)
+ *
+ * @param frame The frame to fill in
+ * @param type The frame type
+ * @param seq The sequence number
+ */
+void proto_pack_empty(struct proto_frame *frame, uint8_t type, uint8_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard PROTOCOL_H */
@@ -0,0 +1,63 @@
+/**
+ * @file        : hal
+ * @brief What the firmware core needs from the board
+ *
+ * robot_core only ever touches the hardware through these. The teensy build
+ * implements them on top of Arduino in robot.h, native builds link hal_mock
+ * instead, so the core runs (and gets tested and timed) on the host.
+ *
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef HAL_H
+
+#define HAL_H
+
+// C Includes
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Status leds
+#define HAL_LED_RX 0    // A drive frame came in
+#define HAL_LED_ERROR 1 // A bad frame came in
+
+// Clocks, both wrap
+uint32_t hal_millis(void);
+uint32_t hal_micros(void);
+// The cpu cycle counter, for timing the core's stages. Wraps every few seconds
+uint32_t hal_cycles(void);
+uint32_t hal_cycles_per_us(void);
+
+// The host link (Serial1), never blocking
+int hal_serial_available(void);
+int hal_serial_read(void);
+size_t hal_serial_write_space(void);
+void hal_serial_write(const uint8_t *buf, size_t len);
+// Waits for the tx buffer to drain, then switches baud
+void hal_serial_begin(uint32_t baud);
+
+// Motor escs, by motor index
+void hal_pwm_write(int motor, uint16_t duty);
+
+// Wheel encoders, by wheel index. Free running 16 bit counts, forward is up
+uint16_t hal_encoder_count(int wheel);
+
+// Battery voltage
+uint16_t hal_supply_mv(void);
+
+void hal_led(int led, int on);
+
+// Around anything the control tick also touches
+void hal_irq_disable(void);
+void hal_irq_enable(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard HAL_H */
@@ -0,0 +1,573 @@
+/**
+ * @file        : robot_core
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ */
+
+#include "robot_core.h"
+
+#include <math.h>
+#include <string.h>
+
+// Past this a drive motor would overflow mix_out's drive * MAX_THROTTLE
+#define MIX_DRIVE_MAX (INT32_MAX / MAX_THROTTLE)
+
+// Builds the throttle to duty table for every motor from its calibration
+static void pwm_table_init(struct robot_core *core,
+                           const struct motor_cal cal[NUM_MOTORS]) {
+  for (int i = 0; i < NUM_MOTORS; i++) {
+    for (int t = -MAX_THROTTLE; t <= MAX_THROTTLE; t++) {
+      int32_t mag = t < 0 ? -t : t;
+      int32_t span = MAX_THROTTLE - cal[i].deadband;
+      int32_t offset = 0;
+
+      // Straight line from min at the deadband to max at full, rounded
+      if (mag > cal[i].deadband)
+        offset = cal[i].min + ((mag - cal[i].deadband) *
+                                   (cal[i].max - cal[i].min) +
+                               span / 2) /
+                                  span;
+      if ((t < 0) != (cal[i].reversed != 0))
+        offset = -offset;
+      core->pwm_table[i][t + MAX_THROTTLE] = cal[i].zero + offset;
+    }
+  }
+}
+
+// Sends a frame, seq is filled in. 0 if the tx buffer can't take all of it
+static int frame_send(struct robot_core *core, struct proto_frame *f) {
+  size_t len;
+
+  f->seq = core->tx_seq;
+  len = proto_encode(f, core->tx_buf);
+  if (hal_serial_write_space() < len)
+    return 0;
+  hal_serial_write(core->tx_buf, len);
+  core->tx_seq++;
+  return 1;
+}
+
+// Adds a run of a stage that started at start, a hal_cycles(). Tick stages
+// call this from the interrupt, loop stages never touch a tick stage
+static void perf_end(struct robot_core *core, int stage, uint32_t start) {
+  struct perf_stage *perf = &core->perf[stage];
+  uint32_t cycles = hal_cycles() - start;
+  int bucket = 0;
+
+  if (cycles >> PROTO_PERF_SHIFT)
+    bucket = 32 - __builtin_clz(cycles) - PROTO_PERF_SHIFT;
+  if (bucket >= PROTO_PERF_BUCKETS)
+    bucket = PROTO_PERF_BUCKETS - 1;
+  if (!perf->count || cycles < perf->min)
+    perf->min = cycles;
+  if (cycles > perf->max)
+    perf->max = cycles;
+  perf->sum += cycles;
+  perf->count++;
+  if (perf->hist[bucket] != UINT16_MAX)
+    perf->hist[bucket]++;
+}
+
+// A partial frame at the old rate is dropped
+static void baud_switch(struct robot_core *core, uint32_t rate) {
+  hal_serial_begin(rate);
+  core->baud = rate;
+  core->decoder.len = 0;
+  core->decoder.overflow = 0;
+  core->last_rx_ms = hal_millis();
+}
+
+// Forgets what the speed loops learned, for when they haven't been in charge
+static void pid_reset(struct robot_core *core) {
+  for (int i = 0; i < NUM_WHEELS; i++) {
+    core->pid_integral[i] = 0;
+    core->pid_error[i] = 0;
+    core->wheel_out[i] = 0;
+  }
+}
+
+static void handle_frame(struct robot_core *core) {
+  const struct proto_frame *frame = &core->frame;
+  struct proto_drive drive;
+  struct proto_velocity velocity;
+  struct proto_ping ping;
+  struct proto_limits limits;
+  struct proto_mixer mixer;
+  uint32_t rate;
+
+  core->last_rx_ms = hal_millis();
+
+  // The control tick only ever sees a whole command
+  if (proto_unpack_drive(frame, &drive)) {
+    hal_irq_disable();
+    core->vx = 2 * drive.vx;
+    core->vy = 2 * drive.vy;
+    core->omega = 2 * drive.omega;
+    core->gun1 = 2 * drive.gun1;
+    core->gun2 = 2 * drive.gun2;
+    core->closed_loop = 0;
+    core->last_command_ms = hal_millis();
+    core->have_command = 1;
+    hal_irq_enable();
+    core->applied_seq = frame->seq;
+    hal_led(HAL_LED_RX, 1);
+  }
+
+  // Wheel speeds, the speed loops pick the throttles
+  else if (proto_unpack_velocity(frame, &velocity)) {
+    hal_irq_disable();
+    if (!core->closed_loop)
+      pid_reset(core);
+    for (int i = 0; i < NUM_WHEELS; i++)
+      core->target_mm_s[i] = velocity.speed[i];
+    core->gun1 = 2 * velocity.gun1;
+    core->gun2 = 2 * velocity.gun2;
+    core->closed_loop = 1;
+    core->last_command_ms = hal_millis();
+    core->have_command = 1;
+    hal_irq_enable();
+    core->applied_seq = frame->seq;
+    hal_led(HAL_LED_RX, 1);
+  }
+
+  // Stop stops the robot.
+  else if (frame->type == PROTO_STOP) {
+    hal_irq_disable();
+    core->vx = 0;
+    core->vy = 0;
+    core->omega = 0;
+    for (int i = 0; i < NUM_WHEELS; i++)
+      core->target_mm_s[i] = 0;
+    core->last_command_ms = hal_millis();
+    core->have_command = 1;
+    hal_irq_enable();
+  }
+
+  // Latency probe, a newer ping replaces one we haven't answered
+  else if (proto_unpack_ping(frame, &ping)) {
+    core->pong.nonce = ping.nonce;
+    core->pong.host_ns = ping.host_ns;
+    core->pong.rx_us = hal_micros();
+    core->pong_tick = core->ticks;
+    core->pong_pending = 1;
+  }
+
+  // Motion limits and the watchdog timeout
+  else if (proto_unpack_limits(frame, &limits)) {
+    hal_irq_disable();
+    core->limits = limits;
+    hal_irq_enable();
+  }
+
+  // A new chassis
+  else if (proto_unpack_mixer(frame, &mixer)) {
+    hal_irq_disable();
+    core->mixer = mixer;
+    hal_irq_enable();
+  }
+
+  // Baud upgrade, answer at the old rate then switch
+  else if (proto_unpack_baud(frame, PROTO_BAUD, &rate)) {
+    if (rate < BAUD || rate > BAUD_MAX)
+      rate = 0;
+    proto_pack_baud(&core->tx_frame, PROTO_BAUD_ACK, 0, rate);
+    if (frame_send(core, &core->tx_frame) && rate)
+      baud_switch(core, rate);
+  }
+}
+
+// The command watchdog, scales the throttles down to a stop once the host
+// has gone quiet. Every throttle is scaled by the same amount so the robot
+// slows down along the path it was on instead of one side stopping first. A
+// new command brings it right back
+static void failsafe(struct robot_core *core, int8_t throttle[NUM_MOTORS]) {
+  if (!core->have_command ||
+      hal_millis() - core->last_command_ms <= core->limits.timeout_ms) {
+    core->failsafe_scale = FAILSAFE_ONE;
+    return;
+  }
+  if (core->failsafe_scale == FAILSAFE_ONE)
+    core->failsafes++;
+  core->failsafe_scale = core->failsafe_scale > FAILSAFE_STEP
+                             ? core->failsafe_scale - FAILSAFE_STEP
+                             : 0;
+  for (int i = 0; i < NUM_MOTORS; i++)
+    throttle[i] =
+        (int32_t)throttle[i] * (int32_t)core->failsafe_scale / FAILSAFE_ONE;
+}
+
+// Measures each wheel off its encoder and, in closed loop, runs its speed pid.
+// Once every SPEED_PERIOD_TICKS, a 1 ms window is too short to see a slow
+// wheel move. Without an encoder the pid is just its feedforward
+static void speed_step(struct robot_core *core) {
+  const float dt = SPEED_PERIOD_TICKS * CONTROL_PERIOD_US * 1e-6f;
+  uint32_t start;
+
+  if (++core->speed_ticks < SPEED_PERIOD_TICKS)
+    return;
+  core->speed_ticks = 0;
+  start = hal_cycles();
+
+  for (int i = 0; i < NUM_WHEELS; i++) {
+    const struct wheel_cal *wheel = &core->wheels[i];
+    const struct pid_gains *gains = &wheel->gains;
+    uint16_t count = hal_encoder_count(i);
+    float target = core->target_mm_s[i];
+    float *integral = &core->pid_integral[i];
+    float err, out;
+
+    // The counters wrap, the difference doesn't care
+    core->speed_mm_s[i] =
+        (int16_t)(count - core->encoder_last[i]) * wheel->mm_per_count / dt;
+    core->encoder_last[i] = count;
+    if (!core->closed_loop)
+      continue;
+
+    out = gains->kff * target;
+    if (wheel->mm_per_count) {
+      err = target - core->speed_mm_s[i];
+      *integral += gains->ki * err * dt;
+      if (*integral > gains->i_max)
+        *integral = gains->i_max;
+      else if (*integral < -gains->i_max)
+        *integral = -gains->i_max;
+      out += gains->kp * err + *integral +
+             gains->kd * (err - core->pid_error[i]) / dt;
+      core->pid_error[i] = err;
+
+      // A saturated wheel doesn't get to wind the integral up any further
+      if ((out > MAX_THROTTLE && err > 0) || (out < -MAX_THROTTLE && err < 0))
+        *integral -= gains->ki * err * dt;
+    }
+    if (out > MAX_THROTTLE)
+      out = MAX_THROTTLE;
+    else if (out < -MAX_THROTTLE)
+      out = -MAX_THROTTLE;
+    core->wheel_out[i] = out;
+  }
+  perf_end(core, PROTO_PERF_SPEED, start);
+}
+
+// Moves each throttle toward its setpoint within the channel's slew and jerk
+// limits, so the motors follow an S-curve instead of a step. Without a jerk
+// limit it's a plain slew limit, without a slew limit the throttle goes
+// straight to the setpoint
+static void profile_step(struct robot_core *core,
+                         int8_t throttle[NUM_MOTORS]) {
+  const float dt = CONTROL_PERIOD_US * 1e-6f;
+  for (int i = 0; i < NUM_MOTORS; i++) {
+    float *pos = &core->profile_pos[i];
+    float *rate = &core->profile_rate[i];
+    float err = throttle[i] - *pos;
+    float jerk = core->limits.jerk[i];
+    float want = core->limits.slew[i];
+
+    if (!core->limits.slew[i]) {
+      *pos = throttle[i];
+      *rate = 0;
+      continue;
+    }
+
+    // As fast as we can go and still ease into the setpoint
+    if (jerk && sqrtf(2 * jerk * fabsf(err)) < want)
+      want = sqrtf(2 * jerk * fabsf(err));
+    if (err < 0)
+      want = -want;
+    if (!jerk)
+      *rate = want;
+    else if (want - *rate > jerk * dt)
+      *rate += jerk * dt;
+    else if (want - *rate < -jerk * dt)
+      *rate -= jerk * dt;
+    else
+      *rate = want;
+
+    if (*rate * err > 0 && fabsf(*rate * dt) >= fabsf(err)) {
+      *pos = throttle[i];
+      *rate = 0;
+    } else {
+      *pos += *rate * dt;
+    }
+    throttle[i] = lroundf(*pos);
+  }
+}
+
+// Only channels whose duty changed are written, the pwm hardware keeps the
+// rest going
+static void motor_write(struct robot_core *core) {
+  for (int i = 0; i < NUM_MOTORS; i++) {
+    uint16_t duty = robot_core_convert(core, i, core->throttle[i]);
+    if (duty == core->duty_written[i])
+      continue;
+    hal_pwm_write(i, duty);
+    core->duty_written[i] = duty;
+  }
+}
+
+// Answers the last ping once a control tick has written the motors after it
+// came in. If the tx buffer is full the pong is dropped and the host counts
+// the probe as lost
+static void pong_send(struct robot_core *core) {
+  if (!core->pong_pending || core->ticks == core->pong_tick)
+    return;
+  core->pong_pending = 0;
+  core->pong.apply_us = core->tick_us;
+  core->pong.tx_us = hal_micros();
+  proto_pack_pong(&core->tx_frame, 0, &core->pong);
+  frame_send(core, &core->tx_frame);
+}
+
+// Tells the host what we actually did, a report that doesn't fit is counted
+// in tx_dropped
+static void telemetry_send(struct robot_core *core) {
+  struct proto_telemetry *report = &core->telemetry;
+  uint32_t period, busy_max;
+
+  hal_irq_disable();
+  for (int i = 0; i < NUM_MOTORS; i++)
+    report->throttle[i] = core->throttle[i];
+  for (int i = 0; i < NUM_WHEELS; i++)
+    report->speed[i] = lroundf(core->speed_mm_s[i]);
+  period = core->period_us;
+  busy_max = core->busy_max_us;
+  hal_irq_enable();
+
+  report->ack_seq = core->applied_seq;
+  report->period_us = period < UINT16_MAX ? period : UINT16_MAX;
+  report->busy_max_us = busy_max < UINT16_MAX ? busy_max : UINT16_MAX;
+  report->supply_mv = hal_supply_mv();
+  report->crc_errors = core->decoder.crc_errors;
+  report->framing_errors = core->decoder.framing_errors;
+  report->lost_frames = core->decoder.lost_frames;
+  report->overruns = core->overruns;
+  report->failsafes = core->failsafes;
+
+  proto_pack_telemetry(&core->tx_frame, 0, report);
+  if (!frame_send(core, &core->tx_frame)) {
+    report->tx_dropped++;
+    return;
+  }
+  hal_irq_disable();
+  core->busy_max_us = 0;
+  hal_irq_enable();
+}
+
+// Sends the next stage's timings and starts it over. The tick's stages keep
+// counting while we look, so they're taken with interrupts off, and only once
+// the report is sure to fit so nothing gets thrown away
+static void perf_send(struct robot_core *core) {
+  struct perf_stage *stage = &core->perf[core->perf_next];
+  struct perf_stage snap;
+  struct proto_perf perf;
+
+  if (hal_serial_write_space() < PROTO_MAX_ENCODED)
+    return;
+  hal_irq_disable();
+  snap = *stage;
+  memset(stage, 0, sizeof(*stage));
+  hal_irq_enable();
+
+  perf.stage = core->perf_next;
+  perf.mhz = hal_cycles_per_us();
+  perf.rx_peak = core->rx_peak;
+  perf.count = snap.count;
+  perf.min_cycles = snap.min;
+  perf.max_cycles = snap.max;
+  perf.mean_cycles = snap.count ? snap.sum / snap.count : 0;
+  for (int i = 0; i < PROTO_PERF_BUCKETS; i++)
+    perf.hist[i] = snap.hist[i];
+
+  proto_pack_perf(&core->tx_frame, 0, &perf);
+  frame_send(core, &core->tx_frame);
+  core->perf_next = (core->perf_next + 1) % PROTO_PERF_STAGES;
+  core->last_perf = hal_micros();
+}
+
+void robot_core_init(struct robot_core *core,
+                     const struct motor_cal cal[NUM_MOTORS],
+                     const struct wheel_cal wheels[NUM_WHEELS]) {
+  memset(core, 0, sizeof(*core));
+  proto_decoder_init(&core->decoder);
+  proto_limits_default(&core->limits);
+  proto_mixer_layout(&core->mixer, PROTO_LAYOUT_DIFF);
+  pwm_table_init(core, cal);
+  for (int i = 0; i < NUM_MOTORS; i++)
+    core->duty_written[i] = -1;
+  for (int i = 0; i < NUM_WHEELS; i++) {
+    core->wheels[i] = wheels[i];
+    core->encoder_last[i] = hal_encoder_count(i);
+  }
+  core->failsafe_scale = FAILSAFE_ONE;
+  core->baud = BAUD;
+  core->last_rx_ms = hal_millis();
+  core->last_telemetry = hal_micros();
+  core->last_perf = core->last_telemetry;
+  core->tick_start = core->last_telemetry;
+}
+
+void robot_core_listen(struct robot_core *core) {
+  uint32_t start = hal_cycles();
+  uint32_t frame_start;
+  int waiting = hal_serial_available();
+
+  // The closest we get to seeing an overrun is the ring filling up
+  if (waiting > core->rx_peak)
+    core->rx_peak = waiting < UINT16_MAX ? waiting : UINT16_MAX;
+  if (!waiting)
+    return;
+
+  while (hal_serial_available()) {
+    switch (proto_decode_byte(&core->decoder, hal_serial_read(),
+                              &core->frame)) {
+    case PROTO_FRAME:
+      frame_start = hal_cycles();
+      handle_frame(core);
+      perf_end(core, PROTO_PERF_FRAME, frame_start);
+      break;
+    case PROTO_ERROR:
+      hal_led(HAL_LED_ERROR, 1); // Error, the frame is dropped
+      break;
+    default:
+      break;
+    }
+  }
+  perf_end(core, PROTO_PERF_LISTEN, start);
+}
+
+static int8_t clamp_throttle(int32_t throttle) {
+  if (throttle > MAX_THROTTLE)
+    return MAX_THROTTLE;
+  if (throttle < -MAX_THROTTLE)
+    return -MAX_THROTTLE;
+  return throttle;
+}
+
+// Every drive motor scaled by the same amount, so the fastest is at full
+static void mix_out(int8_t throttle[NUM_MOTORS],
+                    const int32_t drive[PROTO_DRIVE_CHANNELS], int gun1,
+                    int gun2) {
+  int32_t peak = MAX_THROTTLE;
+
+  for (int i = 0; i < PROTO_DRIVE_CHANNELS; i++)
+    if (drive[i] > peak || -drive[i] > peak)
+      peak = drive[i] > 0 ? drive[i] : -drive[i];
+  for (int i = 0; i < PROTO_DRIVE_CHANNELS; i++)
+    throttle[i] = drive[i] * MAX_THROTTLE / peak;
+  throttle[GUN_1_IN] = clamp_throttle(-gun1);
+  throttle[GUN_2_IN] = clamp_throttle(gun2);
+}
+
+void robot_core_mix(const struct proto_mixer *mixer,
+                    int8_t throttle[NUM_MOTORS], int vx, int vy, int omega,
+                    int gun1, int gun2) {
+  int32_t drive[PROTO_DRIVE_CHANNELS];
+
+  // The mixer is whatever the host sent, a full int16_t coef on a full
+  // command times a full scale doesn't fit in 32 bits
+  for (int i = 0; i < PROTO_DRIVE_CHANNELS; i++) {
+    const int16_t *coef = mixer->coef[i];
+    int64_t wheel = (int64_t)coef[0] * vx + (int64_t)coef[1] * vy +
+                    (int64_t)coef[2] * omega;
+    wheel = wheel * mixer->scale[i] / (PROTO_MIXER_ONE * 100);
+    if (wheel > MIX_DRIVE_MAX)
+      wheel = MIX_DRIVE_MAX;
+    else if (wheel < -MIX_DRIVE_MAX)
+      wheel = -MIX_DRIVE_MAX;
+    drive[i] = wheel;
+  }
+  mix_out(throttle, drive, gun1, gun2);
+}
+
+void robot_core_mix_wheels(const struct proto_mixer *mixer,
+                           int8_t throttle[NUM_MOTORS], int left, int right,
+                           int gun1, int gun2) {
+  int32_t drive[PROTO_DRIVE_CHANNELS];
+
+  drive[LF_INDEX] = left * mixer->scale[LF_INDEX] / 100;
+  drive[LB_INDEX] = left * mixer->scale[LB_INDEX] / 100;
+  drive[RF_INDEX] = right * mixer->scale[RF_INDEX] / 100;
+  drive[RB_INDEX] = right * mixer->scale[RB_INDEX] / 100;
+  mix_out(throttle, drive, gun1, gun2);
+}
+
+uint16_t robot_core_convert(const struct robot_core *core, int motor,
+                            int8_t throttle) {
+  if (throttle < -MAX_THROTTLE)
+    throttle = -MAX_THROTTLE;
+  else if (throttle > MAX_THROTTLE)
+    throttle = MAX_THROTTLE;
+  return core->pwm_table[motor][throttle + MAX_THROTTLE];
+}
+
+void robot_core_tick(struct robot_core *core) {
+  uint32_t start = hal_cycles();
+  uint32_t now = hal_micros();
+  uint32_t busy, stage;
+
+  // Late behind a long tick is the same overrun, it counted itself
+  if (core->ticks && core->busy_us < CONTROL_PERIOD_US &&
+      now - core->tick_start > CONTROL_PERIOD_US + CONTROL_LATE_US)
+    core->overruns++;
+  core->period_us = now - core->tick_start;
+  core->tick_start = now;
+
+  speed_step(core);
+  stage = hal_cycles();
+  if (core->closed_loop)
+    robot_core_mix_wheels(&core->mixer, core->throttle,
+                          lroundf(core->wheel_out[WHEEL_LEFT]),
+                          lroundf(core->wheel_out[WHEEL_RIGHT]), core->gun1,
+                          core->gun2);
+  else
+    robot_core_mix(&core->mixer, core->throttle, core->vx, core->vy,
+                   core->omega, core->gun1, core->gun2);
+  failsafe(core, core->throttle);
+  // Don't let the integrals wind up against the watchdog
+  if (core->failsafe_scale != FAILSAFE_ONE)
+    for (int i = 0; i < NUM_WHEELS; i++)
+      core->pid_integral[i] = 0;
+  perf_end(core, PROTO_PERF_MIX, stage);
+  stage = hal_cycles();
+  profile_step(core, core->throttle);
+  perf_end(core, PROTO_PERF_PROFILE, stage);
+  stage = hal_cycles();
+  motor_write(core);
+  perf_end(core, PROTO_PERF_WRITE, stage);
+  core->tick_us = hal_micros();
+  core->ticks++;
+
+  busy = hal_micros() - now;
+  core->busy_us = busy;
+  if (busy > core->busy_max_us)
+    core->busy_max_us = busy;
+  if (busy >= CONTROL_PERIOD_US)
+    core->overruns++;
+  perf_end(core, PROTO_PERF_TICK, start);
+}
+
+void robot_core_loop(struct robot_core *core) {
+  uint32_t start = hal_cycles();
+  uint8_t seq = core->tx_seq;
+
+  robot_core_listen(core);
+
+  // That's either a rate that doesn't work or the host gave up on it
+  if (core->baud != BAUD && hal_millis() - core->last_rx_ms > BAUD_REVERT_MS)
+    baud_switch(core, BAUD);
+
+  pong_send(core);
+
+  if (hal_micros() - core->last_telemetry >= TELEMETRY_PERIOD_US) {
+    uint32_t report = hal_cycles();
+
+    core->last_telemetry = hal_micros();
+    telemetry_send(core);
+    hal_led(HAL_LED_RX, 0);
+    hal_led(HAL_LED_ERROR, 0);
+    perf_end(core, PROTO_PERF_REPORT, report);
+  }
+
+  // Lowest priority, only in a pass that sent nothing else
+  if (core->tx_seq == seq && hal_micros() - core->last_perf >= PERF_PERIOD_US)
+    perf_send(core);
+  perf_end(core, PROTO_PERF_LOOP, start);
+}
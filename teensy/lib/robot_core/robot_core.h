@@ -0,0 +1,369 @@
+/**
+ * @file        : robot_core
+ * @brief The firmware's logic, without the board
+ *
+ * Everything the teensy does between a byte coming in on Serial1 and a duty
+ * going out to an esc: frame handling, the mixer, the command watchdog, the
+ * motion profile, the throttle to pwm table and the reports back to the host.
+ * The hardware is behind hal.h, so this is plain C and the same files build
+ * for the teensy, for the native unit tests and for the host benchmark.
+ *
+ * A drive frame sets vx / vy / omega and the mixer the host sent (a tank until
+ * it sends one) turns that into throttles, so a new chassis is a new mixer
+ * frame, not a new firmware. A velocity frame sets wheel speeds instead,
+ * and every SPEED_PERIOD_TICKS the tick measures each wheel off its encoder
+ * and a pid per wheel picks the throttle that holds the speed, whatever the
+ * battery and the load are doing. The measured speeds go back in telemetry.
+ *
+ * Two entry points run it. robot_core_loop is one pass of loop(): it reads
+ * the serial port and sends whatever is due. robot_core_tick is the control
+ * tick, run from the timer interrupt: it turns the latest command into duties.
+ * Whatever both of them touch is written with interrupts off.
+ *
+ * Both time their stages (PROTO_PERF_LOOP and friends) off the cpu's cycle
+ * counter, into a min, max and power of two histogram per stage. Every
+ * PERF_PERIOD_US a loop pass that had nothing else to send sends the next
+ * stage's numbers to the host and starts that stage over, so the host sees
+ * every stage every couple of seconds and the reports never cost a command
+ * or a report its place in the tx buffer.
+ *
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef ROBOT_CORE_H
+
+#define ROBOT_CORE_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+#include "hal.h"
+#include "protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PWM Constants
+#define PWM_ZERO 1535
+#define PWM_SPAN 512 // Full throttle is PWM_ZERO +- this (5.12 per unit)
+
+// Throttle and Robot Constants
+#define MAX_THROTTLE 100
+#define BAUD 9600 // Where we start and what we fall back to
+#define BAUD_MAX 2000000
+#define BAUD_REVERT_MS 1000 // No good frame this long after a switch, go back
+#define NUM_MOTORS 6
+
+// Motor indexes
+#define LF_INDEX 0
+#define LB_INDEX 1
+#define RF_INDEX 2
+#define RB_INDEX 3
+#define GUN_1_IN 4
+#define GUN_2_IN 5
+
+// Control tick, a new command reaches the pwm registers within a tick of
+// coming in no matter what the serial side is doing
+#define CONTROL_PERIOD_US 1000
+// A tick starting this late is counted as an overrun, unless the one before
+// ran long and was counted already
+#define CONTROL_LATE_US 250
+// Command watchdog: no drive or stop frame for limits.timeout_ms and every
+// throttle ramps down to PWM_ZERO over FAILSAFE_RAMP_MS. The host sends a
+// keepalive every 250 ms
+#define FAILSAFE_RAMP_MS 300
+#define FAILSAFE_ONE 65536 // failsafe_scale of a full command
+#define FAILSAFE_STEP                                                          \
+  (FAILSAFE_ONE * CONTROL_PERIOD_US / (FAILSAFE_RAMP_MS * 1000))
+
+// Telemetry
+#define TELEMETRY_PERIOD_US 100000
+// A PROTO_PERF this often at most, one stage each
+#define PERF_PERIOD_US 200000
+
+// Wheel speed control, one encoder and pid per side
+#define NUM_WHEELS PROTO_WHEELS
+#define WHEEL_LEFT 0
+#define WHEEL_RIGHT 1
+// Ticks between speed measurements (and pid updates), long enough that a
+// slow wheel still moves a few counts
+#define SPEED_PERIOD_TICKS 10
+
+////////// Data Structures //////////
+
+/**
+ * Per motor esc calibration, all in pwm counts except the deadband
+ *
+ * @zero     Stopped
+ * @min      Offset from zero where the motor starts to turn, at the edge
+ * of the deadband
+ * @max      Offset from zero at full throttle
+ * @deadband Throttles this close to 0 write zero
+ * @reversed Flips the direction, for a motor mounted the other way
+ */
+struct motor_cal {
+  uint16_t zero;
+  uint16_t min;
+  uint16_t max;
+  uint8_t deadband;
+  uint8_t reversed;
+};
+
+// The plain PWM_ZERO + 5.12 per unit mapping
+#define MOTOR_CAL_DEFAULT {PWM_ZERO, 0, PWM_SPAN, 0, 0}
+
+/**
+ * Speed pid gains, the output is in throttle units
+ *
+ * @kff   Feedforward, throttle per mm/s of target
+ * @kp    Throttle per mm/s of error
+ * @ki    Throttle per mm/s of error per second
+ * @kd    Throttle per mm/s of error change per second
+ * @i_max Most throttle the integral can add
+ */
+struct pid_gains {
+  float kff;
+  float kp;
+  float ki;
+  float kd;
+  float i_max;
+};
+
+/**
+ * Per wheel encoder and speed loop setup
+ *
+ * @mm_per_count Wheel travel per encoder count, 0 for no encoder (velocity
+ * frames are then feedforward only)
+ * @gains        The speed pid
+ */
+struct wheel_cal {
+  float mm_per_count;
+  struct pid_gains gains;
+};
+
+// Full throttle is about 2 m/s on the ground. Tuned on hal_mock's plant, see
+// firmware-bench -s
+#define PID_GAINS_DEFAULT {0.05f, 0.06f, 0.1f, 0, 40}
+// No encoder
+#define WHEEL_CAL_DEFAULT {0, PID_GAINS_DEFAULT}
+
+/**
+ * One stage's timings since they last went to the host, in cpu cycles. A
+ * loop() stage includes any control tick that interrupted it
+ *
+ * @min   Shortest run
+ * @max   Longest run
+ * @sum   All the runs
+ * @count Runs
+ * @hist  Runs per bucket, see PROTO_PERF_SHIFT. Saturates
+ */
+struct perf_stage {
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t count;
+  uint16_t hist[PROTO_PERF_BUCKETS];
+};
+
+/**
+ * The whole firmware state, there's one of these
+ *
+ * @decoder         Frame decoder, keeps partial frames between loops
+ * @frame           The frame being handled
+ * @tx_frame        The frame being sent
+ * @tx_buf          tx_frame encoded
+ * @tx_seq          seq of the next frame out
+ * @applied_seq     seq of the last drive frame, echoed in telemetry
+ * @baud            Serial1's baud
+ * @last_rx_ms      When we last decoded a good frame
+ * @vx              The command, vx / vy / omega / gun1 / gun2, in throttle
+ * units
+ * @last_command_ms When the last drive or stop came in
+ * @have_command    Set once a drive or stop came in
+ * @limits          Motion limits and the watchdog timeout, the host can change
+ * these
+ * @mixer           The drive mixer, the host can change it
+ * @closed_loop     Set by a velocity frame, cleared by a drive frame
+ * @target_mm_s     Wheel speeds the last velocity frame asked for
+ * @wheels          Each wheel's encoder and pid setup
+ * @pong            Answered after the next control tick
+ * @pong_pending    Set when pong is waiting
+ * @pong_tick       ticks when the ping came in
+ * @throttle        What the last tick wrote
+ * @failsafe_scale  How much of the command the watchdog lets through
+ * @failsafes       Times the watchdog ran out
+ * @profile_pos     Where each throttle is
+ * @profile_rate    How fast it's moving, units per second
+ * @pwm_table       Throttle to duty, [motor][throttle + MAX_THROTTLE]
+ * @duty_written    The last duty written to each motor, -1 not yet
+ * @speed_ticks     Ticks since the last speed measurement
+ * @encoder_last    Each encoder's count at the last measurement
+ * @speed_mm_s      Each wheel's measured speed
+ * @pid_integral    Each pid's integral, in throttle units
+ * @pid_error       Each pid's last error
+ * @wheel_out       Each pid's throttle, forward is positive
+ * @ticks           Control ticks so far
+ * @tick_us         When the last tick wrote the motors
+ * @tick_start      When the last tick started
+ * @period_us       Time between the last two ticks
+ * @busy_us         How long the last tick took
+ * @busy_max_us     The longest tick since the last report
+ * @overruns        Ticks that ran long, or started late for some other reason
+ * @telemetry       The report, tx_dropped carries over
+ * @last_telemetry  micros() of the last report
+ * @perf            Each stage's timings, the tick's stages are written from
+ * the interrupt
+ * @perf_next       The stage that goes to the host next
+ * @last_perf       micros() of the last PROTO_PERF
+ * @rx_peak         Most bytes ever waiting in Serial1
+ */
+struct robot_core {
+  struct proto_decoder decoder;
+  struct proto_frame frame;
+  struct proto_frame tx_frame;
+  uint8_t tx_buf[PROTO_MAX_ENCODED];
+  uint8_t tx_seq;
+  uint8_t applied_seq;
+  uint32_t baud;
+  uint32_t last_rx_ms;
+  volatile int16_t vx;
+  volatile int16_t vy;
+  volatile int16_t omega;
+  volatile int16_t gun1;
+  volatile int16_t gun2;
+  volatile uint32_t last_command_ms;
+  volatile uint8_t have_command;
+  struct proto_limits limits;
+  struct proto_mixer mixer;
+  volatile uint8_t closed_loop;
+  volatile int16_t target_mm_s[NUM_WHEELS];
+  struct wheel_cal wheels[NUM_WHEELS];
+  struct proto_pong pong;
+  uint8_t pong_pending;
+  uint32_t pong_tick;
+  int8_t throttle[NUM_MOTORS];
+  uint32_t failsafe_scale;
+  uint16_t failsafes;
+  float profile_pos[NUM_MOTORS];
+  float profile_rate[NUM_MOTORS];
+  uint16_t pwm_table[NUM_MOTORS][2 * MAX_THROTTLE + 1];
+  int32_t duty_written[NUM_MOTORS];
+  uint8_t speed_ticks;
+  uint16_t encoder_last[NUM_WHEELS];
+  float speed_mm_s[NUM_WHEELS];
+  float pid_integral[NUM_WHEELS];
+  float pid_error[NUM_WHEELS];
+  float wheel_out[NUM_WHEELS];
+  volatile uint32_t ticks;
+  volatile uint32_t tick_us;
+  volatile uint32_t tick_start;
+  volatile uint32_t period_us;
+  volatile uint32_t busy_us;
+  volatile uint32_t busy_max_us;
+  volatile uint32_t overruns;
+  struct proto_telemetry telemetry;
+  uint32_t last_telemetry;
+  struct perf_stage perf[PROTO_PERF_STAGES];
+  uint8_t perf_next;
+  uint32_t last_perf;
+  uint16_t rx_peak;
+};
+
+/**
+ * @brief Sets up the core, like setup()
+ * @note Doesn't touch the serial port, open it at BAUD first. Call before the
+ * control tick starts
+ *
+ * @param core The core
+ * @param cal Each motor's calibration, the pwm table is built from these
+ * @param wheels Each wheel's encoder and pid setup
+ */
+void robot_core_init(struct robot_core *core,
+                     const struct motor_cal cal[NUM_MOTORS],
+                     const struct wheel_cal wheels[NUM_WHEELS]);
+
+/**
+ * @brief Reads the serial port and does stuff
+ * @note Only reads what the rx interrupt already buffered, one byte at a time
+ * into the frame decoder, so this never blocks and a partial frame just waits
+ * in the decoder for the rest. A corrupted frame is dropped and we're back in
+ * sync at the next one (see protocol.h)
+ *
+ * @param core The core
+ */
+void robot_core_listen(struct robot_core *core);
+
+/**
+ * @brief Mixes a command into per motor throttles
+ * @note Nothing wraps, a drive motor past MAX_THROTTLE scales every drive
+ * motor down with it and the guns are clamped
+ *
+ * @param mixer The drive mixer
+ * @param throttle The throttles out
+ * @param vx Forward
+ * @param vy Sideways, right is positive
+ * @param omega Turning, clockwise is positive
+ * @param gun1 Gun motor 1
+ * @param gun2 Gun motor 2
+ */
+void robot_core_mix(const struct proto_mixer *mixer,
+                    int8_t throttle[NUM_MOTORS], int vx, int vy, int omega,
+                    int gun1, int gun2);
+
+/**
+ * @brief Mixes wheel throttles into per motor throttles, both motors on a
+ * side get their wheel's times their mixer scale
+ * @note For a tank, the encoders are one per side
+ *
+ * @param mixer The drive mixer, only its scales
+ * @param throttle The throttles out
+ * @param left Left wheel, forward is positive
+ * @param right Right wheel, forward is positive
+ * @param gun1 Gun motor 1
+ * @param gun2 Gun motor 2
+ */
+void robot_core_mix_wheels(const struct proto_mixer *mixer,
+                           int8_t throttle[NUM_MOTORS], int left, int right,
+                           int gun1, int gun2);
+
+/**
+ * @brief Convert a throttle to a pwm likeable number
+ *
+ * @param core The core, for its pwm table
+ * @param motor The motor index
+ * @param throttle The throttle, clamped to +-MAX_THROTTLE
+ *
+ * @return The nice PWM throttle
+ */
+uint16_t robot_core_convert(const struct robot_core *core, int motor,
+                            int8_t throttle);
+
+/**
+ * @brief The control tick, applies the latest command to the motors
+ * @note Runs from the timer interrupt every CONTROL_PERIOD_US: speed loop,
+ * mix, watchdog, motion profile, then a pwm write for every motor whose duty
+ * changed
+ *
+ * @param core The core
+ */
+void robot_core_tick(struct robot_core *core);
+
+/**
+ * @brief One pass of loop(): listens, falls back to BAUD if a new baud isn't
+ * working, answers a ping once a tick has applied it, reports every
+ * TELEMETRY_PERIOD_US and, when nothing else went out, sends a stage's timings
+ * every PERF_PERIOD_US
+ * @note Never blocks, anything that doesn't fit in the tx buffer is skipped
+ *
+ * @param core The core
+ */
+void robot_core_loop(struct robot_core *core);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard ROBOT_CORE_H */
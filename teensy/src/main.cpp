@@ -1,22 +1,21 @@
 #include "robot.h"
-int motors[NUM_MOTORS];
-int8_t throttle[NUM_MOTORS];
 
-char message[3];
+struct robot_core core; // No allocations
+uint8_t rx_buffer[RX_BUFFER_SIZE]; // Serial1's rx ring grows into this
+IntervalTimer control_timer;
 
-// minimal allocations
-int8_t lin;
-int8_t ang;
-int8_t gun1;
-int8_t gun2;
+/**
+ * @brief The control tick, applies the latest command to the motors
+ * @note Runs from the timer interrupt every CONTROL_PERIOD_US, whatever the
+ * serial side is up to. It's at the default IntervalTimer priority, below
+ * the uart's, so a tick can't make us drop bytes
+ */
+void control_tick() { robot_core_tick(&core); }
 
 void setup() {
-  // Sets all motors to respective pins
-  configure_motors(motors);
-
   // Write initial frequency
   for (unsigned int i = 0U; i < NUM_MOTORS; ++i)
-    analogWriteFrequency(motors[i], PWM_INIT);
+    analogWriteFrequency(motor_pins[i], PWM_INIT);
 
   // Status led lights up and turns off everytime a message is recieved
   pinMode(LED1, OUTPUT);
@@ -29,22 +28,23 @@ void setup() {
 
   // Serial1 is teensy's hardware serial (tx rx pin 0 and 1)
   Serial1.begin(BAUD);
+  Serial1.addMemoryForRead(rx_buffer, sizeof(rx_buffer));
   analogWriteResolution(12);
-}
-
-void loop() {
 
-  // This reads data on the serial bus
-  serial_listen(message, lin, ang, gun1, gun2);
+  // Before the core takes its first count
+  encoders_init();
 
-  // Writes throttles to motors based on lin and ang
-  callback_velocity(throttle, lin, ang, gun1, gun2);
+  // The cycle counter the core times itself with, off out of reset
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
 
-  // Writes to motors (escs)
-  motor_write(motors, throttle);
+  robot_core_init(&core, motor_cals, wheel_cals);
+  control_timer.begin(control_tick, CONTROL_PERIOD_US);
+}
 
-  // Milliseconds
-  delay(10);
-  digitalWrite(LED2, LOW);
-  digitalWrite(LED3, LOW);
+void loop() {
+  // This reads data on the serial bus, every pass so frames are decoded as
+  // they come in. The tick picks up whatever was decoded last. Then the
+  // baud watchdog, pongs and telemetry
+  robot_core_loop(&core);
 }
@@ -0,0 +1,519 @@
+/**
+ * @file        : test_core
+ * @brief robot_core against the mocked board
+ *
+ * $ platformio test -e native
+ *
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ * @bugs        No known bugs
+ */
+
+#include <string.h>
+#include <unity.h>
+
+#include "hal_mock.h"
+#include "robot_core.h"
+
+static const struct motor_cal default_cal[NUM_MOTORS] = {
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT,
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT};
+
+// The mock's encoders, feedforward for its full speed
+#define TEST_WHEEL_CAL                                                         \
+  {MOCK_MM_PER_COUNT, {100.0f / MOCK_MAX_MM_S, 0.06f, 0.1f, 0, 40}}
+static const struct wheel_cal test_wheels[NUM_WHEELS] = {TEST_WHEEL_CAL,
+                                                         TEST_WHEEL_CAL};
+
+static struct robot_core core;
+static uint8_t host_seq;
+
+// A frame from the host, encoded onto Serial1
+static void host_send(struct proto_frame *frame) {
+  uint8_t buf[PROTO_MAX_ENCODED];
+
+  frame->seq = host_seq++;
+  TEST_ASSERT_EQUAL(0, hal_mock_rx(buf, proto_encode(frame, buf)));
+}
+
+// A tank's command, no vy
+static void host_drive(int8_t vx, int8_t omega, int8_t gun1, int8_t gun2) {
+  struct proto_drive drive = {vx, 0, omega, gun1, gun2};
+  struct proto_frame frame;
+
+  proto_pack_drive(&frame, 0, &drive);
+  host_send(&frame);
+}
+
+static void host_velocity(int16_t left, int16_t right) {
+  struct proto_velocity velocity = {{left, right}, 0, 0};
+  struct proto_frame frame;
+
+  proto_pack_velocity(&frame, 0, &velocity);
+  host_send(&frame);
+}
+
+// Runs the board for us microseconds: a tick every CONTROL_PERIOD_US and a
+// loop pass in between
+static void run(uint32_t us) {
+  for (uint32_t t = 0; t < us; t += CONTROL_PERIOD_US) {
+    robot_core_loop(&core);
+    hal_mock_advance(CONTROL_PERIOD_US);
+    robot_core_tick(&core);
+  }
+}
+
+// Limits off, so a command shows up in one tick
+static void no_limits() {
+  for (int i = 0; i < NUM_MOTORS; i++) {
+    core.limits.slew[i] = 0;
+    core.limits.jerk[i] = 0;
+  }
+}
+
+void setUp(void) {
+  hal_mock_reset();
+  host_seq = 0;
+  robot_core_init(&core, default_cal, test_wheels);
+}
+
+void tearDown(void) {}
+
+void test_drive_frame_sets_the_command(void) {
+  host_drive(10, -5, 3, 4);
+  robot_core_listen(&core);
+
+  TEST_ASSERT_EQUAL_INT16(20, core.vx);
+  TEST_ASSERT_EQUAL_INT16(0, core.vy);
+  TEST_ASSERT_EQUAL_INT16(-10, core.omega);
+  TEST_ASSERT_EQUAL_INT8(6, core.gun1);
+  TEST_ASSERT_EQUAL_INT8(8, core.gun2);
+  TEST_ASSERT_EQUAL_UINT8(0, core.applied_seq);
+  TEST_ASSERT_EQUAL(1, core.have_command);
+  TEST_ASSERT_EQUAL(1, mock.led[HAL_LED_RX]);
+  TEST_ASSERT_EQUAL(0, mock.irq_depth);
+}
+
+void test_partial_frame_waits_for_the_rest(void) {
+  struct proto_drive drive = {10, 0, 0, 0, 0};
+  struct proto_frame frame;
+  uint8_t buf[PROTO_MAX_ENCODED];
+  size_t len;
+
+  proto_pack_drive(&frame, 0, &drive);
+  len = proto_encode(&frame, buf);
+  hal_mock_rx(buf, len - 3);
+  robot_core_listen(&core);
+  TEST_ASSERT_EQUAL_INT16(0, core.vx);
+
+  hal_mock_rx(buf + len - 3, 3);
+  robot_core_listen(&core);
+  TEST_ASSERT_EQUAL_INT16(20, core.vx);
+}
+
+void test_corrupted_frame_is_dropped(void) {
+  struct proto_drive drive = {10, 0, 0, 0, 0};
+  struct proto_frame frame;
+  uint8_t buf[PROTO_MAX_ENCODED];
+  size_t len;
+
+  proto_pack_drive(&frame, 0, &drive);
+  len = proto_encode(&frame, buf);
+  buf[2] ^= 0x10;
+  hal_mock_rx(buf, len);
+  robot_core_listen(&core);
+
+  TEST_ASSERT_EQUAL_INT16(0, core.vx);
+  TEST_ASSERT_EQUAL_UINT32(1, core.decoder.crc_errors);
+  TEST_ASSERT_EQUAL(1, mock.led[HAL_LED_ERROR]);
+
+  // Back in sync at the next one
+  host_drive(7, 0, 0, 0);
+  robot_core_listen(&core);
+  TEST_ASSERT_EQUAL_INT16(14, core.vx);
+}
+
+void test_stop_frame_stops(void) {
+  struct proto_frame frame;
+
+  host_drive(10, 10, 5, 0);
+  proto_pack_empty(&frame, PROTO_STOP, 0);
+  host_send(&frame);
+  robot_core_listen(&core);
+
+  TEST_ASSERT_EQUAL_INT16(0, core.vx);
+  TEST_ASSERT_EQUAL_INT16(0, core.omega);
+}
+
+void test_limits_frame_replaces_the_limits(void) {
+  struct proto_limits limits;
+  struct proto_frame frame;
+
+  proto_limits_default(&limits);
+  limits.slew[0] = 123;
+  limits.timeout_ms = 42;
+  proto_pack_limits(&frame, 0, &limits);
+  host_send(&frame);
+  robot_core_listen(&core);
+
+  TEST_ASSERT_EQUAL_UINT16(123, core.limits.slew[0]);
+  TEST_ASSERT_EQUAL_UINT16(42, core.limits.timeout_ms);
+}
+
+void test_mix_is_a_tank_mix(void) {
+  int8_t throttle[NUM_MOTORS];
+
+  robot_core_mix(&core.mixer, throttle, 40, 0, 10, 20, 30);
+  TEST_ASSERT_EQUAL_INT8(-50, throttle[LF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(-50, throttle[LB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(30, throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(30, throttle[RB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(-20, throttle[GUN_1_IN]);
+  TEST_ASSERT_EQUAL_INT8(30, throttle[GUN_2_IN]);
+}
+
+void test_mix_scales_down_instead_of_wrapping(void) {
+  int8_t throttle[NUM_MOTORS];
+
+  // Left wants 200, right 0. Past full, so everything comes down by half
+  robot_core_mix(&core.mixer, throttle, 100, 0, 100, 300, -300);
+  TEST_ASSERT_EQUAL_INT8(-MAX_THROTTLE, throttle[LF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(-MAX_THROTTLE, throttle[LB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(0, throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(0, throttle[RB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(-MAX_THROTTLE, throttle[GUN_1_IN]);
+  TEST_ASSERT_EQUAL_INT8(-MAX_THROTTLE, throttle[GUN_2_IN]);
+
+  robot_core_mix(&core.mixer, throttle, 100, 0, 50, 0, 0);
+  TEST_ASSERT_EQUAL_INT8(-MAX_THROTTLE, throttle[LF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(33, throttle[RF_INDEX]);
+}
+
+void test_mixer_frame_changes_the_chassis(void) {
+  struct proto_drive drive = {0, 25, 0, 0, 0};
+  struct proto_mixer mixer;
+  struct proto_frame frame;
+
+  TEST_ASSERT_EQUAL(0, proto_mixer_layout(&mixer, PROTO_LAYOUT_MECANUM));
+  mixer.scale[RB_INDEX] = 50;
+  proto_pack_mixer(&frame, 0, &mixer);
+  host_send(&frame);
+  proto_pack_drive(&frame, 0, &drive);
+  host_send(&frame);
+  no_limits();
+  run(2 * CONTROL_PERIOD_US);
+
+  // Strafing right, the left motors are mounted mirrored
+  TEST_ASSERT_EQUAL_INT8(-50, core.throttle[LF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(50, core.throttle[LB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(-50, core.throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(25, core.throttle[RB_INDEX]);
+}
+
+void test_extreme_mixer_scales_down_instead_of_overflowing(void) {
+  struct proto_drive drive = {INT8_MAX, INT8_MAX, INT8_MAX, 0, 0};
+  struct proto_mixer mixer;
+  struct proto_frame frame;
+
+  // Every coef as big as it goes, the left motors' scales flipping the sign
+  memset(&mixer, 0, sizeof(mixer));
+  for (int j = 0; j < PROTO_AXES; j++) {
+    mixer.coef[LF_INDEX][j] = INT16_MIN;
+    mixer.coef[LB_INDEX][j] = INT16_MIN;
+  }
+  mixer.scale[LF_INDEX] = INT8_MIN;
+  mixer.scale[LB_INDEX] = INT8_MAX;
+  proto_pack_mixer(&frame, 0, &mixer);
+  host_send(&frame);
+  proto_pack_drive(&frame, 0, &drive);
+  host_send(&frame);
+  no_limits();
+  run(2 * CONTROL_PERIOD_US);
+
+  TEST_ASSERT_EQUAL_INT8(MAX_THROTTLE, core.throttle[LF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(-MAX_THROTTLE * INT8_MAX / -INT8_MIN,
+                         core.throttle[LB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(0, core.throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(0, core.throttle[RB_INDEX]);
+}
+
+void test_convert_default_is_5_12_per_unit(void) {
+  TEST_ASSERT_EQUAL_UINT16(PWM_ZERO, robot_core_convert(&core, 0, 0));
+  TEST_ASSERT_EQUAL_UINT16(PWM_ZERO + 256, robot_core_convert(&core, 0, 50));
+  TEST_ASSERT_EQUAL_UINT16(PWM_ZERO - PWM_SPAN,
+                           robot_core_convert(&core, 0, -100));
+  // Clamped
+  TEST_ASSERT_EQUAL_UINT16(PWM_ZERO + PWM_SPAN,
+                           robot_core_convert(&core, 0, 127));
+  TEST_ASSERT_EQUAL_UINT16(PWM_ZERO - PWM_SPAN,
+                           robot_core_convert(&core, 0, -128));
+}
+
+void test_convert_calibration(void) {
+  struct motor_cal cal[NUM_MOTORS] = {
+      {1500, 40, 440, 10, 1}, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT,
+      MOTOR_CAL_DEFAULT,      MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT};
+
+  robot_core_init(&core, cal, test_wheels);
+  TEST_ASSERT_EQUAL_UINT16(1500, robot_core_convert(&core, 0, 10));
+  TEST_ASSERT_EQUAL_UINT16(1500, robot_core_convert(&core, 0, -10));
+  // Reversed, past the deadband it starts at min
+  TEST_ASSERT_UINT16_WITHIN(5, 1500 - 40, robot_core_convert(&core, 0, 11));
+  TEST_ASSERT_EQUAL_UINT16(1500 - 440, robot_core_convert(&core, 0, 100));
+  TEST_ASSERT_EQUAL_UINT16(1500 + 440, robot_core_convert(&core, 0, -100));
+}
+
+void test_tick_writes_only_changed_channels(void) {
+  no_limits();
+  run(CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT64(NUM_MOTORS, mock.pwm_writes);
+
+  run(10 * CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT64(NUM_MOTORS, mock.pwm_writes);
+
+  // Only the gun changes
+  host_drive(0, 0, 0, 10);
+  run(CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT64(NUM_MOTORS + 1, mock.pwm_writes);
+  TEST_ASSERT_EQUAL_UINT16(robot_core_convert(&core, GUN_2_IN, 20),
+                           mock.duty[GUN_2_IN]);
+}
+
+void test_a_long_tick_is_one_overrun(void) {
+  run(5 * CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT32(0, core.overruns);
+
+  // Runs two periods, so the next tick starts late behind it
+  mock.micros_step = CONTROL_PERIOD_US;
+  robot_core_tick(&core);
+  mock.micros_step = 0;
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(CONTROL_PERIOD_US, core.busy_max_us);
+  run(5 * CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT32(1, core.overruns);
+
+  // Late on its own, the interrupt was held off
+  hal_mock_advance(CONTROL_PERIOD_US + CONTROL_LATE_US);
+  run(5 * CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT32(2, core.overruns);
+}
+
+void test_slew_limits_a_step(void) {
+  struct proto_limits *limits = &core.limits;
+
+  no_limits();
+  limits->slew[RF_INDEX] = 100; // 0.1 a tick
+  host_drive(25, 0, 0, 0);
+  run(100 * CONTROL_PERIOD_US);
+  TEST_ASSERT_INT8_WITHIN(1, 10, core.throttle[RF_INDEX]);
+  run(400 * CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_INT8(50, core.throttle[RF_INDEX]);
+}
+
+void test_failsafe_ramps_down_without_commands(void) {
+  no_limits();
+  host_drive(40, 0, 0, 0);
+  run(core.limits.timeout_ms * 1000);
+  TEST_ASSERT_EQUAL_INT8(80, core.throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_UINT16(0, core.failsafes);
+
+  run((FAILSAFE_RAMP_MS + 10) * 1000);
+  TEST_ASSERT_EQUAL_INT8(0, core.throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_UINT16(1, core.failsafes);
+
+  // A command brings it right back
+  host_drive(40, 0, 0, 0);
+  run(2 * CONTROL_PERIOD_US);
+  TEST_ASSERT_EQUAL_INT8(80, core.throttle[RF_INDEX]);
+}
+
+void test_telemetry_every_period(void) {
+  struct proto_telemetry report;
+  struct proto_frame frame;
+  int reports = 0;
+
+  no_limits();
+  host_drive(10, 0, 0, 0);
+  run(TELEMETRY_PERIOD_US * 5);
+  while (hal_mock_tx_frame(&frame))
+    if (proto_unpack_telemetry(&frame, &report))
+      reports++;
+  TEST_ASSERT_INT_WITHIN(1, 5, reports);
+  TEST_ASSERT_EQUAL_INT8(20, report.throttle[RF_INDEX]);
+  TEST_ASSERT_EQUAL_UINT16(12000, report.supply_mv);
+  TEST_ASSERT_EQUAL_UINT16(CONTROL_PERIOD_US, report.period_us);
+}
+
+void test_pong_after_a_tick(void) {
+  struct proto_ping ping = {77, 123456789};
+  struct proto_frame frame;
+  struct proto_pong pong;
+
+  proto_pack_ping(&frame, 0, &ping);
+  host_send(&frame);
+  robot_core_loop(&core);
+  TEST_ASSERT_FALSE(hal_mock_tx_frame(&frame));
+
+  hal_mock_advance(CONTROL_PERIOD_US);
+  robot_core_tick(&core);
+  robot_core_loop(&core);
+  TEST_ASSERT_TRUE(hal_mock_tx_frame(&frame));
+  TEST_ASSERT_TRUE(proto_unpack_pong(&frame, &pong));
+  TEST_ASSERT_EQUAL_UINT32(77, pong.nonce);
+  TEST_ASSERT_EQUAL_UINT32(core.tick_us, pong.apply_us);
+}
+
+void test_baud_switch_and_revert(void) {
+  struct proto_frame frame;
+  uint32_t rate;
+
+  proto_pack_baud(&frame, PROTO_BAUD, 0, 115200);
+  host_send(&frame);
+  robot_core_loop(&core);
+  TEST_ASSERT_TRUE(hal_mock_tx_frame(&frame));
+  TEST_ASSERT_TRUE(proto_unpack_baud(&frame, PROTO_BAUD_ACK, &rate));
+  TEST_ASSERT_EQUAL_UINT32(115200, rate);
+  TEST_ASSERT_EQUAL_UINT32(115200, mock.baud);
+
+  // Nothing good at the new rate
+  run((BAUD_REVERT_MS + 10) * 1000);
+  TEST_ASSERT_EQUAL_UINT32(BAUD, mock.baud);
+}
+
+void test_velocity_frame_closes_the_loop(void) {
+  host_velocity(500, -300);
+  robot_core_listen(&core);
+
+  TEST_ASSERT_EQUAL(1, core.closed_loop);
+  TEST_ASSERT_EQUAL_INT16(500, core.target_mm_s[WHEEL_LEFT]);
+  TEST_ASSERT_EQUAL_INT16(-300, core.target_mm_s[WHEEL_RIGHT]);
+  TEST_ASSERT_EQUAL(1, core.have_command);
+  TEST_ASSERT_EQUAL(0, mock.irq_depth);
+
+  // A drive frame goes back to raw throttles
+  host_drive(10, 0, 0, 0);
+  robot_core_listen(&core);
+  TEST_ASSERT_EQUAL(0, core.closed_loop);
+}
+
+void test_speed_loop_holds_speed_under_load(void) {
+  no_limits();
+  mock.load = 0.3f;
+  mock.deadband = 0.05f;
+  // Keepalives, a wheel speed every 100 ms
+  for (int i = 0; i < 20; i++) {
+    host_velocity(800, -400);
+    run(100 * 1000);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(20, 800, mock.wheel_mm_s[WHEEL_LEFT]);
+  TEST_ASSERT_FLOAT_WITHIN(20, -400, mock.wheel_mm_s[WHEEL_RIGHT]);
+  // Measured a count at a time, that's 50 mm/s
+  TEST_ASSERT_FLOAT_WITHIN(50, 800, core.speed_mm_s[WHEEL_LEFT]);
+  TEST_ASSERT_FLOAT_WITHIN(50, -400, core.speed_mm_s[WHEEL_RIGHT]);
+  // Both motors on a side get the same throttle
+  TEST_ASSERT_EQUAL_INT8(core.throttle[LF_INDEX], core.throttle[LB_INDEX]);
+  TEST_ASSERT_EQUAL_INT8(core.throttle[RF_INDEX], core.throttle[RB_INDEX]);
+}
+
+void test_speed_in_telemetry(void) {
+  struct proto_telemetry report;
+  struct proto_frame frame;
+
+  no_limits();
+  for (int i = 0; i < 10; i++) {
+    host_drive(25, 0, 0, 0);
+    run(TELEMETRY_PERIOD_US);
+  }
+  while (hal_mock_tx_frame(&frame))
+    proto_unpack_telemetry(&frame, &report);
+  // Half throttle on the mock's plant, no load
+  TEST_ASSERT_INT16_WITHIN(50, MOCK_MAX_MM_S / 2, report.speed[WHEEL_LEFT]);
+  TEST_ASSERT_INT16_WITHIN(50, MOCK_MAX_MM_S / 2, report.speed[WHEEL_RIGHT]);
+}
+
+void test_perf_reports_every_stage(void) {
+  struct proto_frame frame;
+  struct proto_perf perf;
+  uint32_t runs[PROTO_PERF_STAGES] = {0};
+  uint32_t binned;
+  int reports = 0;
+
+  mock.cycle_step = 10;
+  // Just past a report for each, they go out a pass after they're due
+  for (int i = 0; i < PROTO_PERF_STAGES * 2 + 1; i++) {
+    host_drive(10, 0, 0, 0);
+    run(PERF_PERIOD_US / 2);
+  }
+  while (hal_mock_tx_frame(&frame)) {
+    if (!proto_unpack_perf(&frame, &perf))
+      continue;
+    // Round robin, one stage a report
+    TEST_ASSERT_EQUAL_UINT8(reports % PROTO_PERF_STAGES, perf.stage);
+    TEST_ASSERT_EQUAL_UINT16(MOCK_CYCLES_PER_US, perf.mhz);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(perf.mean_cycles, perf.min_cycles);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(perf.max_cycles, perf.mean_cycles);
+    binned = 0;
+    for (int i = 0; i < PROTO_PERF_BUCKETS; i++)
+      binned += perf.hist[i];
+    TEST_ASSERT_EQUAL_UINT32(perf.count, binned);
+    runs[perf.stage] = perf.count;
+    reports++;
+  }
+  TEST_ASSERT_EQUAL(PROTO_PERF_STAGES, reports);
+  for (int i = 0; i < PROTO_PERF_STAGES; i++)
+    TEST_ASSERT_NOT_EQUAL(0, runs[i]);
+  // A drive frame at a time
+  TEST_ASSERT_EQUAL_UINT16(PROTO_DRIVE_SIZE + PROTO_HEADER_SIZE +
+                               PROTO_CRC_SIZE + 2,
+                           core.rx_peak);
+  TEST_ASSERT_EQUAL(0, mock.irq_depth);
+}
+
+void test_perf_waits_for_a_quiet_pass(void) {
+  struct proto_telemetry report;
+  struct proto_frame frame;
+  struct proto_perf perf;
+
+  run(PERF_PERIOD_US);
+  while (hal_mock_tx_frame(&frame))
+    ;
+
+  // A report and the first perf are both due, the report goes first
+  robot_core_loop(&core);
+  TEST_ASSERT_TRUE(hal_mock_tx_frame(&frame));
+  TEST_ASSERT_TRUE(proto_unpack_telemetry(&frame, &report));
+  TEST_ASSERT_FALSE(hal_mock_tx_frame(&frame));
+
+  hal_mock_advance(CONTROL_PERIOD_US);
+  robot_core_tick(&core);
+  robot_core_loop(&core);
+  TEST_ASSERT_TRUE(hal_mock_tx_frame(&frame));
+  TEST_ASSERT_TRUE(proto_unpack_perf(&frame, &perf));
+  TEST_ASSERT_EQUAL_UINT8(PROTO_PERF_LOOP, perf.stage);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_drive_frame_sets_the_command);
+  RUN_TEST(test_partial_frame_waits_for_the_rest);
+  RUN_TEST(test_corrupted_frame_is_dropped);
+  RUN_TEST(test_stop_frame_stops);
+  RUN_TEST(test_limits_frame_replaces_the_limits);
+  RUN_TEST(test_mix_is_a_tank_mix);
+  RUN_TEST(test_mix_scales_down_instead_of_wrapping);
+  RUN_TEST(test_mixer_frame_changes_the_chassis);
+  RUN_TEST(test_extreme_mixer_scales_down_instead_of_overflowing);
+  RUN_TEST(test_convert_default_is_5_12_per_unit);
+  RUN_TEST(test_convert_calibration);
+  RUN_TEST(test_tick_writes_only_changed_channels);
+  RUN_TEST(test_a_long_tick_is_one_overrun);
+  RUN_TEST(test_slew_limits_a_step);
+  RUN_TEST(test_failsafe_ramps_down_without_commands);
+  RUN_TEST(test_telemetry_every_period);
+  RUN_TEST(test_pong_after_a_tick);
+  RUN_TEST(test_baud_switch_and_revert);
+  RUN_TEST(test_velocity_frame_closes_the_loop);
+  RUN_TEST(test_speed_loop_holds_speed_under_load);
+  RUN_TEST(test_speed_in_telemetry);
+  RUN_TEST(test_perf_reports_every_stage);
+  RUN_TEST(test_perf_waits_for_a_quiet_pass);
+  return UNITY_END();
+}
@@ -0,0 +1,202 @@
+/**
+ * @file        : bench
+ * @brief Times the firmware's parser, mixer and control tick on the host
+ *
+ * Runs teensy/lib/robot_core against the mocked board (hal_mock) and counts
+ * cycles (the TSC on x86, nanoseconds elsewhere) per frame parsed, per mix
+ * and per control tick. These aren't teensy cycles, but a change that makes
+ * the core slower here almost always makes it slower there, so run it before
+ * and after.
+ *
+ * -s runs a wheel speed step on the mock's plant instead, with the default
+ * speed pid, and logs how it settles. That's where the gains get tuned.
+ *
+ * $ ./firmware-bench -n 20000
+ * $ ./firmware-bench -s 800 -l 0.3
+ *
+ * @created     : Sunday Oct 18, 2026 17:04:24 MDT
+ * @bugs        No known bugs
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal_mock.h"
+#include "log.h"
+#include "periodic.h"
+#include "robot_core.h"
+#include "stats.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static uint64_t cycles() { return __rdtsc(); }
+#else
+#define BENCH_UNIT "ns"
+static uint64_t cycles() { return monotonic_ns(); }
+#endif
+
+#define BENCH_FRAMES 64 // Frames parsed per sample
+#define BENCH_MIXES 256 // Mixes per sample
+#define BENCH_TICKS 64  // Ticks per sample
+#define STEP_MS 3000    // How long a speed step runs
+
+static const struct motor_cal cal[NUM_MOTORS] = {
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT,
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT};
+static const struct wheel_cal wheels[NUM_WHEELS] = {WHEEL_CAL_DEFAULT,
+                                                    WHEEL_CAL_DEFAULT};
+
+void usage(const char *name) {
+  printf("Usage: %s [-n samples] [-s mm_s] [-l load] [-h]\n"
+         "  -n  Samples of each (default 10000)\n"
+         "  -s  Speed step to mm_s on the plant instead\n"
+         "  -l  Fraction of speed the plant's load takes (default 0)\n"
+         "  -h  Show this message\n",
+         name);
+}
+
+// Both wheels from 0 to target in closed loop, rise is to 90%
+int speed_step(int16_t target, float load) {
+  static struct robot_core core;
+  struct wheel_cal plant_wheels[NUM_WHEELS] = {WHEEL_CAL_DEFAULT,
+                                               WHEEL_CAL_DEFAULT};
+  struct running_stats error;
+  float speed, peak = 0;
+  long rise_ms = -1;
+  int i, t;
+
+  hal_mock_reset();
+  mock.load = load;
+  for (i = 0; i < NUM_WHEELS; i++)
+    plant_wheels[i].mm_per_count = mock.mm_per_count;
+  robot_core_init(&core, cal, plant_wheels);
+  for (i = 0; i < NUM_MOTORS; i++)
+    core.limits.slew[i] = 0;
+  core.target_mm_s[WHEEL_LEFT] = core.target_mm_s[WHEEL_RIGHT] = target;
+  core.closed_loop = 1;
+  stats_reset(&error);
+
+  for (t = 0; t < STEP_MS; t++) {
+    for (i = 0; i < 1000 / CONTROL_PERIOD_US; i++) {
+      hal_mock_advance(CONTROL_PERIOD_US);
+      robot_core_tick(&core);
+    }
+    speed = mock.wheel_mm_s[WHEEL_RIGHT];
+    if (speed > peak)
+      peak = speed;
+    if (rise_ms < 0 && speed >= 0.9f * target)
+      rise_ms = t;
+    // The last second is steady state
+    if (t >= STEP_MS - 1000)
+      stats_add(&error, lroundf(speed - target));
+  }
+
+  log_info("Speed step to %d mm/s, load %.2f: rise %ld ms, overshoot %.1f "
+           "mm/s, steady state error %.1f mm/s (jitter %.1f)",
+           target, load, rise_ms, peak - target, error.mean,
+           stats_stddev(&error));
+  return 0;
+}
+
+// BENCH_FRAMES drive frames back to back, like a busy link
+size_t drive_stream(uint8_t *out) {
+  struct proto_drive drive = {0, 0, 0, 0, 0};
+  struct proto_frame frame;
+  size_t len = 0;
+  int i;
+
+  for (i = 0; i < BENCH_FRAMES; ++i) {
+    drive.vx = i % 50;
+    drive.vy = i % 7;
+    drive.omega = 25 - i % 50;
+    proto_pack_drive(&frame, i, &drive);
+    len += proto_encode(&frame, out + len);
+  }
+  return len;
+}
+
+void log_sample(const struct running_stats *stats, const char *desc) {
+  log_info("%s: min %.0f mean %.1f max %.0f " BENCH_UNIT ", jitter %.1f",
+           desc, (double)stats->min, stats->mean, (double)stats->max,
+           stats_stddev(stats));
+}
+
+int main(int argc, char **argv) {
+  static struct robot_core core;
+  static uint8_t stream[BENCH_FRAMES * PROTO_MAX_ENCODED];
+  struct running_stats parse, mix, tick;
+  int8_t throttle[NUM_MOTORS];
+  volatile int8_t sink = 0;
+  size_t stream_len;
+  uint64_t start;
+  long samples = 10000;
+  long n;
+  int i, opt;
+  int16_t step = 0;
+  float load = 0;
+
+  while ((opt = getopt(argc, argv, "n:s:l:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      samples = atol(optarg);
+      break;
+    case 's':
+      step = atoi(optarg);
+      break;
+    case 'l':
+      load = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (samples <= 0 || step < 0 || load < 0 || load >= 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (step)
+    return speed_step(step, load);
+
+  hal_mock_reset();
+  robot_core_init(&core, cal, wheels);
+  stream_len = drive_stream(stream);
+  stats_reset(&parse);
+  stats_reset(&mix);
+  stats_reset(&tick);
+
+  for (n = 0; n < samples; ++n) {
+    hal_mock_rx(stream, stream_len);
+    start = cycles();
+    robot_core_listen(&core);
+    stats_add(&parse, (cycles() - start) / BENCH_FRAMES);
+
+    start = cycles();
+    for (i = 0; i < BENCH_MIXES; ++i) {
+      robot_core_mix(&core.mixer, throttle, i, i & 7, n, i >> 1, -i);
+      sink += throttle[i % NUM_MOTORS];
+    }
+    stats_add(&mix, (cycles() - start) / BENCH_MIXES);
+
+    // The command keeps moving so the profile and the pwm writes have work
+    core.vx = n % 100 - 50;
+    start = cycles();
+    for (i = 0; i < BENCH_TICKS; ++i) {
+      hal_mock_advance(CONTROL_PERIOD_US);
+      robot_core_tick(&core);
+    }
+    stats_add(&tick, (cycles() - start) / BENCH_TICKS);
+  }
+
+  log_info("Firmware bench: %ld samples, %llu frames parsed, %llu pwm "
+           "writes",
+           samples, (unsigned long long)core.decoder.frames,
+           (unsigned long long)mock.pwm_writes);
+  log_sample(&parse, "Parse, per frame");
+  log_sample(&mix, "Mix");
+  log_sample(&tick, "Control tick");
+  return 0;
+}
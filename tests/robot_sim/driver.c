@@ -0,0 +1,378 @@
+/**
+ * @file        : driver
+ * @brief Drives robot-sim through a script and scores the path it took
+ *
+ * The real host, minus the wiimote: kermit's drive train with the drive mode
+ * asked for, the real serial thread scanning for SIM_PREFIX, and this thread
+ * standing in for the wii thread. It holds the d-pad the way someone would to
+ * follow the script (see steer) and every pose the sim sends back is compared
+ * to where the script says the robot should be by then, so the score counts
+ * everything between the thumb and the ground: the drive mode, the serial
+ * path's latency, the firmware's motion profile and the robot itself.
+ *
+ * A script is seconds:lin:ang segments, lin and ang in drive train units
+ * (kermit goes to 10). The ideal robot does each segment's speeds the moment
+ * it starts, at SIM_FREE_MM_S for full throttle (or at -V's wheel speed).
+ *
+ * $ ./robot-sim &
+ * $ ./sim-driver -m var
+ * $ ./sim-driver -m var,nonlin
+ * $ ./sim-driver -m disclinang -s 2:4:0,1:0:4,2:4:0
+ * $ ./sim-driver -m var -V 1500
+ *
+ * @created     : Sunday Oct 18, 2026 17:29:08 MDT
+ * @bugs        No known bugs
+ */
+
+#define _GNU_SOURCE
+#include "utils.h"
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+
+#include "robot_sim.h"
+
+#define DRIVER_MAX_SEGMENTS 32
+#define DRIVER_POSE_WAIT_MS 3000 // For the first pose, the sim is up by then
+#define DRIVER_SCRIPT "2:10:0,0.8:0:5,2:10:0,1:0:0"
+#define DRIVER_FULL_THROTTLE 100 // Full scale on the wire, see protocol.h
+
+////////// Data Structures //////////
+
+/**
+ * @seconds How long it lasts
+ * @lin     Linear velocity wanted, drive train units
+ * @ang     Angular velocity wanted, clockwise
+ */
+struct segment {
+  double seconds;
+  int lin;
+  int ang;
+};
+
+/**
+ * @x_mm    Forward from the start
+ * @y_mm    Left from the start
+ * @heading Counterclockwise from the start, rad
+ */
+struct pose {
+  double x_mm;
+  double y_mm;
+  double heading;
+};
+
+/**
+ * @position     Distance off the ideal path at each pose, mm
+ * @heading      Heading off the ideal at each pose, millidegrees
+ * @position_sq  Sum of position squared, for the rms
+ * @final_mm     Distance off at the last pose
+ */
+struct score {
+  struct running_stats position;
+  struct running_stats heading;
+  double position_sq;
+  double final_mm;
+};
+
+void usage(const char *name) {
+  printf("Usage: %s [-m modes] [-s script] [-V mm_s] [-i hz] [-e seconds]\n"
+         "       [-p seconds] [-h]\n"
+         "  -m  Drive modes, comma separated: var, nonlin, disclinang, or\n"
+         "      none for discrete (default var, like wii-controller-c)\n"
+         "  -s  seconds:lin:ang,... (default " DRIVER_SCRIPT ")\n"
+         "  -V  Command wheel speeds, full stick is mm_s\n"
+         "  -i  D-pad polls a second (default 100, the wii loop's)\n"
+         "  -e  Seconds to keep scoring after the script (default 1)\n"
+         "  -p  Seconds between latency probes, 0 for none (default 1)\n"
+         "  -h  Show this message\n",
+         name);
+}
+
+// Robot options out of -m, -1 for one we don't know
+int parse_modes(const char *arg) {
+  char buf[64];
+  char *tok, *save;
+  int options = 0;
+
+  strncpy(buf, arg, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+    if (!strcmp(tok, "var"))
+      options |= VAR_SPEED;
+    else if (!strcmp(tok, "nonlin"))
+      options |= NONLIN;
+    else if (!strcmp(tok, "disclinang"))
+      options |= DISCLINANG;
+    else if (strcmp(tok, "none"))
+      return -1;
+  }
+  return options;
+}
+
+// Segments out of -s, -1 if it doesn't parse
+int parse_script(const char *arg, struct segment *script) {
+  const char *at = arg;
+  int n = 0;
+  int used;
+
+  while (*at) {
+    if (n == DRIVER_MAX_SEGMENTS ||
+        sscanf(at, "%lf:%d:%d%n", &script[n].seconds, &script[n].lin,
+               &script[n].ang, &used) != 3 ||
+        script[n].seconds <= 0)
+      return -1;
+    at += used;
+    n++;
+    if (*at == ',')
+      at++;
+    else if (*at)
+      return -1;
+  }
+  return n ? n : -1;
+}
+
+// What a command does to one side on the ideal robot, mm/s. The same sums
+// write_to_serial and the teensy do, both double a drive frame's values
+static double ideal_side(int side) {
+  if (wheel_speed && full_command)
+    return constrain(-wheel_speed, side * wheel_speed / full_command,
+                     wheel_speed);
+  return constrain(-DRIVER_FULL_THROTTLE, 4 * side, DRIVER_FULL_THROTTLE) *
+         (double)SIM_FREE_MM_S / DRIVER_FULL_THROTTLE;
+}
+
+// Where the ideal robot is t seconds into the script, each segment is an arc
+void ideal_pose(const struct segment *script, int n, double t,
+                struct pose *pose) {
+  double left, right, v, omega, dt;
+  int i;
+
+  memset(pose, 0, sizeof(*pose));
+  for (i = 0; i < n && t > 0; t -= script[i++].seconds) {
+    dt = t < script[i].seconds ? t : script[i].seconds;
+    left = ideal_side(script[i].lin + script[i].ang);
+    right = ideal_side(script[i].lin - script[i].ang);
+    v = (left + right) / 2;
+    omega = (right - left) / SIM_TRACK_MM;
+    if (fabs(omega) < 1e-9) {
+      pose->x_mm += v * cos(pose->heading) * dt;
+      pose->y_mm += v * sin(pose->heading) * dt;
+    } else {
+      pose->x_mm += v / omega *
+                    (sin(pose->heading + omega * dt) - sin(pose->heading));
+      pose->y_mm -= v / omega *
+                    (cos(pose->heading + omega * dt) - cos(pose->heading));
+    }
+    pose->heading += omega * dt;
+  }
+}
+
+// The sim's pose, moved so start is the origin
+void relative_pose(const struct proto_pose *start,
+                   const struct proto_pose *now, struct pose *pose) {
+  double th = start->heading_mrad / 1000.0;
+  double dx = now->x_mm - start->x_mm;
+  double dy = now->y_mm - start->y_mm;
+
+  pose->x_mm = dx * cos(th) + dy * sin(th);
+  pose->y_mm = -dx * sin(th) + dy * cos(th);
+  pose->heading = remainder((now->heading_mrad - start->heading_mrad) / 1000.0,
+                            2 * M_PI);
+}
+
+/**
+ * @brief Works the d-pad toward the segment's velocities, once per poll
+ * @note Like a driver would: press toward a velocity until it's there, let go
+ * of an axis that should be 0 in discrete mode (pressing the other one zeroes
+ * it) and press b to stop. Up / down go before left / right, the same order
+ * execute_callbacks calls them in
+ *
+ * @param robot The robot
+ * @param lin Linear velocity wanted
+ * @param ang Angular velocity wanted
+ */
+void steer(struct robot_s *robot, int lin, int ang) {
+  struct drive_train *dt = robot->drive;
+  int var = robot->options & VAR_SPEED;
+
+  if (!lin && !ang) {
+    if (dt->linear_vel || dt->angular_vel)
+      (*dt->p->stop)(robot);
+    return;
+  }
+  if (lin != dt->linear_vel && (lin || var))
+    dt->on_vel_callback(robot, 0, lin > dt->linear_vel ? 1 : -1);
+  if (ang != dt->angular_vel && (ang || var))
+    dt->on_vel_callback(robot, ang > dt->angular_vel ? 1 : -1, 0);
+}
+
+void score_pose(struct score *score, const struct pose *ideal,
+                const struct pose *actual) {
+  double off = hypot(actual->x_mm - ideal->x_mm, actual->y_mm - ideal->y_mm);
+  double heading = remainder(actual->heading - ideal->heading, 2 * M_PI);
+
+  stats_add(&score->position, llround(off));
+  stats_add(&score->heading, llround(fabs(heading) * 180e3 / M_PI));
+  score->position_sq += off * off;
+  score->final_mm = off;
+}
+
+void score_log(const struct score *score, const char *modes) {
+  if (!score->position.count) {
+    log_warn("No poses came back, nothing to score");
+    return;
+  }
+  log_info("Trajectory error (%s): rms %.0f mm, max %lld mm, final %.0f mm "
+           "over %llu poses",
+           modes, sqrt(score->position_sq / score->position.count),
+           (long long)score->position.max, score->final_mm,
+           (unsigned long long)score->position.count);
+  log_info("Heading error (%s): mean %.1f deg, max %.1f deg", modes,
+           score->heading.mean / 1000, score->heading.max / 1000.0);
+}
+
+// The first pose, so the script starts wherever the robot is
+int wait_pose(struct proto_pose *start) {
+  int waited;
+
+  for (waited = 0; waited < DRIVER_POSE_WAIT_MS && running; waited += 10) {
+    take_telemetry();
+    if (robot_main.telemetry.pose_ns) {
+      *start = robot_main.telemetry.pose;
+      return 0;
+    }
+    if (!shutdown_sleep(10))
+      break;
+  }
+  log_error("No pose from %s, is robot-sim running?", SIM_PORT);
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  static struct segment script[DRIVER_MAX_SEGMENTS];
+  struct periodic_task input;
+  struct robot_command command;
+  struct proto_pose start;
+  struct pose ideal, actual;
+  struct score score;
+  pthread_t serial_thread_t;
+  const char *modes = "var";
+  const char *script_arg = DRIVER_SCRIPT;
+  double input_rate = 100;
+  double extra = 1;
+  double length = 0, t;
+  int64_t start_ns, last_pose_ns = 0;
+  int options, segments, seg, opt;
+
+  probe_period = PROBE_PERIOD;
+  max_baud = 0;
+  memset(&port_match, 0, sizeof(port_match));
+  rt_profile = create_rt_config();
+  proto_mixer_layout(&drive_mixer, PROTO_LAYOUT_DIFF);
+  send_config = CONFIG_MIXER;
+  wheel_speed = 0;
+
+  while ((opt = getopt(argc, argv, "m:s:V:i:e:p:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      modes = optarg;
+      break;
+    case 's':
+      script_arg = optarg;
+      break;
+    case 'V':
+      wheel_speed = atoi(optarg);
+      break;
+    case 'i':
+      input_rate = atof(optarg);
+      break;
+    case 'e':
+      extra = atof(optarg);
+      break;
+    case 'p':
+      probe_period = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  options = parse_modes(modes);
+  segments = parse_script(script_arg, script);
+  if (options < 0 || segments < 0 || input_rate <= 0 || extra < 0 ||
+      wheel_speed < 0 || wheel_speed > INT16_MAX) {
+    usage(argv[0]);
+    return 1;
+  }
+  for (seg = 0; seg < segments; seg++)
+    length += script[seg].seconds;
+
+  // What main's init_state_system and init_buffers do
+  scan_signal = 0;
+  running = 1;
+  caught_signal = 0;
+  if (init_events())
+    return 1;
+  signal(SIGINT, signal_handler);
+  signal(SIGTERM, signal_handler);
+  robot_main = kermit_robot();
+  robot_main.options = options;
+  full_command = robot_main.drive->max_speed;
+  command = robot_get_command(&robot_main);
+  triple_buffer_init(&command_buffer, command_slots, sizeof(command), &command);
+  triple_buffer_init(&telemetry_buffer, telemetry_slots,
+                     sizeof(robot_main.telemetry), &robot_main.telemetry);
+  stats_reset(&score.position);
+  stats_reset(&score.heading);
+  score.position_sq = score.final_mm = 0;
+
+  char const *prefixes[1] = {SIM_PREFIX};
+  struct port_context p_cont = {prefixes, 1, 9600, 1, &port_match};
+
+  thread_creator(&serial_thread_t, &p_cont, "Serial Communication",
+                 serial_thread);
+
+  // Stands in for the wii thread
+  wait_event(serial_ready_event, -1);
+  signal_event(wii_ready_event);
+  if (wait_pose(&start) || periodic_init(&input, 1 / input_rate)) {
+    request_shutdown();
+    thread_joiner(&serial_thread_t, "Serial Communication thread");
+    close_events();
+    return 1;
+  }
+  start_ns = monotonic_ns();
+  while (running) {
+    t = (monotonic_ns() - start_ns) / 1e9;
+    if (t >= length + extra)
+      break;
+    for (seg = 0; seg < segments && t >= script[seg].seconds;
+         t -= script[seg++].seconds)
+      ;
+    if (seg < segments)
+      steer(&robot_main, script[seg].lin, script[seg].ang);
+    else
+      steer(&robot_main, 0, 0);
+    publish_command(1);
+
+    take_telemetry();
+    if (robot_main.telemetry.pose_ns != last_pose_ns) {
+      last_pose_ns = robot_main.telemetry.pose_ns;
+      ideal_pose(script, segments, (last_pose_ns - start_ns) / 1e9, &ideal);
+      relative_pose(&start, &robot_main.telemetry.pose, &actual);
+      score_pose(&score, &ideal, &actual);
+    }
+    if (periodic_wait(&input, shutdown_event) <= 0)
+      break;
+  }
+  periodic_log_stats(&input, "Input loop");
+  periodic_close(&input);
+  request_shutdown();
+  thread_joiner(&serial_thread_t, "Serial Communication thread");
+
+  stats_log_ns(&input_latency, "Input to serial latency");
+  score_log(&score, modes);
+  close_events();
+  robot_clean_up(&robot_main);
+  return 0;
+}
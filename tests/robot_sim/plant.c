@@ -0,0 +1,135 @@
+/**
+ * @file        : plant
+ * @created     : Sunday Oct 18, 2026 17:29:08 MDT
+ */
+
+#include "plant.h"
+#include "robot_sim.h"
+
+#include <math.h>
+#include <string.h>
+
+// Which side each motor is on and which way round it's mounted, the same as
+// the default mixer (PROTO_LAYOUT_DIFF)
+static const int motor_side[PLANT_MOTORS] = {WHEEL_LEFT, WHEEL_LEFT,
+                                             WHEEL_RIGHT, WHEEL_RIGHT};
+static const int motor_sign[PLANT_MOTORS] = {-1, -1, 1, 1};
+
+// Body speeds under this are treated as rolling resistance ramping in, so a
+// robot at rest doesn't chatter back and forth
+#define PLANT_CREEP_M_S 0.01f
+// A tire sliding faster than this counts as slipping
+#define PLANT_SLIP_M_S 0.05f
+
+static float clampf(float lo, float val, float hi) {
+  return val < lo ? lo : val > hi ? hi : val;
+}
+
+void plant_params_default(struct plant_params *params) {
+  params->mass_kg = 12;
+  params->inertia_kgm2 = 0.35f;
+  params->track_m = SIM_TRACK_MM / 1000.0f;
+  params->wheel_mass_kg = 0.3f;
+  params->free_m_s = SIM_FREE_MM_S / 1000.0f;
+  params->stall_n = 50;
+  params->stall_a = 40;
+  params->v_nominal = 12;
+  params->deadband = 0.05f;
+  params->mu = 0.8f;
+  params->slip_n_s = 800;
+  params->rolling = 0.02f;
+  params->scrub_nm_s = 2;
+  params->v_full = 12.6f;
+  params->v_empty = 11.0f;
+  params->capacity_ah = 3;
+  params->r_internal = 0.03f;
+  params->mm_per_count = 0.23f;
+}
+
+void plant_init(struct plant *plant, const struct plant_params *params) {
+  memset(plant, 0, sizeof(*plant));
+  plant->params = *params;
+  plant->volts = plant->min_volts = params->v_full;
+}
+
+// The motor's push at the tread, and the battery current it draws through
+// its esc
+static float motor(const struct plant *plant, uint16_t duty, int i,
+                   float *supply_a) {
+  const struct plant_params *p = &plant->params;
+  float throttle = 0;
+  float force;
+
+  if (duty)
+    throttle = clampf(-1, motor_sign[i] * ((int)duty - PWM_ZERO) /
+                              (float)PWM_SPAN, 1);
+  if (fabsf(throttle) < p->deadband)
+    throttle = 0;
+  // An esc at 0 shorts the motor, so it brakes off its back emf
+  force = p->stall_n * (throttle * plant->volts / p->v_nominal -
+                        plant->wheel_m_s[i] / p->free_m_s);
+  // The esc chops the battery, so the battery sees throttle of the current
+  *supply_a = throttle * p->stall_a * force / p->stall_n;
+  return force;
+}
+
+void plant_step(struct plant *plant, const uint16_t duty[PLANT_MOTORS],
+                float dt) {
+  const struct plant_params *p = &plant->params;
+  float grip = p->mu * p->mass_kg * PLANT_G / PLANT_MOTORS;
+  float ground[NUM_WHEELS];
+  float push = 0, turn = 0, current = 0;
+  float supply_a, slip;
+  double heading;
+  float ocv;
+  int slipping = 0;
+  int i;
+
+  // Each side's tread speed if nothing slid
+  ground[WHEEL_LEFT] = plant->v_m_s - plant->omega * p->track_m / 2;
+  ground[WHEEL_RIGHT] = plant->v_m_s + plant->omega * p->track_m / 2;
+
+  for (i = 0; i < PLANT_MOTORS; i++) {
+    int side = motor_side[i];
+    float drive = motor(plant, duty[i], i, &supply_a);
+
+    slip = plant->wheel_m_s[i] - ground[side];
+    plant->force_n[i] = clampf(-grip, p->slip_n_s * slip, grip);
+    if (fabsf(slip) > PLANT_SLIP_M_S)
+      slipping = 1;
+    plant->wheel_m_s[i] += (drive - plant->force_n[i]) / p->wheel_mass_kg * dt;
+    current += supply_a;
+
+    push += plant->force_n[i];
+    turn += plant->force_n[i] * (side == WHEEL_RIGHT ? 1 : -1) * p->track_m / 2;
+    plant->side_m[side] += plant->wheel_m_s[i] / 2 * dt;
+  }
+
+  push -= p->rolling * p->mass_kg * PLANT_G *
+          clampf(-1, plant->v_m_s / PLANT_CREEP_M_S, 1);
+  turn -= p->scrub_nm_s * plant->omega;
+  plant->v_m_s += push / p->mass_kg * dt;
+  plant->omega += turn / p->inertia_kgm2 * dt;
+
+  // Midpoint heading, good enough at this step
+  heading = plant->heading + plant->omega * dt / 2;
+  plant->x_m += plant->v_m_s * cos(heading) * dt;
+  plant->y_m += plant->v_m_s * sin(heading) * dt;
+  plant->heading += plant->omega * dt;
+
+  // Braking pushes current back, the battery only ever sags here
+  if (current < 0)
+    current = 0;
+  plant->used_ah += current * dt / 3600;
+  ocv = p->v_full - (p->v_full - p->v_empty) * plant->used_ah / p->capacity_ah;
+  plant->current_a = current;
+  plant->volts = fmaxf(ocv - current * p->r_internal, 0);
+  if (plant->volts < plant->min_volts)
+    plant->min_volts = plant->volts;
+  if (current > plant->peak_a)
+    plant->peak_a = current;
+
+  plant->time_s += dt;
+  if (slipping)
+    plant->slip_s += dt;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file        : plant
+ * @brief A tank chassis on the ground, driven by the duties the firmware writes
+ *
+ * Four brushed motors, one per wheel, LF and LB on the left mounted mirrored
+ * like the default mixer has them. Each esc turns its duty into a voltage off
+ * the battery (nothing inside its deadband), each motor is a straight line
+ * torque speed curve at that voltage, and each wheel pushes on the ground
+ * through a tire that grips up to mu of its share of the weight and slides
+ * past that. The battery is an open circuit voltage that drops as it's used
+ * behind an internal resistance, so a hard launch sags it. The body is a
+ * point mass with a moment of inertia, integrated in the plane with no
+ * sideways slip, plus rolling resistance and the scrub a skid steer fights
+ * when it turns.
+ *
+ * Everything in here is SI (m, s, kg, N, V, A) except where a name says so.
+ * The step has to stay well under the tires' time constant (wheel_mass_kg /
+ * slip_n_s), PLANT_STEP_US is.
+ *
+ * @created     : Sunday Oct 18, 2026 17:29:08 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef PLANT_H
+
+#define PLANT_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+#include "robot_core.h"
+
+#define PLANT_MOTORS 4 // The drive motors, LF LB RF RB like the firmware's
+#define PLANT_STEP_US 100
+#define PLANT_G 9.81f
+
+////////// Data Structures //////////
+
+/**
+ * What the robot is made of, plant_params_default fills in something like
+ * kermit
+ *
+ * @mass_kg       The whole robot
+ * @inertia_kgm2  About the vertical axis
+ * @track_m       Between the left and right wheels
+ * @wheel_mass_kg A wheel plus its motor and gearbox, as a mass at the tread
+ * @free_m_s      Tread speed at v_nominal with no load
+ * @stall_n       Tread force at v_nominal, stalled
+ * @stall_a       Motor current at v_nominal, stalled
+ * @v_nominal     The voltage the motor numbers are at
+ * @deadband      Throttles under this fraction of full don't drive the motor
+ * @mu            Tire to ground friction
+ * @slip_n_s      Tire force per m/s of tread sliding over the ground, until mu
+ * runs out
+ * @rolling       Rolling resistance, fraction of the weight
+ * @scrub_nm_s    Turning drag, N m per rad/s
+ * @v_full        Battery open circuit voltage charged
+ * @v_empty       Battery open circuit voltage flat
+ * @capacity_ah   Battery capacity
+ * @r_internal    Battery internal resistance, ohms
+ * @mm_per_count  Encoder resolution at the tread
+ */
+struct plant_params {
+  float mass_kg;
+  float inertia_kgm2;
+  float track_m;
+  float wheel_mass_kg;
+  float free_m_s;
+  float stall_n;
+  float stall_a;
+  float v_nominal;
+  float deadband;
+  float mu;
+  float slip_n_s;
+  float rolling;
+  float scrub_nm_s;
+  float v_full;
+  float v_empty;
+  float capacity_ah;
+  float r_internal;
+  float mm_per_count;
+};
+
+/**
+ * The robot right now
+ *
+ * @params     What it's made of
+ * @wheel_m_s  Each wheel's tread speed, forward is positive
+ * @force_n    Each tire's push on the ground last step
+ * @v_m_s      Body speed, forward
+ * @omega      Body turn rate, counterclockwise, rad/s
+ * @x_m        Forward from where it started
+ * @y_m        Left from where it started
+ * @heading    Counterclockwise from where it started, rad, not wrapped
+ * @side_m     How far each side's tread has gone (left, right), what the
+ * encoders see, the average of its two wheels
+ * @used_ah    Charge taken out of the battery
+ * @current_a  Battery current last step
+ * @volts      Battery voltage last step
+ * @time_s     Time simulated
+ * @slip_s     Time any tire spent sliding
+ * @min_volts  Lowest battery voltage
+ * @peak_a     Highest battery current
+ */
+struct plant {
+  struct plant_params params;
+  float wheel_m_s[PLANT_MOTORS];
+  float force_n[PLANT_MOTORS];
+  float v_m_s;
+  float omega;
+  double x_m;
+  double y_m;
+  double heading;
+  double side_m[NUM_WHEELS];
+  double used_ah;
+  float current_a;
+  float volts;
+  double time_s;
+  double slip_s;
+  float min_volts;
+  float peak_a;
+};
+
+/**
+ * @brief Fills in a 12 kg tank on a 12 V battery, about 2 m/s flat out like
+ * hal_mock's plant
+ *
+ * @param params The params
+ */
+void plant_params_default(struct plant_params *params);
+
+/**
+ * @brief Puts a robot at rest at the origin on a charged battery
+ *
+ * @param plant The plant
+ * @param params What it's made of
+ */
+void plant_init(struct plant *plant, const struct plant_params *params);
+
+/**
+ * @brief Moves the robot one step
+ *
+ * @param plant The plant
+ * @param duty The last duty written to each drive motor, 0 for never (the esc
+ * hasn't armed)
+ * @param dt Seconds, PLANT_STEP_US or so
+ */
+void plant_step(struct plant *plant, const uint16_t duty[PLANT_MOTORS],
+                float dt);
+
+#endif /* end of include guard PLANT_H */
@@ -0,0 +1,25 @@
+/**
+ * @file        : robot_sim
+ * @brief What robot-sim and sim-driver agree on
+ *
+ * @created     : Sunday Oct 18, 2026 17:29:08 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef ROBOT_SIM_H
+
+#define ROBOT_SIM_H
+
+// Where the sim's pty shows up, the driver scans for the prefix like the
+// host scans for /dev/ttyUSB
+#define SIM_PREFIX "/tmp/robot-sim"
+#define SIM_PORT SIM_PREFIX "0"
+
+// A PROTO_POSE this often, fast enough to see a turn start
+#define SIM_POSE_MS 20
+
+// The default robot, what the driver's ideal path is worked out from
+#define SIM_FREE_MM_S 2000 // Flat out on a 12 V battery, like hal_mock's plant
+#define SIM_TRACK_MM 400   // Left wheels to right wheels
+
+#endif /* end of include guard ROBOT_SIM_H */
@@ -0,0 +1,318 @@
+/**
+ * @file        : sim
+ * @brief A simulated robot on a pty, the firmware driving a plant
+ *
+ * Makes a pty, links its slave to SIM_PORT and runs the firmware's own
+ * robot_core on hal_mock behind it, in real time: a control tick every
+ * millisecond, with the plant (plant.h) stepped every PLANT_STEP_US off the
+ * duties the tick wrote. The plant drives the encoders and the supply
+ * voltage the firmware reads back, so velocity frames close their loop
+ * through it and the telemetry is what the real robot would send. On top of
+ * that the sim sends a PROTO_POSE every SIM_POSE_MS with where the robot
+ * actually is, which the host's telemetry reader hands to the wii thread.
+ *
+ * Anything that speaks the protocol can drive it, sim-driver runs the real
+ * host serial thread and drive modes against it and scores the path:
+ *
+ * $ ./robot-sim -o run.csv &
+ * $ ./sim-driver -m var
+ *
+ * @created     : Sunday Oct 18, 2026 17:29:08 MDT
+ * @bugs        No known bugs
+ */
+
+#define _GNU_SOURCE // posix_openpt and friends
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "hal_mock.h"
+#include "log.h"
+#include "periodic.h"
+#include "plant.h"
+#include "robot_core.h"
+#include "robot_sim.h"
+
+#define SIM_MAX_CATCH_UP 50 // Ticks run in one go after a late wakeup
+
+////////// Data Structures //////////
+
+/**
+ * @core      The firmware
+ * @plant     The robot it drives
+ * @fd        The pty's master
+ * @csv       Where each pose goes too, NULL for nowhere
+ * @last_pose When the last pose went out, firmware micros()
+ * @rx_bytes  Bytes from the host
+ * @tx_bytes  Bytes to the host
+ * @tx_lost   Bytes the pty wouldn't take
+ */
+struct sim {
+  struct robot_core core;
+  struct plant plant;
+  int fd;
+  FILE *csv;
+  uint32_t last_pose;
+  uint64_t rx_bytes;
+  uint64_t tx_bytes;
+  uint64_t tx_lost;
+};
+
+static const struct motor_cal cal[NUM_MOTORS] = {
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT,
+    MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT, MOTOR_CAL_DEFAULT};
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+  (void)sig;
+  stop = 1;
+}
+
+void usage(const char *name) {
+  printf("Usage: %s [-t seconds] [-o csv] [-u mu] [-m kg] [-r ohms] [-E]\n"
+         "       [-h]\n"
+         "  -t  How long to run, 0 until ctrl-c (default 0)\n"
+         "  -o  Write every pose to this csv\n"
+         "  -u  Tire friction (default 0.8)\n"
+         "  -m  Robot mass (default 12)\n"
+         "  -r  Battery internal resistance (default 0.03)\n"
+         "  -E  No encoders, velocity frames run open loop\n"
+         "  -h  Show this message\n",
+         name);
+}
+
+// A fresh pty with its slave at SIM_PORT, -1 on error
+int open_pty() {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  struct termios raw;
+  const char *slave;
+  int slave_fd = -1;
+
+  if (fd == -1 || grantpt(fd) || unlockpt(fd) || !(slave = ptsname(fd)) ||
+      (slave_fd = open(slave, O_RDWR | O_NOCTTY)) == -1 ||
+      tcgetattr(slave_fd, &raw)) {
+    log_error("Error %d making a pty: %s", errno, strerror(errno));
+    if (slave_fd != -1)
+      close(slave_fd);
+    if (fd != -1)
+      close(fd);
+    return -1;
+  }
+  // Raw before the host opens it, or the telemetry gets echoed back at us
+  cfmakeraw(&raw);
+  tcsetattr(slave_fd, TCSANOW, &raw);
+  close(slave_fd);
+  unlink(SIM_PORT);
+  if (symlink(slave, SIM_PORT)) {
+    log_error("Error %d linking %s: %s", errno, SIM_PORT, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Whatever the host sent, into Serial1. -1 once the pty is gone
+static int sim_rx(struct sim *sim) {
+  uint8_t buf[256];
+  ssize_t len;
+
+  while ((len = read(sim->fd, buf, sizeof(buf))) > 0) {
+    sim->rx_bytes += len;
+    if (hal_mock_rx(buf, len))
+      log_warn("Serial1 overflowed, the firmware isn't keeping up");
+  }
+  // EIO is just nobody having the slave open, the host comes and goes
+  if (len == -1 && errno != EAGAIN && errno != EINTR && errno != EIO) {
+    log_error("Error %d reading the pty: %s", errno, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+// Whatever the firmware sent, out to the host
+static void sim_tx(struct sim *sim) {
+  ssize_t len = 0;
+
+  if (mock.tx_len)
+    len = write(sim->fd, mock.tx, mock.tx_len);
+  if (len > 0)
+    sim->tx_bytes += len;
+  // A host that isn't reading loses bytes, like it would off a radio
+  sim->tx_lost += mock.tx_len - (len > 0 ? len : 0);
+  mock.tx_len = mock.tx_pos = 0;
+}
+
+// Where the robot is, in its own seq the way the firmware's frames go out
+static void pose_send(struct sim *sim) {
+  struct robot_core *core = &sim->core;
+  struct plant *plant = &sim->plant;
+  struct proto_pose pose;
+  struct proto_frame frame;
+  uint8_t buf[PROTO_MAX_ENCODED];
+  size_t len;
+
+  pose.x_mm = lround(plant->x_m * 1000);
+  pose.y_mm = lround(plant->y_m * 1000);
+  pose.heading_mrad = lround(remainder(plant->heading, 2 * M_PI) * 1000);
+  pose.t_us = hal_micros();
+  proto_pack_pose(&frame, core->tx_seq, &pose);
+  len = proto_encode(&frame, buf);
+  if (hal_serial_write_space() >= len) {
+    hal_serial_write(buf, len);
+    core->tx_seq++;
+  }
+
+  if (sim->csv)
+    fprintf(sim->csv, "%.3f,%.1f,%.1f,%.4f,%.3f,%.3f,%.3f,%.3f,%.2f,%.1f\n",
+            plant->time_s, plant->x_m * 1000, plant->y_m * 1000,
+            plant->heading, plant->v_m_s, plant->omega,
+            plant->wheel_m_s[LF_INDEX], plant->wheel_m_s[RF_INDEX],
+            plant->volts, plant->current_a);
+}
+
+// One millisecond: loop(), the control tick, then the plant under it
+static void sim_step(struct sim *sim) {
+  struct plant *plant = &sim->plant;
+  int i;
+
+  robot_core_loop(&sim->core);
+  hal_mock_advance(CONTROL_PERIOD_US);
+  robot_core_tick(&sim->core);
+
+  for (i = 0; i < CONTROL_PERIOD_US / PLANT_STEP_US; i++)
+    plant_step(plant, mock.duty, PLANT_STEP_US * 1e-6f);
+  mock.wheel_mm[WHEEL_LEFT] = plant->side_m[WHEEL_LEFT] * 1000;
+  mock.wheel_mm[WHEEL_RIGHT] = plant->side_m[WHEEL_RIGHT] * 1000;
+  mock.wheel_mm_s[WHEEL_LEFT] = plant->wheel_m_s[LF_INDEX] * 1000;
+  mock.wheel_mm_s[WHEEL_RIGHT] = plant->wheel_m_s[RF_INDEX] * 1000;
+  mock.supply_mv = lroundf(plant->volts * 1000);
+
+  if (hal_micros() - sim->last_pose >= SIM_POSE_MS * 1000) {
+    sim->last_pose = hal_micros();
+    pose_send(sim);
+  }
+}
+
+void sim_log(const struct sim *sim) {
+  const struct plant *plant = &sim->plant;
+
+  log_info("Sim: %.1f s, ended at (%.0f, %.0f) mm heading %.1f deg, "
+           "%.0f mm of tread",
+           plant->time_s, plant->x_m * 1000, plant->y_m * 1000,
+           plant->heading * 180 / M_PI,
+           (fabs(plant->side_m[WHEEL_LEFT]) +
+            fabs(plant->side_m[WHEEL_RIGHT])) * 500);
+  log_info("Sim: tires slid for %.2f s, battery down to %.2f V at %.0f A "
+           "peak, %.1f mAh used",
+           plant->slip_s, plant->min_volts, plant->peak_a,
+           plant->used_ah * 1000);
+  log_info("Sim: %llu bytes in, %llu bytes out, %llu lost, firmware %u "
+           "frames %u bad crc %u bad framing, %u failsafe stops",
+           (unsigned long long)sim->rx_bytes,
+           (unsigned long long)sim->tx_bytes,
+           (unsigned long long)sim->tx_lost, sim->core.decoder.frames,
+           sim->core.decoder.crc_errors, sim->core.decoder.framing_errors,
+           sim->core.failsafes);
+}
+
+int main(int argc, char **argv) {
+  static struct sim sim;
+  struct plant_params params;
+  struct wheel_cal wheels[NUM_WHEELS] = {WHEEL_CAL_DEFAULT,
+                                         WHEEL_CAL_DEFAULT};
+  struct periodic_task loop;
+  const char *csv = NULL;
+  double seconds = 0;
+  int encoders = 1;
+  int passed, i, opt;
+
+  plant_params_default(&params);
+  while ((opt = getopt(argc, argv, "t:o:u:m:r:Eh")) != -1) {
+    switch (opt) {
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'o':
+      csv = optarg;
+      break;
+    case 'u':
+      params.mu = atof(optarg);
+      break;
+    case 'm':
+      params.mass_kg = atof(optarg);
+      break;
+    case 'r':
+      params.r_internal = atof(optarg);
+      break;
+    case 'E':
+      encoders = 0;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (seconds < 0 || params.mu <= 0 || params.mass_kg <= 0 ||
+      params.r_internal < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (csv) {
+    if (!(sim.csv = fopen(csv, "w"))) {
+      log_error("Error %d opening %s: %s", errno, csv, strerror(errno));
+      return 1;
+    }
+    fprintf(sim.csv, "t,x_mm,y_mm,heading,v,omega,left,right,volts,amps\n");
+  }
+
+  hal_mock_reset();
+  mock.external_plant = 1;
+  mock.real_cycles = 1;
+  mock.mm_per_count = params.mm_per_count;
+  plant_init(&sim.plant, &params);
+  for (i = 0; i < NUM_WHEELS && encoders; i++)
+    wheels[i].mm_per_count = params.mm_per_count;
+  hal_serial_begin(BAUD);
+  robot_core_init(&sim.core, cal, wheels);
+
+  if ((sim.fd = open_pty()) == -1)
+    return 1;
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  if (periodic_init(&loop, CONTROL_PERIOD_US * 1e-6)) {
+    unlink(SIM_PORT);
+    return 1;
+  }
+  log_info("Simulated robot on %s", SIM_PORT);
+
+  while (!stop && (seconds <= 0 || sim.plant.time_s < seconds)) {
+    if ((passed = periodic_wait(&loop, -1)) <= 0)
+      break;
+    if (sim_rx(&sim))
+      break;
+    // Late wakeups catch up, so sim time stays wall time
+    if (passed > SIM_MAX_CATCH_UP)
+      passed = SIM_MAX_CATCH_UP;
+    for (i = 0; i < passed; i++)
+      sim_step(&sim);
+    sim_tx(&sim);
+  }
+
+  periodic_log_stats(&loop, "Sim loop");
+  periodic_close(&loop);
+  sim_log(&sim);
+  if (sim.csv)
+    fclose(sim.csv);
+  close(sim.fd);
+  unlink(SIM_PORT);
+  return 0;
+}
@@ -0,0 +1,295 @@
+/**
+ * @file        : loopback
+ * @brief The real serial thread against the teensy emulator over a pty
+ *
+ * Makes a pty, links its slave to LOOPBACK_PORT so the normal scanner finds
+ * it, and runs teensy_emu on the master. This thread stands in for the wii
+ * thread and changes the command at a fixed rate. Everything in between
+ * (scanner, tx policy, writer, telemetry, probe, reconnect) is the real code.
+ * Every command value gets a timestamp when it's published, so publish to
+ * apply latency comes from one clock.
+ *
+ * $ ./serial-loopback -t 10                 # latency / throughput
+ * $ ./serial-loopback -c 0.001 -d 0.001     # corrupted and dropped bytes
+ * $ ./serial-loopback -k 3                  # unplug and replug after 3 s
+ *
+ * @created     : Sunday Oct 18, 2026 16:38:40 MDT
+ * @bugs        No known bugs
+ */
+
+#define _GNU_SOURCE // posix_openpt and friends
+#include "utils.h"
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+
+#include "teensy_emu.h"
+
+#define LOOPBACK_PREFIX "/tmp/wii-loopback"
+#define LOOPBACK_PORT LOOPBACK_PREFIX "0"
+#define LOOPBACK_UNPLUGGED_MS 500
+#define LOOPBACK_VALUES 31 // Command values before they repeat, 2 * 31 fits
+
+////////// Data Structures //////////
+
+/**
+ * @emu          The emulated teensy
+ * @loop_period  Seconds per firmware loop (its delay(10))
+ * @unplug_after Seconds before the pty gets unplugged, 0 never
+ * @published_ns When each drive.vx value was published, 0 once applied
+ * @latency      Publish to apply
+ * @replugged_ns When the pty came back, 0 once a command got through
+ * @reconnect_ns Pty back to the first command applied
+ */
+struct loopback {
+  struct teensy_emu emu;
+  double loop_period;
+  double unplug_after;
+  _Atomic int64_t published_ns[256];
+  struct histogram latency;
+  int64_t replugged_ns;
+  struct running_stats reconnect_ns;
+};
+
+void usage(const char *name) {
+  printf("Usage: %s [-t seconds] [-i hz] [-l ms] [-c p] [-d p] [-s seed]\n"
+         "       [-k seconds] [-B baud] [-p seconds] [-h]\n"
+         "  -t  How long to run (default 5)\n"
+         "  -i  Command changes a second (default 100)\n"
+         "  -l  Firmware loop period in ms (default 10)\n"
+         "  -c  Chance a byte gets a bit flipped, both ways\n"
+         "  -d  Chance a byte gets dropped, both ways\n"
+         "  -s  Seed for -c and -d\n"
+         "  -k  Unplug the pty after this many seconds, then plug it back\n"
+         "  -B  Negotiate the link up to this baud\n"
+         "  -p  Seconds between latency probes, 0 for none (default 1)\n"
+         "  -h  Show this message\n",
+         name);
+}
+
+// A fresh pty with its slave at LOOPBACK_PORT, -1 on error
+int open_pty() {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  struct termios raw;
+  const char *slave;
+  int slave_fd = -1;
+
+  if (fd == -1 || grantpt(fd) || unlockpt(fd) || !(slave = ptsname(fd)) ||
+      (slave_fd = open(slave, O_RDWR | O_NOCTTY)) == -1 ||
+      tcgetattr(slave_fd, &raw)) {
+    log_error("Error %d making a pty: %s", errno, strerror(errno));
+    if (slave_fd != -1)
+      close(slave_fd);
+    if (fd != -1)
+      close(fd);
+    return -1;
+  }
+  // Raw from the start, or whatever the emulator sends before the host opens
+  // the port gets cooked and echoed back
+  cfmakeraw(&raw);
+  tcsetattr(slave_fd, TCSANOW, &raw);
+  close(slave_fd);
+  unlink(LOOPBACK_PORT);
+  if (symlink(slave, LOOPBACK_PORT)) {
+    log_error("Error %d linking %s: %s", errno, LOOPBACK_PORT,
+              strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Runs on the emulator thread for every drive frame
+void on_drive(void *user, const struct proto_drive *drive, int64_t now_ns) {
+  struct loopback *lb = (struct loopback *)user;
+  int64_t published =
+      atomic_exchange(&lb->published_ns[(uint8_t)drive->vx], 0);
+
+  // Keepalives and stale values don't count
+  if (published)
+    histogram_add(&lb->latency, now_ns - published);
+  if (lb->replugged_ns) {
+    stats_add(&lb->reconnect_ns, now_ns - lb->replugged_ns);
+    lb->replugged_ns = 0;
+  }
+}
+
+// Pulls the pty out from under the host and puts a new one back
+int replug(struct loopback *lb) {
+  log_info("Unplugging %s", LOOPBACK_PORT);
+  close(lb->emu.fd);
+  unlink(LOOPBACK_PORT);
+  teensy_emu_reopen(&lb->emu, -1);
+  if (!shutdown_sleep(LOOPBACK_UNPLUGGED_MS))
+    return 0;
+
+  teensy_emu_reopen(&lb->emu, open_pty());
+  if (lb->emu.fd == -1)
+    return -1;
+  lb->replugged_ns = monotonic_ns();
+  log_info("Plugged %s back in", LOOPBACK_PORT);
+  return 0;
+}
+
+void *emu_thread(void *context) {
+  struct loopback *lb = (struct loopback *)context;
+  struct periodic_task loop;
+  int64_t unplug_ns = INT64_MAX;
+
+  if (lb->unplug_after > 0)
+    unplug_ns = monotonic_ns() + lb->unplug_after * 1e9;
+  if (periodic_init(&loop, lb->loop_period)) {
+    request_shutdown();
+    return NULL;
+  }
+  while (running && periodic_wait(&loop, shutdown_event) > 0) {
+    if (teensy_emu_loop(&lb->emu)) {
+      log_error("Emulator lost the pty");
+      request_shutdown();
+      break;
+    }
+    if (monotonic_ns() >= unplug_ns) {
+      unplug_ns = INT64_MAX;
+      if (replug(lb))
+        request_shutdown();
+    }
+  }
+  periodic_log_stats(&loop, "Emulator loop");
+  periodic_close(&loop);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  static struct loopback lb;
+  struct emu_faults faults = {0, 0, 1};
+  struct periodic_task input;
+  struct robot_command command;
+  pthread_t emu_thread_t;
+  pthread_t serial_thread_t;
+  double seconds = 5;
+  double input_rate = 100;
+  int64_t start_ns, end_ns;
+  int value = 0;
+  int opt;
+
+  lb.loop_period = 0.01;
+  probe_period = PROBE_PERIOD;
+  max_baud = 0;
+  memset(&port_match, 0, sizeof(port_match));
+  rt_profile = create_rt_config();
+
+  while ((opt = getopt(argc, argv, "t:i:l:c:d:s:k:B:p:h")) != -1) {
+    switch (opt) {
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'i':
+      input_rate = atof(optarg);
+      break;
+    case 'l':
+      lb.loop_period = atof(optarg) / 1000;
+      break;
+    case 'c':
+      faults.corrupt = atof(optarg);
+      break;
+    case 'd':
+      faults.drop = atof(optarg);
+      break;
+    case 's':
+      faults.seed = atoi(optarg);
+      break;
+    case 'k':
+      lb.unplug_after = atof(optarg);
+      break;
+    case 'B':
+      max_baud = atoi(optarg);
+      break;
+    case 'p':
+      probe_period = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (seconds <= 0 || input_rate <= 0 || lb.loop_period <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // What main's init_state_system and init_buffers do
+  scan_signal = 0;
+  running = 1;
+  caught_signal = 0;
+  if (init_events())
+    return 1;
+  signal(SIGINT, signal_handler);
+  signal(SIGTERM, signal_handler);
+  robot_main = kermit_robot();
+  robot_unsetopt(&robot_main, DEBUG);
+  robot_unsetopt(&robot_main, VERBOSE);
+  command = robot_get_command(&robot_main);
+  triple_buffer_init(&command_buffer, command_slots, sizeof(command), &command);
+  triple_buffer_init(&telemetry_buffer, telemetry_slots,
+                     sizeof(robot_main.telemetry), &robot_main.telemetry);
+
+  histogram_reset(&lb.latency);
+  stats_reset(&lb.reconnect_ns);
+  teensy_emu_init(&lb.emu, open_pty(), &faults);
+  if (lb.emu.fd == -1)
+    return 1;
+  lb.emu.on_drive = on_drive;
+  lb.emu.user = &lb;
+
+  char const *prefixes[1] = {LOOPBACK_PREFIX};
+  struct port_context p_cont = {prefixes, 1, 9600, 1, &port_match};
+
+  thread_creator(&emu_thread_t, &lb, "Teensy emulator", emu_thread);
+  thread_creator(&serial_thread_t, &p_cont, "Serial Communication",
+                 serial_thread);
+
+  // Stands in for the wii thread
+  wait_event(serial_ready_event, -1);
+  signal_event(wii_ready_event);
+  if (periodic_init(&input, 1 / input_rate))
+    request_shutdown();
+  start_ns = monotonic_ns();
+  end_ns = start_ns + seconds * 1e9;
+  while (running && monotonic_ns() < end_ns) {
+    value = value % LOOPBACK_VALUES + 1;
+    robot_main.drive->linear_vel = value;
+    atomic_store(&lb.published_ns[2 * value], monotonic_ns());
+    publish_command(1);
+    if (periodic_wait(&input, shutdown_event) <= 0)
+      break;
+  }
+  end_ns = monotonic_ns();
+  periodic_log_stats(&input, "Input loop");
+  periodic_close(&input);
+  request_shutdown();
+
+  thread_joiner(&serial_thread_t, "Serial Communication thread");
+  thread_joiner(&emu_thread_t, "Teensy emulator thread");
+
+  teensy_emu_log(&lb.emu);
+  log_info("Throughput: %.1f drives/s applied, %.0f bytes/s in, %.0f "
+           "bytes/s out",
+           lb.emu.drives * 1e9 / (end_ns - start_ns),
+           lb.emu.rx_bytes * 1e9 / (end_ns - start_ns),
+           lb.emu.tx_bytes * 1e9 / (end_ns - start_ns));
+  stats_log_ns(&input_latency, "Input to serial latency");
+  histogram_log_ns(&lb.latency, "Publish to apply latency");
+  if (lb.unplug_after > 0) {
+    if (lb.reconnect_ns.count)
+      stats_log_ns(&lb.reconnect_ns, "Replug to first command applied");
+    else
+      log_warn("Never got a command through after the replug");
+  }
+
+  if (lb.emu.fd != -1)
+    close(lb.emu.fd);
+  unlink(LOOPBACK_PORT);
+  close_events();
+  robot_clean_up(&robot_main);
+  return 0;
+}
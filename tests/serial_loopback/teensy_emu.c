@@ -0,0 +1,224 @@
+/**
+ * @file        : teensy_emu
+ * @created     : Sunday Oct 18, 2026 16:38:40 MDT
+ */
+
+#include "teensy_emu.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "periodic.h"
+
+#define EMU_READ_SIZE 64
+
+// Same as robot_core.h
+#define EMU_BAUD 9600
+#define EMU_BAUD_MAX 2000000
+
+static uint32_t micros() { return monotonic_ns() / 1000; }
+
+static int chance(struct teensy_emu *emu, double p) {
+  return p > 0 && rand_r(&emu->faults.seed) < p * RAND_MAX;
+}
+
+// Drops or flips bytes in place, returns the new length
+static size_t inject(struct teensy_emu *emu, uint8_t *buf, size_t len) {
+  size_t in, out = 0;
+
+  for (in = 0; in < len; ++in) {
+    if (chance(emu, emu->faults.drop)) {
+      emu->dropped++;
+      continue;
+    }
+    buf[out] = buf[in];
+    if (chance(emu, emu->faults.corrupt)) {
+      buf[out] ^= 1 << (rand_r(&emu->faults.seed) % 8);
+      emu->corrupted++;
+    }
+    out++;
+  }
+  return out;
+}
+
+// frame_send, a full pty is a full tx buffer
+static int frame_send(struct teensy_emu *emu, struct proto_frame *frame) {
+  uint8_t buf[PROTO_MAX_ENCODED];
+  size_t len;
+
+  if (emu->fd == -1)
+    return 0;
+  frame->seq = emu->tx_seq;
+  len = inject(emu, buf, proto_encode(frame, buf));
+  if (write(emu->fd, buf, len) != (ssize_t)len)
+    return 0;
+  emu->tx_bytes += len;
+  emu->tx_seq++;
+  return 1;
+}
+
+static void handle_frame(struct teensy_emu *emu,
+                         const struct proto_frame *frame) {
+  struct proto_drive drive;
+  struct proto_ping ping;
+  struct proto_frame ack;
+  uint32_t baud;
+
+  emu->frames++;
+  if (proto_unpack_drive(frame, &drive)) {
+    emu->lin = 2 * drive.vx;
+    emu->ang = 2 * drive.omega;
+    emu->gun1 = 2 * drive.gun1;
+    emu->gun2 = 2 * drive.gun2;
+    emu->applied_seq = frame->seq;
+    emu->drives++;
+    // Applied at the next motor write, same loop
+    if (emu->on_drive)
+      emu->on_drive(emu->user, &drive, monotonic_ns());
+  } else if (frame->type == PROTO_STOP) {
+    emu->lin = 0;
+    emu->ang = 0;
+  } else if (proto_unpack_ping(frame, &ping)) {
+    emu->pong.nonce = ping.nonce;
+    emu->pong.host_ns = ping.host_ns;
+    emu->pong.rx_us = micros();
+    emu->pong_pending = 1;
+  } else if (proto_unpack_baud(frame, PROTO_BAUD, &baud)) {
+    // A pty runs at any baud, so the switch itself is a no-op
+    if (baud < EMU_BAUD || baud > EMU_BAUD_MAX)
+      baud = 0;
+    proto_pack_baud(&ack, PROTO_BAUD_ACK, 0, baud);
+    frame_send(emu, &ack);
+    emu->bauds++;
+  }
+}
+
+// serial_listen
+static int serial_listen(struct teensy_emu *emu) {
+  uint8_t buf[EMU_READ_SIZE];
+  struct proto_frame frame;
+  ssize_t n;
+  size_t i, len;
+
+  for (;;) {
+    n = read(emu->fd, buf, sizeof(buf));
+    if (n == -1 && (errno == EAGAIN || errno == EINTR))
+      return 0;
+    if (n <= 0) // EIO once the host closes the pty
+      return n == -1 && errno == EIO ? 0 : -1;
+    emu->rx_bytes += n;
+    len = inject(emu, buf, n);
+    for (i = 0; i < len; ++i)
+      if (proto_decode_byte(&emu->decoder, buf[i], &frame) == PROTO_FRAME)
+        handle_frame(emu, &frame);
+  }
+}
+
+// callback_velocity
+static void callback_velocity(struct teensy_emu *emu) {
+  emu->throttle[0] = -(emu->lin + emu->ang);
+  emu->throttle[1] = -(emu->lin + emu->ang);
+  emu->throttle[2] = emu->lin - emu->ang;
+  emu->throttle[3] = emu->lin - emu->ang;
+  emu->throttle[4] = -emu->gun1;
+  emu->throttle[5] = emu->gun2;
+}
+
+static void pong_send(struct teensy_emu *emu) {
+  struct proto_frame frame;
+
+  if (!emu->pong_pending)
+    return;
+  emu->pong_pending = 0;
+  emu->pong.apply_us = micros();
+  emu->pong.tx_us = micros();
+  proto_pack_pong(&frame, 0, &emu->pong);
+  if (frame_send(emu, &frame))
+    emu->pongs++;
+}
+
+static void telemetry_send(struct teensy_emu *emu) {
+  struct proto_telemetry *report = &emu->telemetry;
+  struct proto_frame frame;
+  int i;
+
+  for (i = 0; i < EMU_NUM_MOTORS; i++)
+    report->throttle[i] = emu->throttle[i];
+  report->ack_seq = emu->applied_seq;
+  report->period_us =
+      emu->period_us < UINT16_MAX ? emu->period_us : UINT16_MAX;
+  report->busy_max_us =
+      emu->busy_max_us < UINT16_MAX ? emu->busy_max_us : UINT16_MAX;
+  report->supply_mv = EMU_SUPPLY_MV;
+  report->crc_errors = emu->decoder.crc_errors;
+  report->framing_errors = emu->decoder.framing_errors;
+  report->lost_frames = emu->decoder.lost_frames;
+
+  proto_pack_telemetry(&frame, 0, report);
+  if (!frame_send(emu, &frame)) {
+    report->tx_dropped++;
+    return;
+  }
+  emu->busy_max_us = 0;
+}
+
+void teensy_emu_init(struct teensy_emu *emu, int fd,
+                     const struct emu_faults *faults) {
+  memset(emu, 0, sizeof(*emu));
+  emu->fd = fd;
+  if (faults)
+    emu->faults = *faults;
+  proto_decoder_init(&emu->decoder);
+  emu->loop_start = micros();
+  emu->last_report = emu->loop_start;
+}
+
+void teensy_emu_reopen(struct teensy_emu *emu, int fd) {
+  emu->fd = fd;
+  emu->decoder.len = 0;
+  emu->decoder.overflow = 0;
+  emu->decoder.have_seq = 0;
+  emu->pong_pending = 0;
+}
+
+int teensy_emu_loop(struct teensy_emu *emu) {
+  uint32_t now = micros();
+  uint32_t busy;
+
+  emu->period_us = now - emu->loop_start;
+  emu->loop_start = now;
+  if (emu->fd == -1)
+    return 0;
+
+  if (serial_listen(emu))
+    return -1;
+  callback_velocity(emu);
+  pong_send(emu);
+  if (now - emu->last_report >= EMU_TELEMETRY_PERIOD_US) {
+    emu->last_report = now;
+    telemetry_send(emu);
+  }
+
+  busy = micros() - emu->loop_start;
+  if (busy > emu->busy_max_us)
+    emu->busy_max_us = busy;
+  return 0;
+}
+
+void teensy_emu_log(const struct teensy_emu *emu) {
+  log_info("Emulator: %llu bytes in, %llu bytes out, %llu frames, %llu drives "
+           "applied, %llu pings, %llu baud requests",
+           (unsigned long long)emu->rx_bytes,
+           (unsigned long long)emu->tx_bytes,
+           (unsigned long long)emu->frames, (unsigned long long)emu->drives,
+           (unsigned long long)emu->pongs, (unsigned long long)emu->bauds);
+  log_info("Emulator: %llu bytes corrupted, %llu dropped, decoder saw %u bad "
+           "crc %u bad framing %u lost, %u reports skipped",
+           (unsigned long long)emu->corrupted,
+           (unsigned long long)emu->dropped, emu->decoder.crc_errors,
+           emu->decoder.framing_errors, emu->decoder.lost_frames,
+           emu->telemetry.tx_dropped);
+}
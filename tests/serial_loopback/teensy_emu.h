@@ -0,0 +1,139 @@
+/**
+ * @file        : teensy_emu
+ * @brief The teensy firmware's serial side, running on the host
+ *
+ * A copy of the frame handling, mixer, telemetry and pongs from
+ * teensy/lib/robot_core, on the same protocol library, talking to the
+ * master side of a pty instead of Serial1. One teensy_emu_loop is one pass of
+ * the firmware's loop(). Bytes can be corrupted or dropped on the way in and
+ * out to see how the link copes.
+ *
+ * @note Keep it in step with robot_core, this is only as good as the copy
+ *
+ * @created     : Sunday Oct 18, 2026 16:38:40 MDT
+ * @bugs        No known bugs
+ */
+
+#ifndef TEENSY_EMU_H
+
+#define TEENSY_EMU_H
+
+// C Includes
+#include <stdint.h>
+
+// Local Includes
+#include "protocol.h"
+
+// Same as robot_core.h
+#define EMU_NUM_MOTORS 6
+#define EMU_TELEMETRY_PERIOD_US 100000
+#define EMU_SUPPLY_MV 12000
+
+////////// Data Structures //////////
+
+/**
+ * What goes wrong on the wire, both directions
+ *
+ * @corrupt Chance a byte gets one bit flipped
+ * @drop    Chance a byte goes missing
+ * @seed    Seed for the above, so runs repeat
+ */
+struct emu_faults {
+  double corrupt;
+  double drop;
+  unsigned int seed;
+};
+
+/**
+ * @fd           The pty master
+ * @faults       Fault injection
+ * @decoder      Frame decoder, like the firmware's
+ * @lin          Firmware lin / ang / gun1 / gun2
+ * @throttle     The throttles callback_velocity made
+ * @applied_seq  seq of the last drive frame
+ * @tx_seq       seq of the next frame out
+ * @pong         The pong to send after the next motor write
+ * @pong_pending Set when pong is waiting
+ * @telemetry    The report, tx_dropped carries over
+ * @loop_start   Firmware micros() at the start of the last loop
+ * @period_us    Time between the last two loop starts
+ * @busy_max_us  Longest loop since the last report
+ * @last_report  micros() of the last report
+ * @on_drive     Called with every drive frame right after it's applied
+ * @user         Passed to on_drive
+ * @rx_bytes     Bytes read, before faults
+ * @tx_bytes     Bytes written, after faults
+ * @frames       Good frames decoded
+ * @drives       Drive frames applied
+ * @pongs        Pings answered
+ * @bauds        Baud requests answered
+ * @corrupted    Bytes with a bit flipped
+ * @dropped      Bytes dropped
+ */
+struct teensy_emu {
+  int fd;
+  struct emu_faults faults;
+  struct proto_decoder decoder;
+  int8_t lin;
+  int8_t ang;
+  int8_t gun1;
+  int8_t gun2;
+  int8_t throttle[EMU_NUM_MOTORS];
+  uint8_t applied_seq;
+  uint8_t tx_seq;
+  struct proto_pong pong;
+  int pong_pending;
+  struct proto_telemetry telemetry;
+  uint32_t loop_start;
+  uint32_t period_us;
+  uint32_t busy_max_us;
+  uint32_t last_report;
+  void (*on_drive)(void *user, const struct proto_drive *drive,
+                   int64_t now_ns);
+  void *user;
+  uint64_t rx_bytes;
+  uint64_t tx_bytes;
+  uint64_t frames;
+  uint64_t drives;
+  uint64_t pongs;
+  uint64_t bauds;
+  uint64_t corrupted;
+  uint64_t dropped;
+};
+
+/**
+ * @brief Sets up an emulator, like setup()
+ *
+ * @param emu The emulator
+ * @param fd The pty master (O_NONBLOCK)
+ * @param faults Fault injection, NULL for none
+ */
+void teensy_emu_init(struct teensy_emu *emu, int fd,
+                     const struct emu_faults *faults);
+
+/**
+ * @brief Moves the emulator to a new pty, like a power cycle of the radio
+ * @note The decoder starts over, the counters carry on
+ *
+ * @param emu The emulator
+ * @param fd The new pty master, -1 for unplugged
+ */
+void teensy_emu_reopen(struct teensy_emu *emu, int fd);
+
+/**
+ * @brief One pass of the firmware's loop() with a control tick right after
+ *
+ * @param emu The emulator
+ *
+ * @return 0, -1 if the pty broke
+ */
+int teensy_emu_loop(struct teensy_emu *emu);
+
+/**
+ * @brief Logs the counters
+ *
+ * @param emu The emulator
+ */
+void teensy_emu_log(const struct teensy_emu *emu);
+
+#endif /* end of include guard TEENSY_EMU_H */
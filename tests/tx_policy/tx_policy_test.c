@@ -0,0 +1,119 @@
+/**
+ * @file        : tx_policy_test
+ * @brief The tx policy's link estimate against made up output queue samples
+ *
+ * No serial involved, every sample is what TIOCOUTQ and the writer would have
+ * said on a link of a known speed. Exits non zero if a check fails.
+ *
+ * $ ./tx-policy-test
+ *
+ * @created     : Sunday Oct 18, 2026 17:56:26 MDT
+ * @bugs        No known bugs
+ */
+
+#include <stdio.h>
+
+#include "tx_policy.h"
+
+#define NS_PER_MS 1000000LL
+#define TEST_BAUD 9600 // 960 bytes/s on the line
+#define TEST_FRAME 100 // Bytes a frame
+
+static int failures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond);                 \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+// Writes a frame at now and samples it draining at rate bytes a second,
+// every TX_SAMPLE until it's gone. Returns when the queue emptied
+static int64_t drain(struct tx_policy *policy, uint64_t *written, int64_t now,
+                     double rate) {
+  int64_t step = TX_SAMPLE * 1e9;
+  int64_t start = now;
+  int queued = TEST_FRAME;
+
+  tx_policy_sent(policy, now, TEST_FRAME);
+  *written += TEST_FRAME;
+  CHECK(tx_policy_sample_ns(policy, *written) == 0);
+  tx_policy_drained(policy, now, queued, *written);
+  while (queued > 0) {
+    now += step;
+    queued = TEST_FRAME - (int)(rate * (now - start) / 1e9);
+    if (queued < 0)
+      queued = 0;
+    CHECK(tx_policy_sample_ns(policy, *written) <= now);
+    tx_policy_drained(policy, now, queued, *written);
+  }
+  CHECK(tx_policy_sample_ns(policy, *written) == INT64_MAX);
+  return now;
+}
+
+// A radio that only gets 500 bytes/s through on a 9600 baud line
+static void test_slow_link_brings_the_estimate_down(void) {
+  struct tx_policy policy;
+  uint64_t written = 0;
+  int64_t now = 1000 * NS_PER_MS;
+  int i;
+
+  tx_policy_init(&policy, 0.01, 1, TEST_BAUD);
+  CHECK(policy.bytes_per_sec == TEST_BAUD / 10);
+  for (i = 0; i < 5; ++i)
+    now = drain(&policy, &written, now, 500) + 100 * NS_PER_MS;
+
+  CHECK(policy.samples > 0);
+  CHECK(policy.bytes_per_sec > 450 && policy.bytes_per_sec < 550);
+  // A frame takes 200 ms to drain, the spacing has to make room for it
+  CHECK(policy.spacing_ns > 200 * NS_PER_MS);
+}
+
+// A pty drains as soon as it's written, that says nothing past the baud
+static void test_estimate_stays_under_the_line_rate(void) {
+  struct tx_policy policy;
+  uint64_t written = 0;
+  int64_t now = 1000 * NS_PER_MS;
+  int i;
+
+  tx_policy_init(&policy, 0.01, 1, TEST_BAUD);
+  for (i = 0; i < 5; ++i)
+    now = drain(&policy, &written, now, 1e6) + 100 * NS_PER_MS;
+
+  CHECK(policy.bytes_per_sec <= TEST_BAUD / 10);
+  // 100 bytes at 960 bytes/s with headroom
+  CHECK(policy.spacing_ns > 150 * NS_PER_MS);
+}
+
+// Bytes still in the writer never reached the tty, they can't have drained
+static void test_only_written_bytes_count(void) {
+  struct tx_policy policy;
+  uint64_t written = 0;
+  int64_t now = 1000 * NS_PER_MS;
+  double slow;
+
+  tx_policy_init(&policy, 0.01, 1, TEST_BAUD);
+  now = drain(&policy, &written, now, 500) + 100 * NS_PER_MS;
+  slow = policy.bytes_per_sec;
+  CHECK(slow < TEST_BAUD / 10);
+
+  // Sent, but the writer is holding it and the queue is empty
+  tx_policy_sent(&policy, now, TEST_FRAME);
+  CHECK(tx_policy_sample_ns(&policy, written) == INT64_MAX);
+  tx_policy_drained(&policy, now + NS_PER_MS, 0, written);
+  CHECK(policy.bytes_per_sec == slow);
+}
+
+int main() {
+  test_slow_link_brings_the_estimate_down();
+  test_estimate_stays_under_the_line_rate();
+  test_only_written_bytes_count();
+  if (failures) {
+    printf("tx policy: %d checks failed\n", failures);
+    return 1;
+  }
+  printf("tx policy: ok\n");
+  return 0;
+}